@@ -0,0 +1,142 @@
+/**
+ * @file arena.c
+ * @brief Implementación del asignador por bloques con listas libres por tamaño.
+ * 
+ * @authors
+ * Benjamin Sanhueza (bsanhuez@umag.cl)
+ * Nicolas Mancilla (nicmanci@umag.cl)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+
+/// Bytes que ocupa la cabecera de un bloque, redondeados a la alineación.
+#define BLOCK_HEADER ((sizeof(ArenaBlock) + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1))
+
+/**
+ * @brief Obtiene la clase de tamaño de un pedido pequeño.
+ * 
+ * @param size Bytes pedidos.
+ * @return Índice de la clase (la menor potencia de dos >= size, desde 16).
+ */
+static int size_class(size_t size)
+{
+    int index = 0;
+    size_t class_size = ARENA_ALIGNMENT;
+    while (class_size < size) 
+    {
+        class_size *= 2;
+        index++;
+    }
+    return index;
+}
+
+/**
+ * @brief Reserva un bloque nuevo y lo agrega a la lista de la arena.
+ * 
+ * @param arena Arena.
+ * @param size Bytes utilizables del bloque.
+ * @return Inicio de la zona utilizable, o NULL si no hay memoria.
+ */
+static unsigned char *new_block(Arena *arena, size_t size)
+{
+    ArenaBlock *block = (ArenaBlock *)malloc(BLOCK_HEADER + size);
+    if (!block) 
+    {
+        perror("Error al asignar memoria para la arena");
+        return NULL;
+    }
+    block->next = arena->blocks;
+    block->size = size;
+    arena->blocks = block;
+    return (unsigned char *)block + BLOCK_HEADER;
+}
+
+/**
+ * @brief Reserva memoria avanzando el cursor de la arena.
+ * 
+ * @param arena Arena.
+ * @param size Bytes pedidos.
+ * @return Puntero alineado, o NULL si no hay memoria.
+ */
+void *arena_alloc(Arena *arena, size_t size)
+{
+    size = (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+
+    if (size > ARENA_BLOCK_SIZE / 4) 
+    {
+        return new_block(arena, size);
+    }
+
+    if (size > arena->remaining) 
+    {
+        unsigned char *start = new_block(arena, ARENA_BLOCK_SIZE);
+        if (!start) return NULL;
+        arena->cursor = start;
+        arena->remaining = ARENA_BLOCK_SIZE;
+    }
+
+    void *result = arena->cursor;
+    arena->cursor += size;
+    arena->remaining -= size;
+    return result;
+}
+
+/**
+ * @brief Reserva un nodo pequeño, primero desde la lista libre de su clase.
+ * 
+ * @param arena Arena.
+ * @param size Bytes pedidos.
+ * @return Puntero al nodo, o NULL si no hay memoria.
+ */
+void *arena_alloc_node(Arena *arena, size_t size)
+{
+    if (size > ARENA_MAX_SMALL) return arena_alloc(arena, size);
+
+    int index = size_class(size);
+    ArenaFreeNode *node = arena->free_lists[index];
+    if (node != NULL) 
+    {
+        arena->free_lists[index] = node->next;
+        return node;
+    }
+    return arena_alloc(arena, (size_t)ARENA_ALIGNMENT << index);
+}
+
+/**
+ * @brief Devuelve un nodo pequeño a la lista libre de su clase.
+ * 
+ * Los nodos mayores que ARENA_MAX_SMALL no se reutilizan hasta arena_reset().
+ * 
+ * @param arena Arena.
+ * @param node Nodo a liberar.
+ * @param size Tamaño con que se reservó.
+ */
+void arena_free_node(Arena *arena, void *node, size_t size)
+{
+    if (size > ARENA_MAX_SMALL) return;
+
+    int index = size_class(size);
+    ArenaFreeNode *free_node = (ArenaFreeNode *)node;
+    free_node->next = arena->free_lists[index];
+    arena->free_lists[index] = free_node;
+}
+
+/**
+ * @brief Libera todos los bloques de la arena y la deja vacía.
+ * 
+ * @param arena Arena.
+ */
+void arena_reset(Arena *arena)
+{
+    ArenaBlock *block = arena->blocks;
+    while (block != NULL) 
+    {
+        ArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    memset(arena, 0, sizeof(Arena));
+}
@@ -0,0 +1,90 @@
+/**
+ * @file arena.h
+ * @brief Asignador por bloques (bump allocator) con listas libres por tamaño.
+ * 
+ * La arena reserva bloques grandes al sistema y entrega memoria avanzando un cursor.
+ * Los nodos pequeños que se liberan y vuelven a pedir con frecuencia (como FileNode)
+ * usan listas libres por clase de tamaño, así se reutilizan sin llamar a malloc/free.
+ * Toda la memoria se devuelve de una vez con arena_reset().
+ * 
+ * @authors
+ * - Benjamin Sanhueza (bsanhuez@umag.cl)
+ * - Nicolas Mancilla (nicmanci@umag.cl)
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+#define ARENA_BLOCK_SIZE (1u << 20) ///< Tamaño de cada bloque pedido al sistema.
+#define ARENA_ALIGNMENT 16 ///< Alineación de todas las asignaciones.
+#define ARENA_CLASS_COUNT 5 ///< Clases de tamaño: 16, 32, 64, 128 y 256 bytes.
+#define ARENA_MAX_SMALL 256 ///< Tamaño máximo atendido por las listas libres.
+
+/**
+ * @brief Bloque de memoria de la arena.
+ */
+typedef struct ArenaBlock 
+{
+    struct ArenaBlock *next; ///< Bloque reservado anteriormente.
+    size_t size; ///< Bytes utilizables del bloque.
+} ArenaBlock;
+
+/**
+ * @brief Nodo de una lista libre (se guarda dentro de la memoria liberada).
+ */
+typedef struct ArenaFreeNode 
+{
+    struct ArenaFreeNode *next; ///< Siguiente nodo libre de la misma clase.
+} ArenaFreeNode;
+
+/**
+ * @brief Estado de una arena.
+ */
+typedef struct Arena 
+{
+    ArenaBlock *blocks; ///< Lista de bloques reservados.
+    unsigned char *cursor; ///< Próxima posición libre del bloque actual.
+    size_t remaining; ///< Bytes libres en el bloque actual.
+    ArenaFreeNode *free_lists[ARENA_CLASS_COUNT]; ///< Nodos libres por clase de tamaño.
+} Arena;
+
+/**
+ * @brief Reserva memoria avanzando el cursor de la arena.
+ * 
+ * Los pedidos mayores que un bloque reciben un bloque propio. La memoria solo se
+ * devuelve con arena_reset().
+ * 
+ * @param arena Arena.
+ * @param size Bytes pedidos.
+ * @return Puntero alineado a ARENA_ALIGNMENT, o NULL si no hay memoria.
+ */
+void *arena_alloc(Arena *arena, size_t size);
+
+/**
+ * @brief Reserva un nodo pequeño, reutilizando uno liberado de la misma clase si existe.
+ * 
+ * @param arena Arena.
+ * @param size Bytes pedidos (como máximo ARENA_MAX_SMALL).
+ * @return Puntero al nodo, o NULL si no hay memoria.
+ */
+void *arena_alloc_node(Arena *arena, size_t size);
+
+/**
+ * @brief Devuelve un nodo pequeño a la lista libre de su clase.
+ * 
+ * @param arena Arena.
+ * @param node Nodo obtenido con arena_alloc_node().
+ * @param size El mismo tamaño usado al reservarlo.
+ */
+void arena_free_node(Arena *arena, void *node, size_t size);
+
+/**
+ * @brief Libera todos los bloques de la arena de una vez.
+ * 
+ * @param arena Arena.
+ */
+void arena_reset(Arena *arena);
+
+#endif
@@ -0,0 +1,303 @@
+/**
+ * @file delta_check.c
+ * @brief Comprueba que delta_apply() reconstruye lo que describe delta_create() y rechaza deltas dañados.
+ * 
+ * Se compila aparte del programa, desde la raíz del repositorio:
+ * 
+ *     gcc -O2 -I. -o delta_check bench/delta_check.c delta.c
+ *     ./delta_check
+ * 
+ * Recorre tres grupos de casos: contenidos con ediciones al azar (inserciones, borrados
+ * y reemplazos), entradas vacías o más cortas que un bloque, y copias de 0x10000 bytes
+ * o más (el largo 0 de una copia significa 0x10000). Cada delta creado se aplica y se
+ * compara con el contenido nuevo, y después se daña de varias formas (cortándolo,
+ * cambiando los largos, agregando instrucciones al final) para comprobar que
+ * delta_apply() devuelve -1. Compilado con -fsanitize=address también comprueba que
+ * ningún delta dañado lea o escriba fuera de sus buffers.
+ * 
+ * @authors
+ * Benjamin Sanhueza (bsanhuez@umag.cl)
+ * Nicolas Mancilla (nicmanci@umag.cl)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "delta.h"
+
+#define CHECK_EDIT_ROUNDS 300 ///< Pares base/contenido nuevo con ediciones al azar.
+#define CHECK_MAX_SIZE ((size_t)64 << 10) ///< Largo máximo de la base en las ediciones al azar.
+#define CHECK_BIG_SIZE ((size_t)512 << 10) ///< Largo de la base en las copias largas.
+#define CHECK_PREFIXES 64 ///< Cortes al azar que se prueban en cada delta, además de los primeros bytes.
+
+/**
+ * @brief Instrucción que, agregada al final de un delta correcto, lo deja inválido.
+ */
+typedef struct ExtraOp
+{
+    uint8_t bytes[3]; ///< Bytes de la instrucción.
+    size_t size; ///< Bytes usados.
+} ExtraOp;
+
+/// Inserción que se pasa del resultado, inserción de largo 0, copia de un byte que se
+/// pasa del resultado y copia con el desplazamiento cortado.
+static const ExtraOp extra_ops[] = {
+    { { 0x01, 'x', 0 }, 2 },
+    { { 0x00, 0, 0 }, 1 },
+    { { 0x91, 0x00, 0x01 }, 3 },
+    { { 0x81, 0, 0 }, 1 },
+};
+
+/// Errores encontrados.
+static unsigned long failures;
+
+/**
+ * @brief Generador pseudoaleatorio (xorshift), para que los casos sean siempre iguales.
+ * 
+ * @param state Estado, distinto de 0.
+ * @return Siguiente número.
+ */
+static uint32_t next_random(uint32_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+/**
+ * @brief Anota un error si una condición no se cumple.
+ * 
+ * @param ok Condición esperada.
+ * @param group Grupo de casos.
+ * @param what Qué se comprobaba.
+ * @param size Largo del contenido nuevo del caso.
+ */
+static void expect(int ok, const char *group, const char *what, size_t size)
+{
+    if (ok) return;
+    failures++;
+    fprintf(stderr, "Error: %s: %s (contenido de %zu bytes).\n", group, what, size);
+}
+
+/**
+ * @brief Aplica un delta sobre un destino justo y comprueba si se rechaza.
+ * 
+ * El destino se reserva con el largo exacto, así una escritura de más la detecta el
+ * sanitizador de memoria.
+ * 
+ * @param base Contenido base.
+ * @param base_size Largo de la base.
+ * @param delta Delta.
+ * @param delta_size Largo del delta.
+ * @param target_size Largo esperado del resultado.
+ * @return 1 si delta_apply() devolvió -1, 0 si lo aceptó o no hay memoria.
+ */
+static int rejected(const uint8_t *base, size_t base_size, const uint8_t *delta, size_t delta_size, size_t target_size)
+{
+    uint8_t *target = (uint8_t *)malloc(target_size > 0 ? target_size : 1);
+    if (!target)
+    {
+        perror("Error al asignar memoria");
+        return 0;
+    }
+    int result = delta_apply(base, base_size, delta, delta_size, target, target_size);
+    free(target);
+    return result == -1;
+}
+
+/**
+ * @brief Daña un delta correcto de varias formas y comprueba que cada una se rechaza.
+ * 
+ * @param group Grupo de casos.
+ * @param base Contenido base.
+ * @param base_size Largo de la base.
+ * @param delta Delta que reconstruye @p target_size bytes.
+ * @param delta_size Largo del delta.
+ * @param target_size Largo del contenido nuevo.
+ * @param state Estado del generador.
+ */
+static void check_corrupted(const char *group, const uint8_t *base, size_t base_size, const uint8_t *delta,
+                            size_t delta_size, size_t target_size, uint32_t *state)
+{
+    for (size_t len = 0; len < delta_size; len++)
+    {
+        if (len >= CHECK_PREFIXES && next_random(state) % (delta_size / CHECK_PREFIXES + 1) != 0) continue;
+        expect(rejected(base, base_size, delta, len, target_size), group, "aceptó un delta cortado", target_size);
+    }
+
+    if (base_size > 0) expect(rejected(base, base_size - 1, delta, delta_size, target_size), group, "aceptó una base más corta", target_size);
+    if (target_size > 0) expect(rejected(base, base_size, delta, delta_size, target_size - 1), group, "aceptó un resultado más corto", target_size);
+    expect(rejected(base, base_size, delta, delta_size, target_size + 1), group, "aceptó un resultado más largo", target_size);
+
+    uint8_t *longer = (uint8_t *)malloc(delta_size + 8);
+    if (!longer)
+    {
+        perror("Error al asignar memoria");
+        failures++;
+        return;
+    }
+    for (size_t i = 0; i < sizeof(extra_ops) / sizeof(extra_ops[0]); i++)
+    {
+        memcpy(longer, delta, delta_size);
+        memcpy(longer + delta_size, extra_ops[i].bytes, extra_ops[i].size);
+        expect(rejected(base, base_size, longer, delta_size + extra_ops[i].size, target_size), group, "aceptó una instrucción de más", target_size);
+    }
+    free(longer);
+}
+
+/**
+ * @brief Crea el delta entre dos contenidos, lo aplica y lo daña.
+ * 
+ * Si alguno de los dos es más corto que DELTA_BLOCK_SIZE, delta_create() no debe
+ * crear un delta (el blob se guarda completo).
+ * 
+ * @param group Grupo de casos.
+ * @param base Contenido base.
+ * @param base_size Largo de la base.
+ * @param target Contenido nuevo.
+ * @param target_size Largo del contenido nuevo.
+ * @param state Estado del generador.
+ * @return Largo del delta creado, o 0 si no se creó.
+ */
+static size_t check_pair(const char *group, const uint8_t *base, size_t base_size, const uint8_t *target,
+                         size_t target_size, uint32_t *state)
+{
+    uint8_t *delta = NULL;
+    size_t delta_size = delta_create(base, base_size, target, target_size, target_size * 2 + 64, &delta);
+    if (base_size < DELTA_BLOCK_SIZE || target_size < DELTA_BLOCK_SIZE)
+    {
+        expect(delta_size == 0, group, "creó un delta con una entrada corta", target_size);
+        free(delta);
+        return 0;
+    }
+    expect(delta_size > 0, group, "no creó el delta", target_size);
+    if (delta_size == 0) return 0;
+
+    uint8_t *output = (uint8_t *)malloc(target_size);
+    if (!output)
+    {
+        perror("Error al asignar memoria");
+        failures++;
+        free(delta);
+        return 0;
+    }
+    int result = delta_apply(base, base_size, delta, delta_size, output, target_size);
+    expect(result == 0 && memcmp(output, target, target_size) == 0, group, "el delta no reconstruye el contenido", target_size);
+    free(output);
+
+    check_corrupted(group, base, base_size, delta, delta_size, target_size, state);
+    free(delta);
+    return delta_size;
+}
+
+/**
+ * @brief Llena un buffer con texto al azar de un alfabeto pequeño, para que haya coincidencias.
+ * 
+ * @param data Destino.
+ * @param size Largo.
+ * @param state Estado del generador.
+ */
+static void fill_text(uint8_t *data, size_t size, uint32_t *state)
+{
+    for (size_t i = 0; i < size; i++) data[i] = (uint8_t)("abcdefgh \n"[next_random(state) % 10]);
+}
+
+/**
+ * @brief Arma un contenido nuevo aplicando a la base ediciones al azar.
+ * 
+ * @param base Contenido base.
+ * @param base_size Largo de la base.
+ * @param target Destino con capacidad para 2 * @p base_size + 4096 bytes.
+ * @param state Estado del generador.
+ * @return Largo del contenido nuevo.
+ */
+static size_t edit_randomly(const uint8_t *base, size_t base_size, uint8_t *target, uint32_t *state)
+{
+    size_t edits = next_random(state) % 8 + 1;
+    size_t pos = 0;
+    size_t size = 0;
+    for (size_t e = 0; e < edits && pos < base_size; e++)
+    {
+        size_t keep = next_random(state) % (base_size - pos + 1) / 2;
+        memcpy(target + size, base + pos, keep);
+        size += keep;
+        pos += keep;
+
+        size_t len = next_random(state) % 512;
+        uint32_t kind = next_random(state) % 3;
+        if (kind != 0)
+        {
+            fill_text(target + size, len, state);
+            size += len;
+        }
+        if (kind != 1) pos += len < base_size - pos ? len : base_size - pos;
+    }
+    memcpy(target + size, base + pos, base_size - pos);
+    return size + base_size - pos;
+}
+
+/**
+ * @brief Punto de entrada de la comprobación.
+ * 
+ * @return 0 si todos los casos se comportan como se espera, 1 si no.
+ */
+int main(void)
+{
+    uint32_t state = 2463534242u;
+    uint8_t *base = (uint8_t *)malloc(CHECK_BIG_SIZE);
+    uint8_t *target = (uint8_t *)malloc(2 * CHECK_BIG_SIZE + 4096);
+    if (!base || !target)
+    {
+        perror("Error al asignar memoria");
+        return 1;
+    }
+
+    size_t created = 0;
+    for (int round = 0; round < CHECK_EDIT_ROUNDS; round++)
+    {
+        size_t base_size = round % 4 == 0 ? next_random(&state) % 256 : next_random(&state) % CHECK_MAX_SIZE;
+        fill_text(base, base_size, &state);
+        size_t target_size = edit_randomly(base, base_size, target, &state);
+        if (check_pair("ediciones", base, base_size, target, target_size, &state) > 0) created++;
+    }
+    printf("ediciones al azar: %d pares, %zu deltas\n", CHECK_EDIT_ROUNDS, created);
+
+    static const size_t short_sizes[] = { 0, 1, DELTA_BLOCK_SIZE - 1, DELTA_BLOCK_SIZE, DELTA_BLOCK_SIZE + 1 };
+    size_t short_count = sizeof(short_sizes) / sizeof(short_sizes[0]);
+    fill_text(base, DELTA_BLOCK_SIZE + 1, &state);
+    for (size_t i = 0; i < short_count; i++)
+    {
+        for (size_t j = 0; j < short_count; j++) check_pair("cortos", base, short_sizes[i], base, short_sizes[j], &state);
+    }
+    static const uint8_t empty_target[] = { 0x03, 0x00 };
+    expect(delta_apply(base, 3, empty_target, sizeof(empty_target), target, 0) == 0, "cortos", "rechazó un resultado vacío", 0);
+    static const uint8_t insert_only[] = { 0x00, 0x03, 0x03, 'a', 'b', 'c' };
+    expect(delta_apply(NULL, 0, insert_only, sizeof(insert_only), target, 3) == 0 && memcmp(target, "abc", 3) == 0,
+           "cortos", "no reconstruyó una inserción sobre una base vacía", 3);
+    check_corrupted("cortos", NULL, 0, insert_only, sizeof(insert_only), 3, &state);
+    printf("entradas cortas: %zu pares\n", short_count * short_count);
+
+    for (size_t i = 0; i < CHECK_BIG_SIZE; i++) base[i] = (uint8_t)next_random(&state);
+    static const size_t big_sizes[] = { 0x10000, 0x10001, 0xFFFF + DELTA_BLOCK_SIZE, CHECK_BIG_SIZE };
+    for (size_t i = 0; i < sizeof(big_sizes) / sizeof(big_sizes[0]); i++)
+    {
+        size_t delta_size = check_pair("copias largas", base, CHECK_BIG_SIZE, base, big_sizes[i], &state);
+        expect(delta_size > 0 && delta_size < 32, "copias largas", "no usó una sola copia", big_sizes[i]);
+    }
+    memcpy(target, base, CHECK_BIG_SIZE);
+    target[CHECK_BIG_SIZE / 2] ^= 0xFF;
+    check_pair("copias largas", base, CHECK_BIG_SIZE, target, CHECK_BIG_SIZE, &state);
+    static const uint8_t implicit_length[] = { 0x80, 0x80, 0x20, 0x80, 0x80, 0x04, 0x80 };
+    expect(delta_apply(base, CHECK_BIG_SIZE, implicit_length, sizeof(implicit_length), target, 0x10000) == 0 &&
+           memcmp(target, base, 0x10000) == 0, "copias largas", "no leyó el largo 0 como 0x10000", 0x10000);
+    check_corrupted("copias largas", base, CHECK_BIG_SIZE, implicit_length, sizeof(implicit_length), 0x10000, &state);
+    static const uint8_t past_end[] = { 0x80, 0x80, 0x20, 0x80, 0x80, 0x04, 0x84, 0x08 };
+    expect(rejected(base, CHECK_BIG_SIZE, past_end, sizeof(past_end), 0x10000), "copias largas", "aceptó una copia que se pasa de la base", 0x10000);
+    printf("copias largas: %zu casos\n", sizeof(big_sizes) / sizeof(big_sizes[0]) + 3);
+
+    free(base);
+    free(target);
+    if (failures > 0) fprintf(stderr, "Error: %lu comprobaciones fallaron.\n", failures);
+    return failures > 0;
+}
@@ -0,0 +1,278 @@
+/**
+ * @file lz_bench.c
+ * @brief Mide la velocidad (MB/s) y la razón de compresión del compresor LZ.
+ * 
+ * Se compila aparte del programa, desde la raíz del repositorio:
+ * 
+ *     gcc -O3 -I. -o lz_bench bench/lz_bench.c lz.c
+ *     ./lz_bench *.c *.h
+ * 
+ * Mide tres corpus sintéticos (bytes aleatorios, que no se comprimen; texto armado con
+ * palabras al azar; y un registro con líneas casi repetidas) en bloques de 64 KiB, y
+ * si se dan archivos, un corpus real con cada archivo como un bloque, igual que se
+ * guardan los blobs. Para cada corpus comprueba que descomprimir devuelva la entrada y
+ * muestra la razón (entrada / comprimido) y la velocidad de cada sentido.
+ * 
+ * @authors
+ * Benjamin Sanhueza (bsanhuez@umag.cl)
+ * Nicolas Mancilla (nicmanci@umag.cl)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "lz.h"
+
+#define BENCH_BYTES ((size_t)128 << 20) ///< Bytes a procesar por cada medición.
+#define BENCH_CORPUS_SIZE ((size_t)4 << 20) ///< Largo de cada corpus sintético.
+#define BENCH_BLOCK_SIZE ((size_t)64 << 10) ///< Largo de los bloques de los corpus sintéticos.
+#define BENCH_MAX_BLOCKS 4096 ///< Bloques máximos de un corpus.
+
+/**
+ * @brief Corpus dividido en bloques que se comprimen por separado.
+ */
+typedef struct Corpus
+{
+    const char *name; ///< Nombre que se muestra.
+    unsigned char *data; ///< Bytes de todos los bloques, seguidos.
+    size_t size; ///< Largo total.
+    size_t blocks[BENCH_MAX_BLOCKS]; ///< Largo de cada bloque.
+    size_t count; ///< Cantidad de bloques.
+} Corpus;
+
+/// Palabras con que se arma el texto sintético.
+static const char *const words[] = {
+    "commit", "blob", "rama", "archivo", "versión", "el", "de", "la", "que", "y", "en", "un",
+    "contenido", "repositorio", "índice", "árbol", "cambio", "se", "por", "con", "para", "no",
+    "guardar", "leer", "escribir", "hash", "delta", "pack", "mensaje", "error", "estado",
+};
+
+/**
+ * @brief Reloj monotónico en segundos.
+ * 
+ * @return Tiempo actual.
+ */
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Generador pseudoaleatorio (xorshift), para que los corpus sean siempre iguales.
+ * 
+ * @param state Estado, distinto de 0.
+ * @return Siguiente número.
+ */
+static uint32_t next_random(uint32_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+/**
+ * @brief Divide un corpus sintético en bloques de BENCH_BLOCK_SIZE.
+ * 
+ * @param corpus Corpus con sus datos ya llenos.
+ */
+static void split_blocks(Corpus *corpus)
+{
+    for (size_t pos = 0; pos < corpus->size; pos += BENCH_BLOCK_SIZE)
+    {
+        size_t len = corpus->size - pos;
+        corpus->blocks[corpus->count++] = len < BENCH_BLOCK_SIZE ? len : BENCH_BLOCK_SIZE;
+    }
+}
+
+/**
+ * @brief Llena un corpus sintético.
+ * 
+ * @param corpus Corpus con BENCH_CORPUS_SIZE bytes reservados.
+ * @param kind 0 para bytes aleatorios, 1 para texto, 2 para un registro.
+ */
+static void fill_synthetic(Corpus *corpus, int kind)
+{
+    uint32_t state = 2463534242u;
+    size_t pos = 0;
+    unsigned long line = 0;
+    while (pos < BENCH_CORPUS_SIZE)
+    {
+        char piece[128];
+        int len;
+        if (kind == 0)
+        {
+            uint32_t value = next_random(&state);
+            memcpy(piece, &value, sizeof(value));
+            len = (int)sizeof(value);
+        }
+        else if (kind == 1)
+        {
+            uint32_t value = next_random(&state);
+            const char *word = words[value % (sizeof(words) / sizeof(words[0]))];
+            len = snprintf(piece, sizeof(piece), "%s%s", word, value % 11 == 0 ? ".\n" : " ");
+        }
+        else
+        {
+            uint32_t value = next_random(&state);
+            len = snprintf(piece, sizeof(piece), "2024-05-%02u 12:%02u:%02u commit %06lu agregado archivo%u.txt (%u bytes)\n",
+                           value % 28 + 1, value / 28 % 60, value / 1680 % 60, line++, value % 97, value % 65536);
+        }
+        size_t copy = BENCH_CORPUS_SIZE - pos < (size_t)len ? BENCH_CORPUS_SIZE - pos : (size_t)len;
+        memcpy(corpus->data + pos, piece, copy);
+        pos += copy;
+    }
+    corpus->size = BENCH_CORPUS_SIZE;
+    split_blocks(corpus);
+}
+
+/**
+ * @brief Arma un corpus con archivos, uno por bloque.
+ * 
+ * @param corpus Corpus vacío.
+ * @param paths Rutas de los archivos.
+ * @param count Cantidad de rutas.
+ * @return 0 en caso de éxito, -1 si no se pudo leer alguno o no hay memoria.
+ */
+static int load_files(Corpus *corpus, char *const *paths, size_t count)
+{
+    for (size_t i = 0; i < count && corpus->count < BENCH_MAX_BLOCKS; i++)
+    {
+        FILE *file = fopen(paths[i], "rb");
+        if (!file || fseek(file, 0, SEEK_END) != 0)
+        {
+            perror(paths[i]);
+            if (file) fclose(file);
+            return -1;
+        }
+        long len = ftell(file);
+        rewind(file);
+        unsigned char *data = len >= 0 ? (unsigned char *)realloc(corpus->data, corpus->size + (size_t)len + 1) : NULL;
+        if (!data || fread(data + corpus->size, 1, (size_t)len, file) != (size_t)len)
+        {
+            perror(paths[i]);
+            fclose(file);
+            if (data) corpus->data = data;
+            return -1;
+        }
+        fclose(file);
+        corpus->data = data;
+        corpus->size += (size_t)len;
+        corpus->blocks[corpus->count++] = (size_t)len;
+    }
+    return 0;
+}
+
+/**
+ * @brief Comprime y descomprime un corpus hasta procesar BENCH_BYTES en cada sentido.
+ * 
+ * @param corpus Corpus.
+ * @return 0 si la descompresión devolvió la entrada, 1 si no o no hay memoria.
+ */
+static int measure(const Corpus *corpus)
+{
+    size_t capacity = 0;
+    for (size_t i = 0; i < corpus->count; i++) capacity += lz_bound(corpus->blocks[i]);
+    unsigned char *packed = (unsigned char *)malloc(capacity);
+    unsigned char *output = (unsigned char *)malloc(corpus->size + 1);
+    size_t *lengths = (size_t *)malloc(corpus->count * sizeof(size_t) + 1);
+    if (!packed || !output || !lengths)
+    {
+        perror("Error al asignar memoria");
+        free(packed);
+        free(output);
+        free(lengths);
+        return 1;
+    }
+
+    size_t rounds = corpus->size > 0 ? BENCH_BYTES / corpus->size + 1 : 1;
+    size_t packed_size = 0;
+    double start = now();
+    for (size_t r = 0; r < rounds; r++)
+    {
+        const unsigned char *in = corpus->data;
+        unsigned char *out = packed;
+        for (size_t i = 0; i < corpus->count; i++)
+        {
+            lengths[i] = lz_compress(in, corpus->blocks[i], out, lz_bound(corpus->blocks[i]));
+            in += corpus->blocks[i];
+            out += lengths[i];
+        }
+        packed_size = (size_t)(out - packed);
+    }
+    double compress_time = now() - start;
+
+    int failed = 0;
+    start = now();
+    for (size_t r = 0; r < rounds && !failed; r++)
+    {
+        const unsigned char *in = packed;
+        unsigned char *out = output;
+        for (size_t i = 0; i < corpus->count && !failed; i++)
+        {
+            failed = lz_decompress(in, lengths[i], out, corpus->blocks[i]) != 0;
+            in += lengths[i];
+            out += corpus->blocks[i];
+        }
+    }
+    double decompress_time = now() - start;
+    if (!failed && corpus->size > 0) failed = memcmp(output, corpus->data, corpus->size) != 0;
+
+    double processed = (double)(rounds * corpus->size) / 1e6;
+    printf("%-10s %10zu %10zu %7.2f %10.0f %10.0f\n", corpus->name, corpus->size, packed_size,
+           packed_size > 0 ? (double)corpus->size / (double)packed_size : 0.0,
+           processed / compress_time, processed / decompress_time);
+    free(packed);
+    free(output);
+    free(lengths);
+    return failed;
+}
+
+/**
+ * @brief Punto de entrada del benchmark.
+ * 
+ * @param argc Cantidad de argumentos.
+ * @param argv Archivos que forman el corpus real (opcionales).
+ * @return 0 si todos los corpus se descomprimen bien, 1 si no.
+ */
+int main(int argc, char **argv)
+{
+    static Corpus corpus;
+    static const char *const names[] = { "aleatorio", "texto", "registro" };
+    int failed = 0;
+    printf("%-10s %10s %10s %7s %10s %10s\n", "corpus", "bytes", "comprimido", "razón", "comp MB/s", "desc MB/s");
+
+    for (int kind = 0; kind < 3; kind++)
+    {
+        memset(&corpus, 0, sizeof(corpus));
+        corpus.name = names[kind];
+        corpus.data = (unsigned char *)malloc(BENCH_CORPUS_SIZE);
+        if (!corpus.data)
+        {
+            perror("Error al asignar memoria");
+            return 1;
+        }
+        fill_synthetic(&corpus, kind);
+        failed |= measure(&corpus);
+        free(corpus.data);
+    }
+
+    if (argc > 1)
+    {
+        memset(&corpus, 0, sizeof(corpus));
+        corpus.name = "archivos";
+        if (load_files(&corpus, argv + 1, (size_t)(argc - 1)) != 0)
+        {
+            free(corpus.data);
+            return 1;
+        }
+        failed |= measure(&corpus);
+        free(corpus.data);
+    }
+
+    if (failed) fprintf(stderr, "Error: la descompresión no devolvió la entrada.\n");
+    return failed;
+}
@@ -0,0 +1,123 @@
+/**
+ * @file sha1_bench.c
+ * @brief Compara el rendimiento de las versiones de SHA-1 (GB/s por tamaño de entrada).
+ * 
+ * Se compila aparte del programa, desde la raíz del repositorio:
+ * 
+ *     gcc -O3 -I. -o sha1_bench bench/sha1_bench.c sha1.c
+ * 
+ * Para cada versión que soporte el procesador calcula el hash de entradas de varios
+ * tamaños, comprueba que todas den el mismo resultado y muestra su velocidad y la razón
+ * respecto de la versión portable.
+ * 
+ * @authors
+ * Benjamin Sanhueza (bsanhuez@umag.cl)
+ * Nicolas Mancilla (nicmanci@umag.cl)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sha1.h"
+
+#define BENCH_BYTES ((size_t)256 << 20) ///< Bytes a procesar por cada medición.
+#define BENCH_MAX_SIZE ((size_t)1 << 20) ///< Tamaño de la entrada más grande.
+
+/// Versiones a comparar; la primera es la referencia.
+static const char *const implementations[] = { "scalar", "sha-ni" };
+
+/// Tamaños de entrada medidos, desde un objeto pequeño (un commit) hasta un archivo grande.
+static const size_t sizes[] = { 64, 256, 1024, 8192, 65536, BENCH_MAX_SIZE };
+
+/**
+ * @brief Reloj monotónico en segundos.
+ * 
+ * @return Tiempo actual.
+ */
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Calcula el hash de una entrada varias veces, hasta procesar BENCH_BYTES.
+ * 
+ * @param data Entrada.
+ * @param size Largo de la entrada.
+ * @param digest Hash de la entrada (el último calculado).
+ * @return Velocidad en GB/s.
+ */
+static double measure(const unsigned char *data, size_t size, unsigned char digest[SHA1_DIGEST_SIZE])
+{
+    size_t rounds = BENCH_BYTES / size;
+    double start = now();
+    for (size_t i = 0; i < rounds; i++)
+    {
+        SHA1Context ctx;
+        sha1_init(&ctx);
+        sha1_update(&ctx, data, size);
+        sha1_final(&ctx, digest);
+    }
+    double elapsed = now() - start;
+    return (double)(rounds * size) / elapsed / 1e9;
+}
+
+/**
+ * @brief Punto de entrada del benchmark.
+ * 
+ * @return 0 si todas las versiones coinciden, 1 si no.
+ */
+int main(void)
+{
+    unsigned char *data = (unsigned char *)malloc(BENCH_MAX_SIZE);
+    if (!data)
+    {
+        perror("Error al asignar memoria");
+        return 1;
+    }
+    for (size_t i = 0; i < BENCH_MAX_SIZE; i++) data[i] = (unsigned char)(i * 2654435761u >> 13);
+
+    size_t count = sizeof(implementations) / sizeof(implementations[0]);
+    int failed = 0;
+    printf("%10s", "bytes");
+    for (size_t j = 0; j < count; j++) printf(" %12s", implementations[j]);
+    printf("\n");
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        unsigned char reference[SHA1_DIGEST_SIZE];
+        double base = 0;
+        printf("%10zu", sizes[i]);
+        for (size_t j = 0; j < count; j++)
+        {
+            unsigned char digest[SHA1_DIGEST_SIZE];
+            if (sha1_use_implementation(implementations[j]) != 0)
+            {
+                printf(" %12s", "-");
+                continue;
+            }
+            double speed = measure(data, sizes[i], digest);
+            if (j == 0)
+            {
+                memcpy(reference, digest, SHA1_DIGEST_SIZE);
+                base = speed;
+                printf(" %7.2f GB/s", speed);
+            }
+            else
+            {
+                if (memcmp(reference, digest, SHA1_DIGEST_SIZE) != 0) failed = 1;
+                printf(" %5.2f (x%.1f)", speed, speed / base);
+            }
+        }
+        printf("\n");
+    }
+
+    sha1_use_implementation(NULL);
+    printf("En uso: %s\n", sha1_implementation());
+    if (failed) fprintf(stderr, "Error: las versiones no coinciden.\n");
+    free(data);
+    return failed;
+}
@@ -0,0 +1,616 @@
+/**
+ * @file blob.c
+ * @brief Implementación de la tabla de blobs y del acceso al árbol de trabajo.
+ * 
+ * @authors
+ * Benjamin Sanhueza (bsanhuez@umag.cl)
+ * Nicolas Mancilla (nicmanci@umag.cl)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "blob.h"
+#include "delta.h"
+#include "lz.h"
+#include "output.h"
+
+#define BLOB_FILE_MODE 0644 ///< Permisos de un archivo que no existía (los blobs no guardan permisos).
+
+static const void *load_content(const BlobStore *store, uint32_t blob, void **buffer, int report);
+
+/**
+ * @brief Cantidad de blobs guardados.
+ * 
+ * @param store Tabla de blobs.
+ * @return Cantidad de registros.
+ */
+uint32_t blob_count(const BlobStore *store)
+{
+    return (uint32_t)(segment_size(store->records) / sizeof(BlobRecord));
+}
+
+/**
+ * @brief Obtiene el registro de un blob.
+ * 
+ * @param store Tabla de blobs.
+ * @param blob Índice del blob.
+ * @return Registro del blob.
+ */
+const BlobRecord *blob_record(const BlobStore *store, uint32_t blob)
+{
+    return (const BlobRecord *)segment_at(store->records, (size_t)blob * sizeof(BlobRecord));
+}
+
+/**
+ * @brief Busca un blob por su identificador.
+ * 
+ * Los blobs agregados desde el último repack están en la tabla hash; los demás se
+ * buscan en el índice ordenado del pack.
+ * 
+ * @param store Tabla de blobs.
+ * @param id Identificador de blob.
+ * @return Índice del blob, o BLOB_NONE si no está guardado.
+ */
+uint32_t blob_find(const BlobStore *store, const object_id *id)
+{
+    uint32_t ref = objtable_find(&store->index, id);
+    if (ref != 0) return ref - 1;
+
+    uint32_t position = pack_find(&store->pack, id);
+    if (position == PACK_NONE) return BLOB_NONE;
+    uint32_t blob = store->pack.entries[position].blob;
+    return blob < blob_count(store) ? blob : BLOB_NONE;
+}
+
+/**
+ * @brief Obtiene los bytes guardados de un blob.
+ * 
+ * @param store Tabla de blobs.
+ * @param blob Índice del blob.
+ * @return Bytes guardados, o NULL si el pack no los tiene.
+ */
+const void *blob_stored(const BlobStore *store, uint32_t blob)
+{
+    const BlobRecord *record = blob_record(store, blob);
+    if (!(record->flags & BLOB_PACKED)) return record->length > 0 ? segment_at(store->data, (size_t)record->offset) : "";
+
+    uint32_t length;
+    const void *bytes = record->offset < PACK_NONE ? pack_object(&store->pack, (uint32_t)record->offset, &length) : NULL;
+    return bytes != NULL && length == record->length ? bytes : NULL;
+}
+
+/**
+ * @brief Calcula el delta de un contenido contra un blob base, si conviene guardarlo así.
+ * 
+ * @param store Tabla de blobs.
+ * @param base Blob base, o BLOB_NONE.
+ * @param content Contenido nuevo.
+ * @param size Largo del contenido nuevo.
+ * @param delta Delta resultante (se libera con free()).
+ * @return Largo del delta, o 0 si no hay base, la cadena ya es muy larga, la base no se
+ *         puede leer o el delta ocupa más de la mitad del contenido.
+ */
+static size_t blob_delta(const BlobStore *store, uint32_t base, const void *content, size_t size, uint8_t **delta)
+{
+    if (base == BLOB_NONE || blob_record(store, base)->depth >= BLOB_MAX_DEPTH) return 0;
+
+    void *buffer;
+    const void *base_content = load_content(store, base, &buffer, 0);
+    if (!base_content) return 0;
+    size_t len = delta_create((const uint8_t *)base_content, blob_record(store, base)->size,
+                              (const uint8_t *)content, size, size / 2, delta);
+    free(buffer);
+    return len;
+}
+
+/**
+ * @brief Comprime los bytes a guardar de un blob, si eso ahorra al menos un octavo.
+ * 
+ * @param bytes Bytes a guardar (el contenido o su delta).
+ * @param len Largo de los bytes.
+ * @param packed Bytes comprimidos (se liberan con free()).
+ * @return Largo comprimido, o 0 si los bytes son cortos, no se comprimen lo suficiente
+ *         o no hay memoria (y se guardan tal cual).
+ */
+static size_t blob_compress(const void *bytes, size_t len, uint8_t **packed)
+{
+    *packed = NULL;
+    if (len < BLOB_COMPRESS_MIN) return 0;
+
+    size_t capacity = len - len / 8;
+    *packed = (uint8_t *)malloc(capacity);
+    if (!*packed) return 0;
+    size_t packed_len = lz_compress((const uint8_t *)bytes, len, *packed, capacity);
+    if (packed_len == 0)
+    {
+        free(*packed);
+        *packed = NULL;
+    }
+    return packed_len;
+}
+
+/**
+ * @brief Arma los bytes a guardar de un contenido: su delta contra la base si conviene,
+ *        comprimido si eso ahorra espacio.
+ * 
+ * Solo lee la tabla de blobs, así que puede correr en un hilo lector mientras otro
+ * agrega blobs. Si el contenido ya está guardado no se calcula nada.
+ * 
+ * @param store Tabla de blobs.
+ * @param id Identificador de blob del contenido.
+ * @param content Contenido (debe seguir disponible hasta guardar los bytes).
+ * @param size Largo del contenido.
+ * @param base Blob con una versión anterior del mismo archivo, o BLOB_NONE.
+ * @param prepared Bytes resultantes.
+ */
+void blob_prepare(const BlobStore *store, const object_id *id, const void *content, size_t size, uint32_t base, BlobBytes *prepared)
+{
+    memset(prepared, 0, sizeof(*prepared));
+    BlobRecord *record = &prepared->record;
+    record->id = *id;
+    record->size = (uint32_t)size;
+    record->base = BLOB_NONE;
+    record->length = (uint32_t)size;
+    record->raw_length = (uint32_t)size;
+    prepared->bytes = content;
+    if (blob_find(store, id) != BLOB_NONE) return;
+
+    uint8_t *delta = NULL;
+    size_t delta_len = blob_delta(store, base, content, size, &delta);
+    if (delta_len > 0)
+    {
+        record->base = base;
+        record->length = (uint32_t)delta_len;
+        record->raw_length = (uint32_t)delta_len;
+        record->depth = (uint16_t)(blob_record(store, base)->depth + 1);
+        prepared->bytes = delta;
+        prepared->buffer = delta;
+    }
+
+    uint8_t *packed;
+    size_t packed_len = blob_compress(prepared->bytes, record->length, &packed);
+    if (packed_len > 0)
+    {
+        free(delta);
+        record->flags |= BLOB_COMPRESSED;
+        record->length = (uint32_t)packed_len;
+        prepared->bytes = packed;
+        prepared->buffer = packed;
+    }
+}
+
+/**
+ * @brief Guarda los bytes armados por blob_prepare(), o reutiliza el blob que ya tiene
+ *        el contenido.
+ * 
+ * Los bytes se agregan antes que el registro, y el registro antes que la entrada del
+ * índice. Si algo falla se quita el registro; los bytes quedan en el segmento sin que
+ * ningún registro los use.
+ * 
+ * @param store Tabla de blobs.
+ * @param prepared Bytes y registro del blob.
+ * @param blob Índice del blob resultante.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+int blob_add_prepared(BlobStore *store, const BlobBytes *prepared, uint32_t *blob)
+{
+    BlobRecord record = prepared->record;
+    uint32_t found = blob_find(store, &record.id);
+    if (found != BLOB_NONE)
+    {
+        *blob = found;
+        return 0;
+    }
+
+    size_t offset;
+    if (segment_append(store->data, prepared->bytes, record.length, &offset) != 0) return -1;
+    record.offset = offset;
+
+    uint32_t position = blob_count(store);
+    if (segment_append(store->records, &record, sizeof(record), NULL) != 0) return -1;
+    if (objtable_insert(&store->index, &record.id, position + 1) < 0)
+    {
+        store->records->tail_len -= sizeof(record);
+        return -1;
+    }
+    *blob = position;
+    return 0;
+}
+
+/**
+ * @brief Guarda un contenido como blob, o reutiliza el blob que ya lo tiene.
+ * 
+ * @param store Tabla de blobs.
+ * @param content Contenido.
+ * @param size Largo del contenido.
+ * @param base Blob con una versión anterior del mismo archivo, o BLOB_NONE.
+ * @param blob Índice del blob resultante.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+int blob_add(BlobStore *store, const void *content, size_t size, uint32_t base, uint32_t *blob)
+{
+    object_id id;
+    object_hash("blob", content, size, &id);
+    BlobBytes prepared;
+    blob_prepare(store, &id, content, size, base, &prepared);
+    int result = blob_add_prepared(store, &prepared, blob);
+    free(prepared.buffer);
+    return result;
+}
+
+/**
+ * @brief Obtiene el contenido de un blob, descomprimiéndolo y reconstruyéndolo si está
+ *        guardado como delta.
+ * 
+ * Los bytes comprimidos se descomprimen primero, sean el contenido o el delta. Un
+ * delta se aplica sobre el contenido reconstruido de su base, que a su vez puede
+ * ser un delta; la profundidad está acotada por BLOB_MAX_DEPTH.
+ * 
+ * @param store Tabla de blobs.
+ * @param blob Índice del blob.
+ * @param buffer Memoria reservada para el resultado (NULL si no hizo falta).
+ * @param report 1 para informar los errores, 0 para solo devolver NULL.
+ * @return Contenido, o NULL si no hay memoria o el delta está dañado.
+ */
+static const void *load_content(const BlobStore *store, uint32_t blob, void **buffer, int report)
+{
+    const BlobRecord *record = blob_record(store, blob);
+    *buffer = NULL;
+    const void *stored = blob_stored(store, blob);
+    if (!stored)
+    {
+        if (report) output_error("Error: El contenido de un archivo no está en el pack.\n");
+        return NULL;
+    }
+
+    size_t stored_len = record->length;
+    void *raw = NULL;
+    if (record->flags & BLOB_COMPRESSED)
+    {
+        raw = malloc((size_t)record->raw_length + 1);
+        if (!raw)
+        {
+            perror("Error al asignar memoria para el contenido");
+            return NULL;
+        }
+        if ((record->base == BLOB_NONE && record->raw_length != record->size) ||
+            lz_decompress((const uint8_t *)stored, record->length, (uint8_t *)raw, record->raw_length) != 0)
+        {
+            if (report) output_error("Error: El contenido de un archivo está dañado.\n");
+            free(raw);
+            return NULL;
+        }
+        stored = raw;
+        stored_len = record->raw_length;
+    }
+    if (record->base == BLOB_NONE)
+    {
+        *buffer = raw;
+        return stored;
+    }
+
+    void *base_buffer;
+    const void *base = load_content(store, record->base, &base_buffer, report);
+    if (!base)
+    {
+        free(raw);
+        return NULL;
+    }
+
+    *buffer = malloc((size_t)record->size + 1);
+    if (!*buffer)
+    {
+        perror("Error al asignar memoria para el contenido");
+        free(base_buffer);
+        free(raw);
+        return NULL;
+    }
+    int result = delta_apply((const uint8_t *)base, blob_record(store, record->base)->size, (const uint8_t *)stored,
+                             stored_len, (uint8_t *)*buffer, record->size);
+    free(base_buffer);
+    free(raw);
+    if (result != 0)
+    {
+        if (report) output_error("Error: El contenido de un archivo está dañado.\n");
+        free(*buffer);
+        *buffer = NULL;
+        return NULL;
+    }
+    return *buffer;
+}
+
+/**
+ * @brief Obtiene el contenido de un blob, informando los errores.
+ * 
+ * @param store Tabla de blobs.
+ * @param blob Índice del blob.
+ * @param buffer Memoria reservada para el resultado (NULL si no hizo falta).
+ * @return Contenido, o NULL si no hay memoria o el delta está dañado.
+ */
+const void *blob_content(const BlobStore *store, uint32_t blob, void **buffer)
+{
+    return load_content(store, blob, buffer, 1);
+}
+
+/**
+ * @brief Lee un archivo regular completo a memoria, sin escribir mensajes.
+ * 
+ * @param path Ruta del archivo.
+ * @param content Contenido leído (se libera con free()).
+ * @param size Largo del contenido.
+ * @param info Datos de stat del archivo abierto (puede ser NULL).
+ * @return 0 en caso de éxito, o el código errno de la falla.
+ */
+int blob_load(const char *path, char **content, size_t *size, struct stat *info)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file) return errno;
+
+    struct stat own;
+    if (!info) info = &own;
+    int error = 0;
+    if (fstat(fileno(file), info) != 0) error = errno;
+    else if (!S_ISREG(info->st_mode)) error = EISDIR;
+    else if ((uint64_t)info->st_size > BLOB_MAX_SIZE) error = EFBIG;
+    if (error != 0)
+    {
+        fclose(file);
+        return error;
+    }
+
+    *size = (size_t)info->st_size;
+    *content = (char *)malloc(*size + 1);
+    if (!*content)
+    {
+        fclose(file);
+        return ENOMEM;
+    }
+
+    size_t len = fread(*content, 1, *size, file);
+    if (ferror(file) || len != *size) error = EIO;
+    fclose(file);
+    if (error != 0) free(*content);
+    return error;
+}
+
+/**
+ * @brief Informa por qué no se pudo leer un archivo.
+ * 
+ * @param path Ruta del archivo, tal como se muestra al usuario.
+ * @param error Código devuelto por blob_load().
+ */
+void blob_load_error(const char *path, int error)
+{
+    if (error == ENOENT)
+    {
+        output_error("Archivo no encontrado: {path:s}\n", path);
+    }
+    else if (error == EISDIR || error == EFBIG)
+    {
+        output_error("Error: {path:s} no es un archivo regular o es demasiado grande.\n", path);
+    }
+    else
+    {
+        output_error("Error: No se pudo leer {path:s}: {reason:s}\n", path, strerror(error));
+    }
+}
+
+/**
+ * @brief Lee un archivo regular completo a memoria, informando las fallas.
+ * 
+ * @param path Ruta del archivo.
+ * @param content Contenido leído (se libera con free()).
+ * @param size Largo del contenido.
+ * @param info Datos de stat del archivo (puede ser NULL).
+ * @return 0 en caso de éxito, 1 si el archivo no existe, -1 si ocurrió un error.
+ */
+static int read_file(const char *path, char **content, size_t *size, struct stat *info)
+{
+    int error = blob_load(path, content, size, info);
+    if (error == 0) return 0;
+    if (error == ENOENT) return 1;
+
+    blob_load_error(path, error);
+    return -1;
+}
+
+/**
+ * @brief Lee un archivo del árbol de trabajo y lo guarda como blob.
+ * 
+ * @param store Tabla de blobs.
+ * @param path Ruta del archivo.
+ * @param base Blob con una versión anterior del archivo, o BLOB_NONE.
+ * @param blob Índice del blob resultante.
+ * @param info Datos de stat del archivo leído (puede ser NULL).
+ * @return 0 en caso de éxito, 1 si el archivo no existe, -1 si ocurrió un error.
+ */
+int blob_read_file(BlobStore *store, const char *path, uint32_t base, uint32_t *blob, struct stat *info)
+{
+    char *content;
+    size_t size;
+    int result = read_file(path, &content, &size, info);
+    if (result != 0) return result;
+
+    result = blob_add(store, content, size, base, blob);
+    free(content);
+    return result;
+}
+
+/**
+ * @brief Indica si un archivo del árbol de trabajo tiene el contenido de un blob.
+ * 
+ * Solo calcula el hash del archivo; no lo guarda.
+ * 
+ * @param store Tabla de blobs.
+ * @param blob Índice del blob, o BLOB_NONE.
+ * @param path Ruta del archivo.
+ * @return 1 si coinciden o el archivo no existe, 0 si no coinciden, -1 si ocurrió un error.
+ */
+int blob_file_matches(const BlobStore *store, uint32_t blob, const char *path)
+{
+    char *content;
+    size_t size;
+    int result = read_file(path, &content, &size, NULL);
+    if (result != 0) return result > 0 ? 1 : -1;
+    if (blob == BLOB_NONE)
+    {
+        free(content);
+        return 0;
+    }
+
+    object_id id;
+    object_hash("blob", content, size, &id);
+    free(content);
+    return memcmp(id.hash, blob_record(store, blob)->id.hash, SHA1_DIGEST_SIZE) == 0;
+}
+
+/**
+ * @brief Crea los directorios que faltan antes del último componente de una ruta.
+ * 
+ * @param path Ruta de un archivo.
+ * @return 0 en caso de éxito, -1 si no se pudo crear alguno.
+ */
+static int make_parents(const char *path)
+{
+    char *copy = (char *)malloc(strlen(path) + 1);
+    if (!copy)
+    {
+        perror("Error al asignar memoria para la ruta");
+        return -1;
+    }
+    strcpy(copy, path);
+
+    int result = 0;
+    for (char *slash = strchr(copy + 1, '/'); slash != NULL && result == 0; slash = strchr(slash + 1, '/'))
+    {
+        *slash = '\0';
+        if (mkdir(copy, 0755) != 0 && errno != EEXIST)
+        {
+            output_error("Error: No se pudo crear el directorio {path:s}: {reason:s}\n", copy, strerror(errno));
+            result = -1;
+        }
+        *slash = '/';
+    }
+    free(copy);
+    return result;
+}
+
+/**
+ * @brief Escribe el contenido de un blob en un archivo del árbol de trabajo.
+ * 
+ * Escribe primero un archivo temporal con nombre único (mkstemp) junto al destino y
+ * luego lo renombra, así una falla no deja el archivo a medio escribir y no se pisa
+ * ningún otro archivo del árbol de trabajo. El archivo nuevo conserva los permisos del
+ * que reemplaza.
+ * 
+ * @param store Tabla de blobs.
+ * @param blob Índice del blob.
+ * @param path Ruta del archivo.
+ * @return 0 en caso de éxito, -1 si ocurrió un error.
+ */
+int blob_write_file(const BlobStore *store, uint32_t blob, const char *path)
+{
+    if (make_parents(path) != 0) return -1;
+
+    char *temp_path = (char *)malloc(strlen(path) + sizeof(".XXXXXX"));
+    if (!temp_path)
+    {
+        perror("Error al asignar memoria para la ruta");
+        return -1;
+    }
+    sprintf(temp_path, "%s.XXXXXX", path);
+
+    struct stat info;
+    mode_t mode = stat(path, &info) == 0 && S_ISREG(info.st_mode) ? info.st_mode & 07777 : BLOB_FILE_MODE;
+
+    const BlobRecord *record = blob_record(store, blob);
+    void *buffer;
+    const void *content = blob_content(store, blob, &buffer);
+    if (!content)
+    {
+        free(temp_path);
+        return -1;
+    }
+
+    int fd = mkstemp(temp_path);
+    FILE *file = fd >= 0 ? fdopen(fd, "wb") : NULL;
+    if (fd >= 0 && !file) close(fd);
+    int failed = !file;
+    if (file)
+    {
+        if (fchmod(fd, mode) != 0) failed = 1;
+        if (record->size > 0 && fwrite(content, 1, record->size, file) != record->size) failed = 1;
+        if (fclose(file) != 0) failed = 1;
+    }
+    free(buffer);
+    if (failed || rename(temp_path, path) != 0)
+    {
+        output_error("Error: No se pudo escribir {path:s}: {reason:s}\n", path, strerror(errno));
+        if (fd >= 0) remove(temp_path);
+        free(temp_path);
+        return -1;
+    }
+    free(temp_path);
+    return 0;
+}
+
+/**
+ * @brief Comprueba que los registros y el índice cargados desde disco son coherentes.
+ * 
+ * Los bytes de un blob que no está en el pack deben caber en el segmento de datos, y
+ * la base de un delta debe ser un blob anterior, lo que descarta los ciclos al
+ * reconstruirlo. Los blobs del pack se comprueban al leerlos.
+ * 
+ * @param store Tabla de blobs.
+ * @return 1 si son válidos, 0 si no.
+ */
+int blob_valid(const BlobStore *store)
+{
+    uint32_t count = blob_count(store);
+    size_t data_size = segment_size(store->data);
+    if (segment_size(store->records) % sizeof(BlobRecord) != 0) return 0;
+    for (uint32_t blob = 0; blob < count; blob++) 
+    {
+        const BlobRecord *record = blob_record(store, blob);
+        if (record->flags & ~(BLOB_PACKED | BLOB_COMPRESSED)) return 0;
+        if (record->base != BLOB_NONE && (record->base >= blob || record->depth > BLOB_MAX_DEPTH)) return 0;
+        if (record->base == BLOB_NONE && !(record->flags & BLOB_COMPRESSED) && record->length != record->size) return 0;
+        if (!(record->flags & BLOB_PACKED) && (record->offset > data_size || record->length > data_size - record->offset)) return 0;
+    }
+    return objtable_valid(&store->index, count);
+}
+
+/**
+ * @brief Agrega al índice los blobs sueltos que el archivo guardó sin indexar.
+ * 
+ * Los blobs del pack no van en el índice: se buscan en el del pack.
+ * 
+ * @param store Tabla de blobs.
+ * @param first Primer blob que falta en el índice.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+int blob_reindex(BlobStore *store, uint32_t first)
+{
+    uint32_t count = blob_count(store);
+    for (uint32_t blob = first; blob < count; blob++)
+    {
+        const BlobRecord *record = blob_record(store, blob);
+        if (!(record->flags & BLOB_PACKED) && objtable_insert(&store->index, &record->id, blob + 1) < 0) return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Libera el índice de la tabla y cierra el pack.
+ * 
+ * @param store Tabla de blobs.
+ */
+void blob_free(BlobStore *store)
+{
+    objtable_free(&store->index);
+    pack_close(&store->pack);
+}
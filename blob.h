@@ -0,0 +1,257 @@
+/**
+ * @file blob.h
+ * @brief Contenido de los archivos (blobs) y su lectura y escritura en el árbol de trabajo.
+ * 
+ * Cada versión distinta del contenido de un archivo se guarda una sola vez como un blob,
+ * identificado igual que en Git por el hash de "blob <largo>\0" más el contenido. Los
+ * bytes van seguidos en un segmento de datos y cada blob tiene un registro de ancho fijo
+ * con su identificador, su posición y su largo; los árboles referencian el blob por el
+ * índice de ese registro. Como el resto de las tablas, todo se guarda y se mapea tal cual.
+ * 
+ * Una versión nueva de un archivo puede guardarse como delta contra la versión anterior
+ * (ver delta.h) cuando el delta ocupa a lo más la mitad del contenido. Las cadenas de
+ * deltas tienen a lo más BLOB_MAX_DEPTH eslabones, así reconstruir un contenido cuesta
+ * a lo más esa cantidad de deltas aplicados.
+ * 
+ * Después de un repack (ver pack.h) los bytes de los blobs viven en el pack y el
+ * registro de cada uno guarda su posición en el índice del pack.
+ * 
+ * Los bytes guardados (el contenido o el delta) se comprimen con lz.h cuando eso ahorra
+ * al menos un octavo; si no, por ejemplo en datos ya comprimidos, quedan tal cual. La
+ * marca BLOB_COMPRESSED de cada registro indica cuál de los dos casos es.
+ * 
+ * @authors
+ * - Benjamin Sanhueza (bsanhuez@umag.cl)
+ * - Nicolas Mancilla (nicmanci@umag.cl)
+ */
+
+#ifndef BLOB_H
+#define BLOB_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "objstore.h"
+#include "store.h"
+#include "pack.h"
+
+struct stat;
+
+#define BLOB_NONE UINT32_MAX ///< Índice que indica la ausencia de blob (archivo que no existe).
+#define BLOB_MAX_SIZE UINT32_MAX ///< Largo máximo del contenido de un archivo.
+#define BLOB_MAX_DEPTH 10 ///< Deltas máximos encadenados hasta un contenido completo.
+#define BLOB_PACKED 1u ///< Marca de un blob cuyos bytes están en el pack.
+#define BLOB_COMPRESSED 2u ///< Marca de un blob cuyos bytes guardados están comprimidos.
+#define BLOB_COMPRESS_MIN 64 ///< Largo mínimo de los bytes para intentar comprimirlos.
+
+/**
+ * @brief Registro de un blob, indexado por su posición en la tabla de blobs.
+ */
+typedef struct BlobRecord 
+{
+    object_id id; ///< Identificador del blob (hash de su contenido).
+    uint32_t size; ///< Largo del contenido en bytes.
+    uint64_t offset; ///< Inicio de los bytes guardados en el segmento de datos, o posición en el pack con BLOB_PACKED.
+    uint32_t length; ///< Bytes guardados: el contenido completo, o el delta si hay @c base, comprimidos con BLOB_COMPRESSED.
+    uint32_t base; ///< Blob contra el que está el delta, o BLOB_NONE si se guardó completo.
+    uint16_t depth; ///< Deltas que hay que aplicar para reconstruir el contenido (0 si está completo).
+    uint16_t flags; ///< BLOB_PACKED si los bytes están en el pack, BLOB_COMPRESSED si están comprimidos.
+    uint32_t raw_length; ///< Largo del contenido o del delta antes de comprimirlo.
+} BlobRecord;
+
+/**
+ * @brief Bytes de un blob listos para guardar, armados fuera de la tabla de blobs.
+ */
+typedef struct BlobBytes 
+{
+    BlobRecord record; ///< Registro del blob, salvo @c offset.
+    const void *bytes; ///< Bytes a guardar (@c record.length): el contenido o su delta, comprimidos si conviene.
+    uint8_t *buffer; ///< Memoria propia de @c bytes, o NULL si son el contenido original.
+} BlobBytes;
+
+/**
+ * @brief Tabla de blobs con su índice por identificador.
+ * 
+ * El índice permite reutilizar un blob cuando se agrega un archivo con un contenido
+ * que ya estaba guardado, por ejemplo al volver a agregar un archivo sin cambios.
+ */
+typedef struct BlobStore 
+{
+    Segment *records; ///< BlobRecord por índice.
+    Segment *data; ///< Contenido de los blobs, uno tras otro.
+    ObjectTable index; ///< Identificador a blob (índice + 1) de los blobs que no están en el pack.
+    PackFile pack; ///< Pack con los blobs empaquetados (vacío si no hay).
+} BlobStore;
+
+/**
+ * @brief Cantidad de blobs guardados.
+ * 
+ * @param store Tabla de blobs.
+ * @return Cantidad de registros.
+ */
+uint32_t blob_count(const BlobStore *store);
+
+/**
+ * @brief Obtiene el registro de un blob.
+ * 
+ * @param store Tabla de blobs.
+ * @param blob Índice menor que blob_count().
+ * @return Registro del blob.
+ */
+const BlobRecord *blob_record(const BlobStore *store, uint32_t blob);
+
+/**
+ * @brief Busca un blob por su identificador, en la tabla de blobs y en el pack.
+ * 
+ * @param store Tabla de blobs.
+ * @param id Identificador de blob.
+ * @return Índice del blob, o BLOB_NONE si no está guardado.
+ */
+uint32_t blob_find(const BlobStore *store, const object_id *id);
+
+/**
+ * @brief Obtiene los bytes guardados de un blob (el contenido completo o su delta, tal
+ *        vez comprimidos).
+ * 
+ * @param store Tabla de blobs.
+ * @param blob Índice del blob.
+ * @return Bytes guardados (blob_record()->length), o NULL si el pack no los tiene.
+ */
+const void *blob_stored(const BlobStore *store, uint32_t blob);
+
+/**
+ * @brief Arma los bytes a guardar de un contenido cuyo identificador ya se calculó.
+ * 
+ * Si se da una base y el delta contra ella ocupa a lo más la mitad del contenido, se
+ * guarda el delta; si no, el contenido completo. Lo que se guarde va comprimido si
+ * conviene. Solo lee la tabla, así que puede llamarse desde otro hilo mientras se
+ * agregan blobs; si la base no se puede leer se guarda el contenido completo, sin
+ * escribir mensajes.
+ * 
+ * @param store Tabla de blobs.
+ * @param id Identificador de blob de @p content (ver object_hash()).
+ * @param content Contenido (debe seguir disponible hasta blob_add_prepared()).
+ * @param size Largo del contenido (a lo más BLOB_MAX_SIZE).
+ * @param base Blob con una versión anterior del mismo archivo, o BLOB_NONE.
+ * @param prepared Bytes resultantes; su @c buffer se libera con free().
+ */
+void blob_prepare(const BlobStore *store, const object_id *id, const void *content, size_t size, uint32_t base, BlobBytes *prepared);
+
+/**
+ * @brief Guarda los bytes armados por blob_prepare(), o reutiliza el blob que ya tiene
+ *        el contenido.
+ * 
+ * @param store Tabla de blobs.
+ * @param prepared Bytes y registro del blob.
+ * @param blob Índice del blob resultante.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+int blob_add_prepared(BlobStore *store, const BlobBytes *prepared, uint32_t *blob);
+
+/**
+ * @brief Guarda un contenido como blob, o reutiliza el blob que ya lo tiene.
+ * 
+ * @param store Tabla de blobs.
+ * @param content Contenido.
+ * @param size Largo del contenido (a lo más BLOB_MAX_SIZE).
+ * @param base Blob con una versión anterior del mismo archivo, o BLOB_NONE.
+ * @param blob Índice del blob resultante.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+int blob_add(BlobStore *store, const void *content, size_t size, uint32_t base, uint32_t *blob);
+
+/**
+ * @brief Obtiene el contenido de un blob, descomprimiéndolo y reconstruyéndolo si está
+ *        guardado como delta.
+ * 
+ * @param store Tabla de blobs.
+ * @param blob Índice del blob.
+ * @param buffer Memoria reservada para el resultado, que se libera con free() (NULL si
+ *               el contenido se leyó directo del segmento).
+ * @return Contenido, de blob_record()->size bytes, o NULL si no hay memoria o el delta
+ *         está dañado.
+ */
+const void *blob_content(const BlobStore *store, uint32_t blob, void **buffer);
+
+/**
+ * @brief Lee un archivo regular completo a memoria.
+ * 
+ * No escribe mensajes ni usa la tabla de blobs, así que puede llamarse desde cualquier hilo.
+ * 
+ * @param path Ruta del archivo.
+ * @param content Contenido leído (se libera con free()).
+ * @param size Largo del contenido.
+ * @param info Datos de stat del archivo abierto, tomados antes de leerlo (puede ser NULL).
+ * @return 0 en caso de éxito, o el código errno de la falla (EISDIR si no es un archivo
+ *         regular, EFBIG si supera BLOB_MAX_SIZE).
+ */
+int blob_load(const char *path, char **content, size_t *size, struct stat *info);
+
+/**
+ * @brief Informa por qué no se pudo leer un archivo.
+ * 
+ * @param path Ruta del archivo, tal como se muestra al usuario.
+ * @param error Código devuelto por blob_load().
+ */
+void blob_load_error(const char *path, int error);
+
+/**
+ * @brief Lee un archivo del árbol de trabajo y lo guarda como blob.
+ * 
+ * @param store Tabla de blobs.
+ * @param path Ruta del archivo.
+ * @param base Blob con una versión anterior del archivo, o BLOB_NONE.
+ * @param blob Índice del blob resultante.
+ * @param info Datos de stat del archivo leído (puede ser NULL).
+ * @return 0 en caso de éxito, 1 si el archivo no existe, -1 si ocurrió un error.
+ */
+int blob_read_file(BlobStore *store, const char *path, uint32_t base, uint32_t *blob, struct stat *info);
+
+/**
+ * @brief Indica si un archivo del árbol de trabajo tiene el contenido de un blob.
+ * 
+ * Un archivo que no existe no tiene nada que perderse, así que se considera igual.
+ * 
+ * @param store Tabla de blobs.
+ * @param blob Índice del blob, o BLOB_NONE si el archivo no debería existir.
+ * @param path Ruta del archivo.
+ * @return 1 si coinciden o el archivo no existe, 0 si no coinciden, -1 si ocurrió un error.
+ */
+int blob_file_matches(const BlobStore *store, uint32_t blob, const char *path);
+
+/**
+ * @brief Escribe el contenido de un blob en un archivo del árbol de trabajo.
+ * 
+ * Crea los directorios que falten en la ruta y reemplaza el archivo si existe.
+ * 
+ * @param store Tabla de blobs.
+ * @param blob Índice del blob.
+ * @param path Ruta del archivo.
+ * @return 0 en caso de éxito, -1 si ocurrió un error.
+ */
+int blob_write_file(const BlobStore *store, uint32_t blob, const char *path);
+
+/**
+ * @brief Comprueba que los registros y el índice cargados desde disco son coherentes.
+ * 
+ * @param store Tabla de blobs.
+ * @return 1 si son válidos, 0 si no.
+ */
+int blob_valid(const BlobStore *store);
+
+/**
+ * @brief Agrega al índice los blobs sueltos que el archivo guardó sin indexar.
+ * 
+ * @param store Tabla de blobs ya validada con blob_valid().
+ * @param first Primer blob que falta en el índice; los siguientes también faltan.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+int blob_reindex(BlobStore *store, uint32_t first);
+
+/**
+ * @brief Libera el índice de la tabla y cierra el pack (los segmentos se liberan aparte).
+ * 
+ * @param store Tabla de blobs.
+ */
+void blob_free(BlobStore *store);
+
+#endif
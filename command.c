@@ -0,0 +1,398 @@
+/**
+ * @file command.c
+ * @brief Implementación de la tabla de comandos y del tokenizador.
+ * 
+ * @authors
+ * Benjamin Sanhueza (bsanhuez@umag.cl)
+ * Nicolas Mancilla (nicmanci@umag.cl)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "command.h"
+#include "git.h"
+#include "output.h"
+
+#define COMMAND_SLOTS 32 ///< Posiciones del índice de comandos (potencia de dos mayor que la tabla).
+
+/**
+ * @brief Tipo de argumento que espera un comando.
+ */
+typedef enum CommandArg 
+{
+    ARG_NONE, ///< Sin argumento.
+    ARG_WORD, ///< Una palabra (nombre de archivo o ID).
+    ARG_OPTIONAL, ///< Una palabra opcional (NULL si no se da).
+    ARG_REST, ///< El resto de la línea (mensaje).
+    ARG_OPTIONAL_REST ///< El resto de la línea, opcional (opciones).
+} CommandArg;
+
+/**
+ * @brief Fila de la tabla de comandos.
+ */
+typedef struct CommandSpec 
+{
+    const char *name; ///< Nombre del comando.
+    CommandArg arg; ///< Argumento que recibe.
+    int (*run)(ugit_repo *repo, const char *arg); ///< Función que lo ejecuta (recibe NULL si no hay argumento).
+    const char *missing; ///< Mensaje si falta el argumento obligatorio.
+} CommandSpec;
+
+/**
+ * @brief Inicializa el repositorio e informa el resultado.
+ * 
+ * @param repo Repositorio.
+ * @param arg No se usa.
+ * @return 0 en caso de éxito, -1 si ocurre un error.
+ */
+static int run_init(ugit_repo *repo, const char *arg)
+{
+    (void)arg;
+    if (init_repo(repo) == 0) 
+    {
+        output_event("init", "Repositorio inicializado correctamente.\n");
+        return 0;
+    }
+    output_error("Error al inicializar el repositorio.\n");
+    return -1;
+}
+
+/**
+ * @brief Agrega al área de preparación los archivos o directorios indicados.
+ * 
+ * Con "-A" (o "--all") y sin rutas deja el área de preparación igual al árbol de trabajo.
+ * 
+ * @param repo Repositorio.
+ * @param arg Rutas separadas por espacios, o "-A".
+ * @return Resultado de add_paths() o add_all().
+ */
+static int run_add(ugit_repo *repo, const char *arg)
+{
+    char buffer[MAX_COMMAND_LENGTH];
+    const char *paths[MAX_COMMAND_LENGTH / 2];
+    size_t count = 0;
+    int all = 0;
+
+    snprintf(buffer, sizeof(buffer), "%s", arg);
+    char *cursor = buffer;
+    for (char *token = command_next_token(&cursor); token != NULL; token = command_next_token(&cursor)) 
+    {
+        if (strcmp(token, "-A") != 0 && strcmp(token, "--all") != 0) paths[count++] = token;
+        else all = 1;
+    }
+    if (!all) return add_paths(repo, paths, count);
+    if (count == 0) return add_all(repo);
+    output_error("Error: add -A no recibe rutas.\n");
+    return -1;
+}
+
+/**
+ * @brief Lee un número no negativo de una opción.
+ * 
+ * @param option Nombre de la opción, para el mensaje de error.
+ * @param text Texto a convertir (puede ser NULL si faltó).
+ * @param value Número resultante.
+ * @return 0 en caso de éxito, -1 si no es un número válido.
+ */
+static int parse_count(const char *option, const char *text, size_t *value)
+{
+    char *end;
+    if (text == NULL || *text < '0' || *text > '9') 
+    {
+        output_error("Error: {option:s} requiere un número.\n", option);
+        return -1;
+    }
+    unsigned long long number = strtoull(text, &end, 10);
+    if (*end != '\0') 
+    {
+        output_error("Error: {option:s} requiere un número.\n", option);
+        return -1;
+    }
+    *value = (size_t)number;
+    return 0;
+}
+
+/**
+ * @brief Muestra el historial de commits, con opciones de paginación y filtros.
+ * 
+ * Acepta `-n N`, `--skip N`, `--grep PATRÓN` (expresión regular extendida, o texto
+ * literal con `-F`) y `-- ARCHIVO` para ver solo los commits que agregan o quitan ese
+ * archivo.
+ * 
+ * @param repo Repositorio.
+ * @param arg Opciones, o NULL.
+ * @return Resultado de log_commits(), o -1 si una opción no es válida.
+ */
+static int run_log(ugit_repo *repo, const char *arg)
+{
+    char buffer[MAX_COMMAND_LENGTH];
+    LogOptions options;
+    log_options_init(&options);
+    if (arg == NULL) return log_commits(repo, &options);
+
+    snprintf(buffer, sizeof(buffer), "%s", arg);
+    char *cursor = buffer;
+    for (char *token = command_next_token(&cursor); token != NULL; token = command_next_token(&cursor)) 
+    {
+        if (strcmp(token, "-n") == 0) 
+        {
+            if (parse_count(token, command_next_token(&cursor), &options.limit) != 0) return -1;
+        }
+        else if (strcmp(token, "--skip") == 0) 
+        {
+            if (parse_count(token, command_next_token(&cursor), &options.skip) != 0) return -1;
+        }
+        else if (strcmp(token, "--grep") == 0) 
+        {
+            options.grep = command_next_token(&cursor);
+            if (options.grep == NULL) 
+            {
+                output_error("Error: --grep requiere un patrón.\n");
+                return -1;
+            }
+        }
+        else if (strcmp(token, "-F") == 0) 
+        {
+            options.fixed_strings = 1;
+        }
+        else if (strcmp(token, "--") == 0) 
+        {
+            options.path = command_next_token(&cursor);
+            if (options.path == NULL) 
+            {
+                output_error("Error: -- requiere un nombre de archivo.\n");
+                return -1;
+            }
+        }
+        else 
+        {
+            output_error("Error: Opción de log no reconocida: {option:s}\n", token);
+            return -1;
+        }
+    }
+    return log_commits(repo, &options);
+}
+
+/**
+ * @brief Lista el área de preparación.
+ * 
+ * @param repo Repositorio.
+ * @param arg No se usa.
+ * @return Resultado de list_files().
+ */
+static int run_ls(ugit_repo *repo, const char *arg)
+{
+    (void)arg;
+    return list_files(repo);
+}
+
+/**
+ * @brief Muestra el estado del repositorio.
+ * 
+ * @param repo Repositorio.
+ * @param arg No se usa.
+ * @return Resultado de show_status().
+ */
+static int run_status(ugit_repo *repo, const char *arg)
+{
+    (void)arg;
+    return show_status(repo);
+}
+
+/**
+ * @brief Activa el monitor del árbol de trabajo o, con "off", lo detiene.
+ * 
+ * @param repo Repositorio.
+ * @param arg "off" para detenerlo, o NULL para activarlo.
+ * @return Resultado de start_watch() o stop_watch().
+ */
+static int run_watch(ugit_repo *repo, const char *arg)
+{
+    if (arg == NULL) return start_watch(repo);
+    if (strcmp(arg, "off") == 0) return stop_watch(repo);
+    output_error("Error: opción desconocida para watch: {option:s}\n", arg);
+    return -1;
+}
+
+/**
+ * @brief Empaqueta el contenido de los archivos guardados.
+ * 
+ * @param repo Repositorio.
+ * @param arg No se usa.
+ * @return Resultado de repack_repo().
+ */
+static int run_repack(ugit_repo *repo, const char *arg)
+{
+    (void)arg;
+    return repack_repo(repo);
+}
+
+/**
+ * @brief Lista las ramas o, con un nombre, crea una rama nueva.
+ * 
+ * @param repo Repositorio.
+ * @param arg Nombre de la rama a crear, o NULL para listarlas.
+ * @return Resultado de list_branches() o create_branch().
+ */
+static int run_branch(ugit_repo *repo, const char *arg)
+{
+    return arg == NULL ? list_branches(repo) : create_branch(repo, arg);
+}
+
+/**
+ * @brief Termina la sesión.
+ * 
+ * @param repo Repositorio.
+ * @param arg No se usa.
+ * @return COMMAND_EXIT.
+ */
+static int run_exit(ugit_repo *repo, const char *arg)
+{
+    (void)repo;
+    (void)arg;
+    output_event("exit", "Saliendo de uGit.\n");
+    return COMMAND_EXIT;
+}
+
+/// Comandos reconocidos por uGit.
+static const CommandSpec command_table[] = 
+{
+    { "init", ARG_NONE, run_init, NULL },
+    { "add", ARG_REST, run_add, "Error: nombre del archivo no proporcionado.\n" },
+    { "rm", ARG_WORD, remove_file, "Error: nombre del archivo no proporcionado.\n" },
+    { "commit", ARG_REST, commit, "Error: mensaje de commit no proporcionado.\n" },
+    { "log", ARG_OPTIONAL_REST, run_log, NULL },
+    { "checkout", ARG_WORD, checkout_commit, "Error: ID del commit no proporcionado.\n" },
+    { "ls", ARG_NONE, run_ls, NULL },
+    { "status", ARG_NONE, run_status, NULL },
+    { "watch", ARG_OPTIONAL, run_watch, NULL },
+    { "repack", ARG_NONE, run_repack, NULL },
+    { "branch", ARG_OPTIONAL, run_branch, NULL },
+    { "merge", ARG_WORD, merge_branch, "Error: nombre de la rama no proporcionado.\n" },
+    { "exit", ARG_NONE, run_exit, NULL },
+};
+
+/// Cantidad de comandos de @c command_table.
+#define COMMAND_COUNT (sizeof(command_table) / sizeof(command_table[0]))
+
+/// Índice hash: posición en @c command_table + 1, o 0 si está libre.
+static unsigned char command_slots[COMMAND_SLOTS];
+
+/// Asegura que @c command_slots se construya una sola vez, aunque varios hilos busquen comandos.
+static pthread_once_t command_slots_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief Hash de un nombre de comando a partir de su largo y sus extremos.
+ * 
+ * @param name Nombre (no vacío).
+ * @param len Largo del nombre.
+ * @return Posición inicial en el índice.
+ */
+static unsigned int command_hash(const char *name, size_t len)
+{
+    return ((unsigned int)len * 7u + (unsigned char)name[0] * 3u + (unsigned char)name[len - 1]) & (COMMAND_SLOTS - 1);
+}
+
+/**
+ * @brief Construye el índice hash de la tabla de comandos (con pthread_once()).
+ */
+static void build_command_slots()
+{
+    for (size_t i = 0; i < COMMAND_COUNT; i++) 
+    {
+        unsigned int slot = command_hash(command_table[i].name, strlen(command_table[i].name));
+        while (command_slots[slot] != 0) slot = (slot + 1) & (COMMAND_SLOTS - 1);
+        command_slots[slot] = (unsigned char)(i + 1);
+    }
+}
+
+/**
+ * @brief Busca un comando por nombre.
+ * 
+ * @param name Nombre escrito por el usuario.
+ * @return Su fila de la tabla, o NULL si no existe.
+ */
+static const CommandSpec *find_command(const char *name)
+{
+    pthread_once(&command_slots_once, build_command_slots);
+
+    size_t len = strlen(name);
+    for (unsigned int slot = command_hash(name, len); command_slots[slot] != 0; slot = (slot + 1) & (COMMAND_SLOTS - 1)) 
+    {
+        const CommandSpec *spec = &command_table[command_slots[slot] - 1];
+        if (strncmp(spec->name, name, len + 1) == 0) return spec;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Separa la siguiente palabra de una línea, en el lugar.
+ * 
+ * @param cursor Posición actual; se actualiza.
+ * @return La palabra, o NULL si no quedan.
+ */
+char *command_next_token(char **cursor)
+{
+    char *start = *cursor;
+    while (*start == ' ') start++;
+    if (*start == '\0') 
+    {
+        *cursor = start;
+        return NULL;
+    }
+
+    char *end = start;
+    while (*end != '\0' && *end != ' ') end++;
+    if (*end != '\0') *end++ = '\0';
+    *cursor = end;
+    return start;
+}
+
+/**
+ * @brief Devuelve el resto de la línea.
+ * 
+ * @param cursor Posición actual; queda al final.
+ * @return El resto, o NULL si está vacío.
+ */
+char *command_rest(char **cursor)
+{
+    char *rest = *cursor;
+    *cursor = rest + strlen(rest);
+    return *rest != '\0' ? rest : NULL;
+}
+
+/**
+ * @brief Interpreta y ejecuta una línea de comandos.
+ * 
+ * @param repo Repositorio sobre el que se ejecuta.
+ * @param line Línea a ejecutar (se modifica).
+ * @return 0, -1 o COMMAND_EXIT.
+ */
+int command_execute(ugit_repo *repo, char *line)
+{
+    char *cursor = line;
+    char *name = command_next_token(&cursor);
+    if (name == NULL) return 0;
+
+    const CommandSpec *spec = find_command(name);
+    if (spec == NULL) 
+    {
+        output_error("Comando no reconocido: {command:s}\n", name);
+        return -1;
+    }
+
+    const char *arg = NULL;
+    if (spec->arg != ARG_NONE) 
+    {
+        int rest = spec->arg == ARG_REST || spec->arg == ARG_OPTIONAL_REST;
+        arg = rest ? command_rest(&cursor) : command_next_token(&cursor);
+        if (arg == NULL && spec->arg != ARG_OPTIONAL && spec->arg != ARG_OPTIONAL_REST) 
+        {
+            output_error(spec->missing);
+            return -1;
+        }
+    }
+    return spec->run(repo, arg);
+}
@@ -0,0 +1,53 @@
+/**
+ * @file command.h
+ * @brief Tabla de comandos de uGit y su intérprete de líneas.
+ * 
+ * Cada comando es una fila de una tabla estática con su nombre, el tipo de argumento
+ * que recibe y la función que lo ejecuta. Un índice hash sobre la tabla encuentra el
+ * comando en tiempo constante, y el tokenizador separa la línea en el lugar, sin
+ * copiar ni reservar memoria, así que es reentrante. Agregar un comando es agregar
+ * una fila a la tabla.
+ * 
+ * @authors
+ * - Benjamin Sanhueza (bsanhuez@umag.cl)
+ * - Nicolas Mancilla (nicmanci@umag.cl)
+ */
+
+#ifndef COMMAND_H
+#define COMMAND_H
+
+#include "git.h"
+
+#define COMMAND_EXIT 1 ///< Valor de command_execute() cuando el comando pide salir.
+
+/**
+ * @brief Separa la siguiente palabra de una línea.
+ * 
+ * Salta los espacios iniciales, termina la palabra con '\0' en el mismo búfer y deja
+ * @p cursor después de ella. No usa estado global, a diferencia de strtok().
+ * 
+ * @param cursor Posición actual dentro de la línea; se actualiza.
+ * @return La palabra, o NULL si no quedan palabras.
+ */
+char *command_next_token(char **cursor);
+
+/**
+ * @brief Devuelve el resto de la línea sin separarlo.
+ * 
+ * @param cursor Posición actual dentro de la línea; queda al final.
+ * @return El resto de la línea, o NULL si está vacío.
+ */
+char *command_rest(char **cursor);
+
+/**
+ * @brief Interpreta y ejecuta una línea de comandos.
+ * 
+ * La línea se modifica al separar sus palabras.
+ * 
+ * @param repo Repositorio sobre el que se ejecuta.
+ * @param line Línea sin el salto de línea final.
+ * @return 0 si se ejecutó (o estaba vacía), -1 si falló o no se reconoció, COMMAND_EXIT si pide salir.
+ */
+int command_execute(ugit_repo *repo, char *line);
+
+#endif
@@ -0,0 +1,293 @@
+/**
+ * @file delta.c
+ * @brief Implementación de la creación y aplicación de deltas.
+ * 
+ * @authors
+ * Benjamin Sanhueza (bsanhuez@umag.cl)
+ * Nicolas Mancilla (nicmanci@umag.cl)
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "delta.h"
+
+#define DELTA_MAX_INSERT 127 ///< Bytes máximos de una instrucción de inserción.
+#define DELTA_MAX_COPY 0xFFFFFFu ///< Bytes máximos de una instrucción de copia (tres bytes de largo).
+
+/**
+ * @brief Delta en construcción.
+ */
+typedef struct DeltaBuffer
+{
+    uint8_t *data; ///< Bytes escritos.
+    size_t size; ///< Bytes usados.
+    size_t capacity; ///< Capacidad de @c data.
+    size_t limit; ///< Largo máximo aceptable.
+} DeltaBuffer;
+
+/**
+ * @brief Reserva espacio al final del delta.
+ * 
+ * @param buffer Delta en construcción.
+ * @param len Bytes a reservar.
+ * @return Puntero al espacio reservado, o NULL si se supera el límite o no hay memoria.
+ */
+static uint8_t *delta_reserve(DeltaBuffer *buffer, size_t len)
+{
+    if (buffer->size + len > buffer->limit) return NULL;
+    if (buffer->size + len > buffer->capacity)
+    {
+        size_t capacity = buffer->capacity ? buffer->capacity * 2 : 256;
+        while (capacity < buffer->size + len) capacity *= 2;
+        uint8_t *data = (uint8_t *)realloc(buffer->data, capacity);
+        if (!data) return NULL;
+        buffer->data = data;
+        buffer->capacity = capacity;
+    }
+    uint8_t *out = buffer->data + buffer->size;
+    buffer->size += len;
+    return out;
+}
+
+/**
+ * @brief Escribe un entero como largo variable (7 bits por byte, el bit alto indica que sigue).
+ * 
+ * @param buffer Delta en construcción.
+ * @param value Entero.
+ * @return 0 en caso de éxito, -1 si no cabe.
+ */
+static int put_varint(DeltaBuffer *buffer, uint64_t value)
+{
+    do
+    {
+        uint8_t *out = delta_reserve(buffer, 1);
+        if (!out) return -1;
+        *out = (uint8_t)(value & 0x7F) | (value >= 0x80 ? 0x80 : 0);
+        value >>= 7;
+    } while (value != 0);
+    return 0;
+}
+
+/**
+ * @brief Escribe instrucciones de inserción con bytes literales.
+ * 
+ * @param buffer Delta en construcción.
+ * @param bytes Bytes a insertar.
+ * @param len Cantidad de bytes.
+ * @return 0 en caso de éxito, -1 si no cabe.
+ */
+static int put_insert(DeltaBuffer *buffer, const uint8_t *bytes, size_t len)
+{
+    while (len > 0)
+    {
+        size_t chunk = len < DELTA_MAX_INSERT ? len : DELTA_MAX_INSERT;
+        uint8_t *out = delta_reserve(buffer, chunk + 1);
+        if (!out) return -1;
+        out[0] = (uint8_t)chunk;
+        memcpy(out + 1, bytes, chunk);
+        bytes += chunk;
+        len -= chunk;
+    }
+    return 0;
+}
+
+/**
+ * @brief Escribe instrucciones de copia de un tramo de la base.
+ * 
+ * Cada instrucción lleva un byte de control con el bit alto encendido y un bit por
+ * cada byte no nulo del desplazamiento (bits 0 a 3) y del largo (bits 4 a 6), que van
+ * a continuación.
+ * 
+ * @param buffer Delta en construcción.
+ * @param offset Inicio del tramo en la base.
+ * @param len Largo del tramo.
+ * @return 0 en caso de éxito, -1 si no cabe.
+ */
+static int put_copy(DeltaBuffer *buffer, size_t offset, size_t len)
+{
+    while (len > 0)
+    {
+        size_t chunk = len < DELTA_MAX_COPY ? len : DELTA_MAX_COPY;
+        uint8_t *out = delta_reserve(buffer, 8);
+        if (!out) return -1;
+
+        size_t used = 1;
+        out[0] = 0x80;
+        for (int i = 0; i < 4; i++)
+        {
+            uint8_t byte = (uint8_t)(offset >> (8 * i));
+            if (byte == 0) continue;
+            out[0] |= (uint8_t)(1u << i);
+            out[used++] = byte;
+        }
+        for (int i = 0; i < 3; i++)
+        {
+            uint8_t byte = (uint8_t)(chunk >> (8 * i));
+            if (byte == 0) continue;
+            out[0] |= (uint8_t)(0x10u << i);
+            out[used++] = byte;
+        }
+        buffer->size -= 8 - used;
+        offset += chunk;
+        len -= chunk;
+    }
+    return 0;
+}
+
+/**
+ * @brief Hash de un bloque de DELTA_BLOCK_SIZE bytes.
+ * 
+ * @param block Inicio del bloque.
+ * @param bits Bits del resultado.
+ * @return Hash en [0, 2^bits).
+ */
+static size_t block_hash(const uint8_t *block, unsigned int bits)
+{
+    uint64_t low, high;
+    memcpy(&low, block, sizeof(low));
+    memcpy(&high, block + sizeof(low), sizeof(high));
+    uint64_t hash = (low * 0x9E3779B97F4A7C15ull ^ high) * 0xC2B2AE3D27D4EB4Full;
+    return (size_t)(hash >> (64 - bits));
+}
+
+/**
+ * @brief Calcula el delta que transforma una base en un contenido nuevo.
+ * 
+ * @param base Contenido base.
+ * @param base_size Largo de la base.
+ * @param target Contenido nuevo.
+ * @param target_size Largo del contenido nuevo.
+ * @param max_size Largo máximo aceptable del delta.
+ * @param delta Delta resultante (se libera con free()).
+ * @return Largo del delta, o 0 si superaría @p max_size o no hay memoria.
+ */
+size_t delta_create(const uint8_t *base, size_t base_size, const uint8_t *target, size_t target_size,
+                    size_t max_size, uint8_t **delta)
+{
+    if (base_size < DELTA_BLOCK_SIZE || target_size < DELTA_BLOCK_SIZE) return 0;
+
+    unsigned int bits = 4;
+    while (bits < 30 && ((size_t)1 << bits) < base_size / DELTA_BLOCK_SIZE) bits++;
+    uint32_t *index = (uint32_t *)calloc((size_t)1 << bits, sizeof(uint32_t));
+    if (!index) return 0;
+    for (size_t i = 0; i + DELTA_BLOCK_SIZE <= base_size; i += DELTA_BLOCK_SIZE)
+    {
+        size_t slot = block_hash(base + i, bits);
+        if (index[slot] == 0) index[slot] = (uint32_t)(i + 1);
+    }
+
+    DeltaBuffer buffer = { NULL, 0, 0, max_size };
+    int failed = put_varint(&buffer, base_size) != 0 || put_varint(&buffer, target_size) != 0;
+    size_t literal = 0;
+    size_t pos = 0;
+    while (!failed && pos + DELTA_BLOCK_SIZE <= target_size)
+    {
+        uint32_t ref = index[block_hash(target + pos, bits)];
+        size_t offset = (size_t)ref - 1;
+        if (ref == 0 || memcmp(base + offset, target + pos, DELTA_BLOCK_SIZE) != 0)
+        {
+            pos++;
+            continue;
+        }
+
+        size_t len = DELTA_BLOCK_SIZE;
+        while (offset + len < base_size && pos + len < target_size && base[offset + len] == target[pos + len]) len++;
+        while (pos > literal && offset > 0 && base[offset - 1] == target[pos - 1])
+        {
+            pos--;
+            offset--;
+            len++;
+        }
+        failed = put_insert(&buffer, target + literal, pos - literal) != 0 || put_copy(&buffer, offset, len) != 0;
+        pos += len;
+        literal = pos;
+    }
+    if (!failed) failed = put_insert(&buffer, target + literal, target_size - literal) != 0;
+    free(index);
+
+    if (failed)
+    {
+        free(buffer.data);
+        return 0;
+    }
+    *delta = buffer.data;
+    return buffer.size;
+}
+
+/**
+ * @brief Lee un entero de largo variable.
+ * 
+ * @param cursor Posición de lectura (avanza).
+ * @param end Fin del delta.
+ * @param value Entero leído.
+ * @return 0 en caso de éxito, -1 si el delta termina antes o el entero es demasiado largo.
+ */
+static int get_varint(const uint8_t **cursor, const uint8_t *end, uint64_t *value)
+{
+    *value = 0;
+    for (unsigned int shift = 0; shift < 64; shift += 7)
+    {
+        if (*cursor == end) return -1;
+        uint8_t byte = *(*cursor)++;
+        *value |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return 0;
+    }
+    return -1;
+}
+
+/**
+ * @brief Reconstruye un contenido aplicando un delta a su base.
+ * 
+ * @param base Contenido base.
+ * @param base_size Largo de la base.
+ * @param delta Delta creado con delta_create().
+ * @param delta_size Largo del delta.
+ * @param target Destino de @p target_size bytes.
+ * @param target_size Largo esperado del resultado.
+ * @return 0 en caso de éxito, -1 si el delta está dañado o no corresponde a la base.
+ */
+int delta_apply(const uint8_t *base, size_t base_size, const uint8_t *delta, size_t delta_size,
+                uint8_t *target, size_t target_size)
+{
+    const uint8_t *cursor = delta;
+    const uint8_t *end = delta + delta_size;
+    uint64_t expected_base, expected_target;
+    if (get_varint(&cursor, end, &expected_base) != 0 || get_varint(&cursor, end, &expected_target) != 0) return -1;
+    if (expected_base != base_size || expected_target != target_size) return -1;
+
+    size_t pos = 0;
+    while (cursor < end)
+    {
+        uint8_t op = *cursor++;
+        if (op & 0x80)
+        {
+            size_t offset = 0;
+            size_t len = 0;
+            for (int i = 0; i < 4; i++)
+            {
+                if (!(op & (1u << i))) continue;
+                if (cursor == end) return -1;
+                offset |= (size_t)*cursor++ << (8 * i);
+            }
+            for (int i = 0; i < 3; i++)
+            {
+                if (!(op & (0x10u << i))) continue;
+                if (cursor == end) return -1;
+                len |= (size_t)*cursor++ << (8 * i);
+            }
+            if (len == 0) len = 0x10000;
+            if (offset > base_size || len > base_size - offset || len > target_size - pos) return -1;
+            memcpy(target + pos, base + offset, len);
+            pos += len;
+        }
+        else
+        {
+            size_t len = op;
+            if (len == 0 || len > (size_t)(end - cursor) || len > target_size - pos) return -1;
+            memcpy(target + pos, cursor, len);
+            cursor += len;
+            pos += len;
+        }
+    }
+    return pos == target_size ? 0 : -1;
+}
@@ -0,0 +1,56 @@
+/**
+ * @file delta.h
+ * @brief Deltas entre dos versiones de un contenido (instrucciones de copia e inserción).
+ * 
+ * Un delta describe un contenido nuevo a partir de uno base, con el mismo formato que
+ * usan los packs de Git: el largo de la base y el del resultado como enteros de
+ * largo variable, seguidos de instrucciones que copian un tramo de la base o insertan
+ * bytes literales. Para un archivo que se edita poco entre versiones, el delta es una
+ * fracción del contenido completo.
+ * 
+ * @authors
+ * - Benjamin Sanhueza (bsanhuez@umag.cl)
+ * - Nicolas Mancilla (nicmanci@umag.cl)
+ */
+
+#ifndef DELTA_H
+#define DELTA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define DELTA_BLOCK_SIZE 16 ///< Largo de los bloques de la base que se indexan y largo mínimo de una copia.
+
+/**
+ * @brief Calcula el delta que transforma una base en un contenido nuevo.
+ * 
+ * Indexa la base en bloques de DELTA_BLOCK_SIZE bytes y recorre el contenido nuevo
+ * buscando cada posición en ese índice; las coincidencias se extienden byte a byte
+ * y lo que no coincide se inserta literal.
+ * 
+ * @param base Contenido base.
+ * @param base_size Largo de la base.
+ * @param target Contenido nuevo.
+ * @param target_size Largo del contenido nuevo.
+ * @param max_size Largo máximo aceptable del delta.
+ * @param delta Delta resultante (se libera con free()).
+ * @return Largo del delta, o 0 si superaría @p max_size o no hay memoria.
+ */
+size_t delta_create(const uint8_t *base, size_t base_size, const uint8_t *target, size_t target_size,
+                    size_t max_size, uint8_t **delta);
+
+/**
+ * @brief Reconstruye un contenido aplicando un delta a su base.
+ * 
+ * @param base Contenido base.
+ * @param base_size Largo de la base.
+ * @param delta Delta creado con delta_create().
+ * @param delta_size Largo del delta.
+ * @param target Destino de @p target_size bytes.
+ * @param target_size Largo esperado del resultado.
+ * @return 0 en caso de éxito, -1 si el delta está dañado o no corresponde a la base.
+ */
+int delta_apply(const uint8_t *base, size_t base_size, const uint8_t *delta, size_t delta_size,
+                uint8_t *target, size_t target_size);
+
+#endif
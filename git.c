@@ -14,277 +14,2842 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <regex.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <pthread.h>
 #include "git.h"
+#include "store.h"
+#include "arena.h"
+#include "tree.h"
+#include "intern.h"
+#include "blob.h"
+#include "graph.h"
+#include "output.h"
+#include "rcu.h"
+#include "hashpool.h"
+#include "watch.h"
 
-/// Puntero al inicio de la lista de archivos en el área de preparación.
-static FileNode *file_list = NULL; 
+#define COMMIT_CHUNK_SIZE (sizeof(commitGit) * 4096) ///< Bytes por trozo de la tabla de commits.
+#define POOL_CHUNK_SIZE (1u << 16) ///< Bytes por trozo del pool de cadenas.
+#define NAMES_CHUNK_SIZE (sizeof(InternEntry) * 4096) ///< Bytes por trozo de la tabla de cadenas.
+#define TREE_CHUNK_SIZE (1u << 16) ///< Bytes por trozo de los nodos de árboles.
+#define FILTER_CHUNK_SIZE (sizeof(PathFilter) * 4096) ///< Bytes por trozo del índice de filtros de rutas.
+#define BLOB_CHUNK_SIZE (sizeof(BlobRecord) * 4096) ///< Bytes por trozo de la tabla de blobs.
+#define BLOB_DATA_CHUNK_SIZE (1u << 20) ///< Bytes por trozo del contenido de los blobs.
 
-/// Puntero al inicio de la lista de commits.
-static commitGit *commit_list = NULL; 
+/**
+ * @brief Estado completo de un repositorio.
+ * 
+ * Todo lo que antes eran variables globales de este archivo vive aquí, así un proceso
+ * puede tener muchos repositorios independientes y usar cada uno desde su propio hilo.
+ * 
+ * Dentro de un repositorio hay un solo escritor a la vez (@c lock) y cualquier cantidad
+ * de lectores sin lock. Los registros de commit nunca cambian una vez agregados: el
+ * escritor los completa y recién entonces publica @c head_commit, así un lector que lo
+ * lee ve una historia inmutable y consistente. El área de preparación se recorre igual,
+ * publicando los enlaces @c next; los nodos quitados se reciclan cuando no hay lectores
+ * recorriéndola (@c list_readers).
+ * 
+ * El árbol de trabajo es el directorio que contiene al del repositorio: add lee los
+ * archivos desde ahí, y checkout y merge escriben ahí los que cambian.
+ */
+struct ugit_repo 
+{
+    Arena arena; ///< Arena de la que salen los nodos de archivo y los trozos de las tablas.
+    FileNode *file_list; ///< Puntero al inicio de la lista de archivos en el área de preparación.
+    FileNode **file_index; ///< Índice hash (direccionamiento abierto) sobre los nodos de @c file_list.
+    size_t index_capacity; ///< Capacidad del índice (siempre potencia de dos).
+    size_t index_used; ///< Posiciones ocupadas del índice, contando las lápidas.
+    size_t file_count; ///< Cantidad de archivos en el área de preparación.
+    uint32_t staging_base; ///< Raíz del árbol del último commit o checkout, del que parte el área de preparación.
+    uint32_t *dirty_names; ///< Identificadores de los nombres agregados o quitados desde @c staging_base.
+    size_t dirty_count; ///< Cantidad de nombres en @c dirty_names.
+    size_t dirty_capacity; ///< Capacidad de @c dirty_names.
+    Segment commits; ///< Tabla de commits: registros commitGit indexados por posición.
+    Segment path_filters; ///< Filtro de rutas cambiadas de cada commit, en la misma posición que en @c commits.
+    Segment tree_nodes; ///< Nodos de los árboles de archivos, compartidos entre commits.
+    Segment string_pool; ///< Pool de cadenas (mensajes y nombres de archivo), cada una guardada una sola vez.
+    Segment string_ids; ///< Tabla de identificador de cadena a su posición en @c string_pool.
+    Segment blob_records; ///< Registros BlobRecord de los contenidos de archivos.
+    Segment blob_data; ///< Contenido de los blobs.
+    BlobStore blobs; ///< Tabla de blobs sobre @c blob_records y @c blob_data.
+    InternTable names; ///< Cadenas internadas: nombres de archivo y mensajes se referencian por identificador.
+    uint32_t head_commit; ///< Índice del último commit creado, o COMMIT_NONE si no hay commits.
+    ObjectTable commit_table; ///< Tabla de identificador a commit (índice + 1), para resolver checkout en O(1).
+    CommitGraph graph; ///< Consultas de ascendencia sobre @c commits (solo con el lock de escritura).
+    TreeStore trees; ///< Segmentos de los árboles de archivos (nodos y nombres).
+    StoreMapping mapping; ///< Archivo del repositorio mapeado en memoria, si se abrió uno existente.
+    versionGit *version_list; ///< Tabla de ramas (referencias con nombre).
+    uint32_t version_count; ///< Ramas en @c version_list.
+    uint32_t version_capacity; ///< Capacidad de @c version_list.
+    uint32_t *version_index; ///< Índice hash de nombre a rama: posición en @c version_list + 1, o 0 si está libre.
+    unsigned int version_bits; ///< Logaritmo de la capacidad de @c version_index.
+    uint32_t current_branch; ///< Rama en la que está HEAD, o BRANCH_NONE si está desacoplado.
+    char *dir; ///< Directorio donde se guarda el repositorio, o NULL si solo vive en memoria.
+    char *path; ///< Ruta del archivo del repositorio dentro de @c dir.
+    size_t worktree_len; ///< Largo del prefijo de @c dir que es el árbol de trabajo (0 para el directorio actual).
+    int initialized; ///< Indicador de si el repositorio ha sido inicializado.
+    int modified; ///< 1 si hay cambios sin guardar; si no, close_repo() no reescribe el archivo.
+    pthread_mutex_t lock; ///< Serializa las operaciones que modifican el repositorio.
+    unsigned int list_readers; ///< Lectores recorriendo @c file_list en este momento.
+    FileNode *retired_nodes; ///< Nodos quitados de @c file_list, enlazados por @c prev, pendientes de reciclar.
+    Watcher *watcher; ///< Monitor de cambios del árbol de trabajo, o NULL si no está activo.
+};
+
+/// Marcador de posición eliminada dentro de los índices (nunca se modifica).
+static FileNode index_tombstone;
+
+static FileNode **index_find(ugit_repo *repo, uint32_t name, uint32_t hash);
+static FileNode *stage_file(ugit_repo *repo, uint32_t name, uint32_t hash, uint32_t blob);
+static int log_dirty(ugit_repo *repo, uint32_t name);
+static int branch_add(ugit_repo *repo, uint32_t name, uint32_t commit_index);
+static uint32_t commit_count(ugit_repo *repo);
+static const commitGit *commit_at(ugit_repo *repo, uint32_t index);
+
+/**
+ * @brief Arma la imagen del estado actual para guardarla o cargarla.
+ * 
+ * @param repo Repositorio.
+ * @param image Imagen a llenar con punteros a los segmentos del repositorio.
+ */
+static void describe_image(ugit_repo *repo, StoreImage *image)
+{
+    image->commits = &repo->commits;
+    image->filters = &repo->path_filters;
+    image->trees = &repo->tree_nodes;
+    image->names = &repo->names;
+    image->index = &repo->commit_table;
+    image->blobs = &repo->blobs;
+    image->head = repo->head_commit;
+    image->staging = NULL;
+    image->staging_count = 0;
+    image->staging_base = repo->staging_base;
+    image->dirty = repo->dirty_names;
+    image->dirty_count = repo->dirty_count;
+    image->refs = repo->version_list;
+    image->ref_count = repo->version_count;
+    image->branch = repo->current_branch;
+    image->pack_count = repo->blobs.pack.count;
+    image->pack_id = repo->blobs.pack.id;
+}
+
+/**
+ * @brief Guarda el repositorio completo en su archivo.
+ * 
+ * El área de preparación se escribe como pares (nombre, blob) desde el nodo más antiguo
+ * al más reciente, para que al volver a insertarlos al inicio de la lista se recupere el
+ * mismo orden. También
+ * se guardan el árbol base y los nombres modificados desde él. Un repositorio sin
+ * directorio solo vive en memoria y no se escribe. Un guardado exitoso deja el
+ * repositorio sin cambios pendientes.
+ * 
+ * @param repo Repositorio.
+ * @param rewrite 1 para reescribir el archivo completo aunque lo nuevo quepa en él.
+ * @return 0 en caso de éxito, -1 si ocurre un error.
+ */
+static int save_repo(ugit_repo *repo, int rewrite)
+{
+    if (repo->path == NULL) return 0;
+
+    StoreImage image;
+    describe_image(repo, &image);
+
+    StagedEntry *staging = (StagedEntry *)malloc((repo->file_count + 1) * sizeof(StagedEntry));
+    if (!staging) 
+    {
+        perror("Error al asignar memoria para guardar el repositorio");
+        return -1;
+    }
+
+    FileNode *last = NULL;
+    for (FileNode *node = repo->file_list; node != NULL; node = node->next) last = node;
+    size_t used = 0;
+    for (FileNode *node = last; node != NULL; node = node->prev, used++) 
+    {
+        staging[used].name = node->name;
+        staging[used].blob = node->blob;
+        staging[used].stat = node->stat;
+    }
+    image.staging = staging;
+    image.staging_count = used;
+
+    int result = store_save(repo->path, &repo->mapping, &image, rewrite);
+    free(staging);
+    if (result == 0) repo->modified = 0;
+    return result;
+}
+
+/**
+ * @brief Devuelve a la arena los nodos quitados, si ningún lector recorre la lista.
+ * 
+ * La barrera ordena los desenlaces anteriores antes de leer el contador: un lector
+ * que empieza después ya no puede llegar a los nodos retirados.
+ * 
+ * @param repo Repositorio.
+ */
+static void recycle_nodes(ugit_repo *repo)
+{
+    if (repo->retired_nodes == NULL) return;
+
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&repo->list_readers, __ATOMIC_SEQ_CST) != 0) return;
+
+    while (repo->retired_nodes != NULL) 
+    {
+        FileNode *node = repo->retired_nodes;
+        repo->retired_nodes = node->prev;
+        arena_free_node(&repo->arena, node, sizeof(FileNode));
+    }
+}
+
+/**
+ * @brief Toma el lock de escritura del repositorio.
+ * 
+ * @param repo Repositorio.
+ */
+static void lock_repo(ugit_repo *repo)
+{
+    pthread_mutex_lock(&repo->lock);
+}
+
+/**
+ * @brief Recicla los nodos pendientes y suelta el lock de escritura.
+ * 
+ * @param repo Repositorio.
+ * @param result Resultado de la operación.
+ * @return @p result, para devolverlo directamente.
+ */
+static int unlock_repo(ugit_repo *repo, int result)
+{
+    recycle_nodes(repo);
+    pthread_mutex_unlock(&repo->lock);
+    return result;
+}
+
+/**
+ * @brief Inicializa el repositorio.
+ * 
+ * Crea el directorio del repositorio y un archivo de repositorio vacío, con la rama
+ * DEFAULT_BRANCH como rama actual. Si el repositorio ya ha sido inicializado, no se
+ * realiza ninguna acción.
+ * 
+ * @param repo Repositorio.
+ * @return 0 en caso de éxito o si ya estaba inicializado, -1 si no se pudo crear.
+ */
+static int init_locked(ugit_repo *repo) 
+{ 
+    if (repo->initialized) 
+    {
+        output_event("init", "El repositorio ya está inicializado.\n");
+        return 0;
+    }
+
+    if (repo->dir != NULL && mkdir(repo->dir, 0755) != 0 && errno != EEXIST) 
+    {
+        perror("Error al crear el directorio del repositorio");
+        return -1;
+    }
+
+    uint32_t name;
+    if (repo->version_count == 0) 
+    {
+        if (intern_add(&repo->names, DEFAULT_BRANCH, &name) != 0 || branch_add(repo, name, COMMIT_NONE) != 0) return -1;
+        repo->current_branch = 0;
+    }
+    if (save_repo(repo, 0) != 0) return -1;
+
+    RCU_PUBLISH(&repo->initialized, 1);
+    return 0;
+}
+
+/**
+ * @brief Inicializa el repositorio tomando el lock de escritura.
+ * 
+ * @param repo Repositorio.
+ * @return 0 en caso de éxito o si ya estaba inicializado, -1 si no se pudo crear.
+ */
+int init_repo(ugit_repo *repo)
+{
+    lock_repo(repo);
+    return unlock_repo(repo, init_locked(repo));
+}
+
+/**
+ * @brief Abre el pack que nombra el archivo del repositorio.
+ * 
+ * @param repo Repositorio.
+ * @param id Identificador del pack.
+ * @param count Objetos que debe tener.
+ * @return 0 en caso de éxito, -1 si falta o no corresponde.
+ */
+static int open_pack(ugit_repo *repo, const object_id *id, uint32_t count)
+{
+    char path[PATH_MAX];
+    if (pack_path(repo->dir, id, path) != 0 || pack_open(&repo->blobs.pack, path) != 0) return -1;
+    if (repo->blobs.pack.count != count || memcmp(repo->blobs.pack.id.hash, id->hash, SHA1_DIGEST_SIZE) != 0) 
+    {
+        output_error("Error: El archivo {path:s} no es un pack válido.\n", path);
+        pack_close(&repo->blobs.pack);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Comprueba que las tablas cargadas desde disco son coherentes entre sí.
+ * 
+ * store_open() solo revisa que cada sección quepa en el archivo. Aquí se recorren una
+ * vez las cadenas, los blobs, los commits y los árboles que estos alcanzan, para que
+ * un archivo dañado se rechace al abrirlo en vez de provocar lecturas fuera de las
+ * tablas más adelante. Los padres de un commit deben ser commits anteriores, lo que
+ * además descarta los ciclos en el grafo.
+ * 
+ * @param repo Repositorio con las tablas recién cargadas.
+ * @param image Imagen leída por store_open().
+ * @return 1 si el repositorio es válido, 0 si no, -1 si no hay memoria.
+ */
+static int image_valid(ugit_repo *repo, const StoreImage *image)
+{
+    uint32_t commits = commit_count(repo);
+    uint32_t name_count = intern_count(&repo->names);
+    if (segment_size(&repo->commits) % sizeof(commitGit) != 0 || !intern_valid(&repo->names) ||
+        !blob_valid(&repo->blobs) || !objtable_valid(&repo->commit_table, commits) ||
+        image->commits_indexed > commits || image->names_indexed > name_count || image->blobs_indexed > blob_count(&repo->blobs) ||
+        (image->head >= commits && image->head != COMMIT_NONE)) return 0;
+
+    unsigned char *seen = (unsigned char *)calloc(segment_size(&repo->tree_nodes) / sizeof(uint32_t) + 1, 1);
+    if (!seen) 
+    {
+        perror("Error al asignar memoria para revisar el repositorio");
+        return -1;
+    }
+    int valid = tree_valid(&repo->trees, image->staging_base, seen);
+    for (uint32_t i = 0; i < commits && valid; i++) 
+    {
+        const commitGit *commit = commit_at(repo, i);
+        for (int p = 0; p < COMMIT_MAX_PARENTS; p++) 
+        {
+            if (commit->parents[p] >= i && commit->parents[p] != COMMIT_NONE) valid = 0;
+        }
+        if (commit->mensaje >= name_count || !tree_valid(&repo->trees, commit->archivos, seen)) valid = 0;
+    }
+    free(seen);
+    return valid;
+}
+
+/**
+ * @brief Agrega a las tablas hash lo que el archivo guardó sin indexar.
+ * 
+ * Un guardado que no reescribe el archivo solo agrega los registros nuevos; las tablas
+ * hash en disco cubren lo que había en la última reescritura completa.
+ * 
+ * @param repo Repositorio con las tablas recién validadas.
+ * @param image Imagen leída por store_open().
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+static int reindex_image(ugit_repo *repo, const StoreImage *image)
+{
+    uint32_t commits = commit_count(repo);
+    for (uint32_t i = image->commits_indexed; i < commits; i++) 
+    {
+        if (objtable_insert(&repo->commit_table, &commit_at(repo, i)->id, i + 1) < 0) return -1;
+    }
+    if (intern_reindex(&repo->names, image->names_indexed) != 0) return -1;
+    return blob_reindex(&repo->blobs, image->blobs_indexed);
+}
+
+/**
+ * @brief Abre el repositorio guardado en su directorio, si existe.
+ * 
+ * Las tablas de commits, identificadores y cadenas se usan directamente desde el
+ * archivo mapeado; solo el área de preparación se reconstruye en memoria, a partir
+ * de los identificadores de sus nombres y sus blobs.
+ * 
+ * @param repo Repositorio.
+ * @return 1 si se cargó un repositorio, 0 si no existe, -1 si ocurrió un error.
+ */
+static int open_locked(ugit_repo *repo)
+{
+    if (repo->initialized || repo->path == NULL) return 0;
+
+    StoreImage image;
+    describe_image(repo, &image);
+    int result = store_open(repo->path, &repo->mapping, &image);
+    if (result != 0) return result > 0 ? 0 : -1;
+    if (image.pack_count > 0 && open_pack(repo, &image.pack_id, image.pack_count) != 0) return -1;
+
+    result = image_valid(repo, &image);
+    if (result <= 0) 
+    {
+        if (result == 0) output_error("Error: El archivo {path:s} no es un repositorio válido.\n", repo->path);
+        return -1;
+    }
+    if (reindex_image(repo, &image) != 0) return -1;
+
+    RCU_PUBLISH(&repo->head_commit, image.head);
+    repo->staging_base = image.staging_base;
+
+    uint32_t name_count = intern_count(&repo->names);
+    uint32_t blobs = blob_count(&repo->blobs);
+    for (size_t i = 0; i < image.staging_count; i++) 
+    {
+        uint32_t name = image.staging[i].name;
+        uint32_t blob = image.staging[i].blob;
+        if (name >= name_count || blob >= blobs) 
+        {
+            output_error("Error: El archivo {path:s} no es un repositorio válido.\n", repo->path);
+            return -1;
+        }
+        uint32_t hash = intern_hash(&repo->names, name);
+        if (index_find(repo, name, hash) != NULL) continue;
+
+        FileNode *node = stage_file(repo, name, hash, blob);
+        if (node == NULL) return -1;
+        node->stat = image.staging[i].stat;
+    }
+
+    for (size_t i = 0; i < image.dirty_count; i++) 
+    {
+        if (image.dirty[i] >= name_count) 
+        {
+            output_error("Error: El archivo {path:s} no es un repositorio válido.\n", repo->path);
+            return -1;
+        }
+        if (log_dirty(repo, image.dirty[i]) != 0) return -1;
+    }
+
+    uint32_t commits = commit_count(repo);
+    if (segment_size(&repo->path_filters) != (size_t)commits * sizeof(PathFilter)) 
+    {
+        output_error("Error: El archivo {path:s} no es un repositorio válido.\n", repo->path);
+        return -1;
+    }
+    for (size_t i = 0; i < image.ref_count; i++) 
+    {
+        if (image.refs[i].nombre >= name_count || (image.refs[i].commit >= commits && image.refs[i].commit != COMMIT_NONE)) 
+        {
+            output_error("Error: El archivo {path:s} no es un repositorio válido.\n", repo->path);
+            return -1;
+        }
+        if (branch_add(repo, image.refs[i].nombre, image.refs[i].commit) != 0) return -1;
+    }
+    repo->current_branch = image.branch < repo->version_count ? image.branch : BRANCH_NONE;
+
+    repo->modified = 0;
+    RCU_PUBLISH(&repo->initialized, 1);
+    return 1;
+}
+
+/**
+ * @brief Abre el repositorio guardado tomando el lock de escritura.
+ * 
+ * @param repo Repositorio.
+ * @return 1 si se cargó un repositorio, 0 si no existe, -1 si ocurrió un error.
+ */
+int open_repo(ugit_repo *repo)
+{
+    lock_repo(repo);
+    return unlock_repo(repo, open_locked(repo));
+}
+
+/**
+ * @brief Crea un repositorio vacío, sin inicializar.
+ * 
+ * @param dir Directorio donde se guardará (por ejemplo REPO_DIR), o NULL para un
+ *            repositorio que solo vive en memoria.
+ * @return El repositorio, o NULL si no hay memoria.
+ */
+ugit_repo *repo_create(const char *dir)
+{
+    ugit_repo *repo = (ugit_repo *)calloc(1, sizeof(ugit_repo));
+    if (!repo) 
+    {
+        perror("Error al asignar memoria para el repositorio");
+        return NULL;
+    }
+
+    if (dir != NULL) 
+    {
+        size_t len = strlen(dir);
+        repo->dir = (char *)malloc(len + 1);
+        repo->path = (char *)malloc(len + sizeof(REPO_STORE_NAME) + 1);
+        if (!repo->dir || !repo->path) 
+        {
+            perror("Error al asignar memoria para el repositorio");
+            free(repo->dir);
+            free(repo->path);
+            free(repo);
+            return NULL;
+        }
+        memcpy(repo->dir, dir, len + 1);
+        sprintf(repo->path, "%s/%s", dir, REPO_STORE_NAME);
+        const char *slash = strrchr(dir, '/');
+        repo->worktree_len = slash ? (size_t)(slash - dir) + 1 : 0;
+    }
+
+    segment_init(&repo->commits, &repo->arena, COMMIT_CHUNK_SIZE);
+    segment_init(&repo->path_filters, &repo->arena, FILTER_CHUNK_SIZE);
+    segment_init(&repo->tree_nodes, &repo->arena, TREE_CHUNK_SIZE);
+    segment_init(&repo->string_pool, &repo->arena, POOL_CHUNK_SIZE);
+    segment_init(&repo->string_ids, &repo->arena, NAMES_CHUNK_SIZE);
+    segment_init(&repo->blob_records, &repo->arena, BLOB_CHUNK_SIZE);
+    segment_init(&repo->blob_data, &repo->arena, BLOB_DATA_CHUNK_SIZE);
+    repo->names.pool = &repo->string_pool;
+    repo->names.entries = &repo->string_ids;
+    repo->trees.nodes = &repo->tree_nodes;
+    repo->trees.names = &repo->names;
+    repo->blobs.records = &repo->blob_records;
+    repo->blobs.data = &repo->blob_data;
+    repo->trees.blobs = &repo->blobs;
+    graph_init(&repo->graph, &repo->commits);
+    repo->staging_base = TREE_EMPTY;
+    repo->head_commit = COMMIT_NONE;
+    repo->current_branch = BRANCH_NONE;
+    pthread_mutex_init(&repo->lock, NULL);
+    return repo;
+}
+
+/**
+ * @brief Libera todos los recursos del repositorio sin guardarlo.
+ * 
+ * Los nodos de archivo y los trozos de las tablas se devuelven de una vez al
+ * reiniciar la arena, sin recorrer las listas. El repositorio queda vacío y sin
+ * inicializar, listo para volver a usarse.
+ * 
+ * @param repo Repositorio.
+ */
+static void release_repo(ugit_repo *repo)
+{
+    watcher_stop(repo->watcher);
+    repo->watcher = NULL;
+    repo->file_list = NULL;
+    repo->retired_nodes = NULL;
+    repo->file_count = 0;
+    free(repo->file_index);
+    repo->file_index = NULL;
+    repo->index_capacity = 0;
+    repo->index_used = 0;
+
+    segment_release(&repo->commits);
+    segment_release(&repo->path_filters);
+    segment_release(&repo->tree_nodes);
+    segment_release(&repo->string_pool);
+    segment_release(&repo->string_ids);
+    segment_release(&repo->blob_records);
+    segment_release(&repo->blob_data);
+    intern_free(&repo->names);
+    blob_free(&repo->blobs);
+    arena_reset(&repo->arena);
+    objtable_free(&repo->commit_table);
+    graph_free(&repo->graph);
+    store_close(&repo->mapping);
+    free(repo->dirty_names);
+    repo->dirty_names = NULL;
+    repo->dirty_count = 0;
+    repo->dirty_capacity = 0;
+    free(repo->version_list);
+    free(repo->version_index);
+    repo->version_list = NULL;
+    repo->version_index = NULL;
+    repo->version_count = 0;
+    repo->version_capacity = 0;
+    repo->version_bits = 0;
+    repo->current_branch = BRANCH_NONE;
+    repo->staging_base = TREE_EMPTY;
+    repo->head_commit = COMMIT_NONE;
+    repo->initialized = 0;
+    repo->modified = 0;
+}
+
+/**
+ * @brief Guarda el repositorio y libera todos sus recursos.
+ * 
+ * Solo se escribe si algo cambió desde que se abrió o se guardó por última vez, así
+ * una sesión de solo lectura (log, status sin cambios) no reescribe el archivo.
+ * 
+ * @param repo Repositorio.
+ * @return 0 en caso de éxito, -1 si no se pudo guardar.
+ */
+int close_repo(ugit_repo *repo)
+{
+    int result = repo->initialized && repo->modified ? save_repo(repo, 0) : 0;
+    release_repo(repo);
+    return result;
+}
+
+/**
+ * @brief Destruye un repositorio creado con repo_create(), sin guardarlo.
+ * 
+ * @param repo Repositorio (puede ser NULL).
+ */
+void repo_destroy(ugit_repo *repo)
+{
+    if (!repo) return;
+    release_repo(repo);
+    pthread_mutex_destroy(&repo->lock);
+    free(repo->dir);
+    free(repo->path);
+    free(repo);
+}
+
+/**
+ * @brief Verifica si el repositorio ha sido inicializado.
+ * 
+ * Si no está inicializado, muestra un mensaje de error.
+ * 
+ * @param repo Repositorio.
+ * @return 1 si está inicializado, 0 en caso contrario.
+ */
+int check_repo_initialized(ugit_repo *repo) 
+{ 
+    if (!RCU_READ(&repo->initialized)) 
+    {
+        output_error("Error: El repositorio no ha sido inicializado. Ejecuta 'init' primero.\n");
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Busca la posición del índice que contiene un archivo.
+ * 
+ * Los nombres están internados, así que basta comparar identificadores.
+ * 
+ * @param repo Repositorio.
+ * @param name Identificador del nombre del archivo.
+ * @param hash Hash del nombre.
+ * @return Puntero a la posición del índice, o NULL si el archivo no está en preparación.
+ */
+static FileNode **index_find(ugit_repo *repo, uint32_t name, uint32_t hash)
+{
+    if (repo->index_capacity == 0) return NULL;
+
+    size_t mask = repo->index_capacity - 1;
+    for (size_t i = hash & mask; repo->file_index[i] != NULL; i = (i + 1) & mask)
+    {
+        FileNode *node = repo->file_index[i];
+        if (node != &index_tombstone && node->name == name)
+        {
+            return &repo->file_index[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Inserta un nodo en el índice sin comprobar duplicados.
+ * 
+ * @param repo Repositorio.
+ * @param node Nodo a insertar (con su hash ya calculado).
+ */
+static void index_put(ugit_repo *repo, FileNode *node)
+{
+    size_t mask = repo->index_capacity - 1;
+    size_t i = node->hash & mask;
+    while (repo->file_index[i] != NULL && repo->file_index[i] != &index_tombstone)
+    {
+        i = (i + 1) & mask;
+    }
+    if (repo->file_index[i] == NULL) repo->index_used++;
+    repo->file_index[i] = node;
+}
+
+/**
+ * @brief Garantiza espacio para @p extra nodos más en el índice.
+ * 
+ * Cuando las posiciones ocupadas (incluyendo lápidas) superarían el 70% de la capacidad,
+ * reconstruye el índice a partir de @c file_list, descartando las lápidas. Reservar de
+ * una vez todo un lote evita reconstruirlo varias veces mientras se agrega.
+ * 
+ * @param repo Repositorio.
+ * @param extra Cantidad de nodos que se van a agregar.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+static int index_reserve(ugit_repo *repo, size_t extra)
+{
+    if ((repo->index_used + extra) * 10 < repo->index_capacity * 7) return 0;
+
+    size_t capacity = 16;
+    while ((repo->file_count + extra) * 2 > capacity) capacity *= 2;
+
+    FileNode **table = (FileNode **)calloc(capacity, sizeof(FileNode *));
+    if (!table)
+    {
+        perror("Error al asignar memoria para el índice");
+        return -1;
+    }
+
+    free(repo->file_index);
+    repo->file_index = table;
+    repo->index_capacity = capacity;
+    repo->index_used = 0;
+    for (FileNode *node = repo->file_list; node != NULL; node = node->next)
+    {
+        index_put(repo, node);
+    }
+    return 0;
+}
+
+/**
+ * @brief Inserta un nodo nuevo al inicio de @c file_list y en el índice.
+ * 
+ * No comprueba duplicados; quien llama debe haberlo hecho con index_find().
+ * 
+ * @param repo Repositorio.
+ * @param name Identificador del nombre del archivo.
+ * @param hash Hash del nombre.
+ * @param blob Índice del blob con el contenido del archivo.
+ * @return El nodo creado (tomado de la arena), o NULL si no hay memoria.
+ */
+static FileNode *stage_file(ugit_repo *repo, uint32_t name, uint32_t hash, uint32_t blob)
+{
+    if (index_reserve(repo, 1) != 0) return NULL;
+
+    FileNode *new_node = (FileNode *)arena_alloc_node(&repo->arena, sizeof(FileNode));  
+    if (!new_node) return NULL;
+    
+    new_node->name = name;
+    new_node->hash = hash;
+    new_node->blob = blob;
+    stat_cache_clear(&new_node->stat);
+    new_node->prev = NULL;
+    new_node->next = repo->file_list;
+    if (repo->file_list != NULL) repo->file_list->prev = new_node;
+    RCU_PUBLISH(&repo->file_list, new_node);
+    index_put(repo, new_node);
+    repo->file_count++;
+    repo->modified = 1;
+    return new_node;
+}
+
+/**
+ * @brief Quita un nodo del área de preparación y lo deja pendiente de reciclar.
+ * 
+ * El nodo conserva su enlace @c next, así un lector que está sobre él sigue
+ * recorriendo la lista; vuelve a la arena en recycle_nodes().
+ * 
+ * @param repo Repositorio.
+ * @param slot Posición del índice que apunta al nodo (obtenida con index_find()).
+ */
+static void unstage_file(ugit_repo *repo, FileNode **slot)
+{
+    FileNode *current = *slot;
+    *slot = &index_tombstone;
+
+    if (current->prev == NULL) 
+    {
+        RCU_PUBLISH(&repo->file_list, current->next);
+    } 
+    else 
+    {
+        RCU_PUBLISH(&current->prev->next, current->next);
+    }
+    if (current->next != NULL) current->next->prev = current->prev;
+
+    repo->file_count--;
+    repo->modified = 1;
+    current->prev = repo->retired_nodes;
+    repo->retired_nodes = current;
+}
+
+/**
+ * @brief Registra que un nombre cambió en el área de preparación desde @c staging_base.
+ * 
+ * Solo se guarda el nombre; su estado final se consulta en el índice al hacer commit
+ * o checkout.
+ * 
+ * @param repo Repositorio.
+ * @param name Identificador del nombre del archivo.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+static int log_dirty(ugit_repo *repo, uint32_t name)
+{
+    if (repo->dirty_count == repo->dirty_capacity) 
+    {
+        size_t capacity = repo->dirty_capacity ? repo->dirty_capacity * 2 : 64;
+        uint32_t *log = (uint32_t *)realloc(repo->dirty_names, capacity * sizeof(uint32_t));
+        if (!log) 
+        {
+            perror("Error al asignar memoria");
+            return -1;
+        }
+        repo->dirty_names = log;
+        repo->dirty_capacity = capacity;
+    }
+    repo->dirty_names[repo->dirty_count++] = name;
+    repo->modified = 1;
+    if (repo->watcher) watcher_mark(repo->watcher, intern_string(&repo->names, name));
+    return 0;
+}
+
+/**
+ * @brief Busca una rama por el identificador de su nombre.
+ * 
+ * @param repo Repositorio.
+ * @param name Identificador del nombre de la rama.
+ * @return Posición de la rama en @c version_list, o BRANCH_NONE si no existe.
+ */
+static uint32_t branch_find(ugit_repo *repo, uint32_t name)
+{
+    if (repo->version_index == NULL) return BRANCH_NONE;
+
+    size_t mask = ((size_t)1 << repo->version_bits) - 1;
+    for (size_t i = intern_hash(&repo->names, name) & mask; repo->version_index[i] != 0; i = (i + 1) & mask) 
+    {
+        uint32_t position = repo->version_index[i] - 1;
+        if (repo->version_list[position].nombre == name) return position;
+    }
+    return BRANCH_NONE;
+}
+
+/**
+ * @brief Coloca una rama en el índice sin comprobar duplicados.
+ * 
+ * @param repo Repositorio con espacio en el índice.
+ * @param position Posición de la rama en @c version_list.
+ */
+static void branch_index_put(ugit_repo *repo, uint32_t position)
+{
+    size_t mask = ((size_t)1 << repo->version_bits) - 1;
+    size_t i = intern_hash(&repo->names, repo->version_list[position].nombre) & mask;
+    while (repo->version_index[i] != 0) i = (i + 1) & mask;
+    repo->version_index[i] = position + 1;
+}
+
+/**
+ * @brief Agrega una rama al final de la tabla de ramas.
+ * 
+ * El índice se mantiene con factor de carga bajo 1/2 y se reconstruye al crecer.
+ * 
+ * @param repo Repositorio.
+ * @param name Identificador del nombre (no debe existir ya una rama con ese nombre).
+ * @param commit_index Commit al que apunta, o COMMIT_NONE.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+static int branch_add(ugit_repo *repo, uint32_t name, uint32_t commit_index)
+{
+    if (repo->version_count == repo->version_capacity) 
+    {
+        uint32_t capacity = repo->version_capacity ? repo->version_capacity * 2 : 8;
+        versionGit *list = (versionGit *)realloc(repo->version_list, capacity * sizeof(versionGit));
+        if (!list) 
+        {
+            perror("Error al asignar memoria para las ramas");
+            return -1;
+        }
+        repo->version_list = list;
+        repo->version_capacity = capacity;
+    }
+
+    if (((size_t)repo->version_count + 1) * 2 > ((size_t)1 << repo->version_bits)) 
+    {
+        unsigned int bits = repo->version_index ? repo->version_bits + 1 : 4;
+        uint32_t *index = (uint32_t *)calloc((size_t)1 << bits, sizeof(uint32_t));
+        if (!index) 
+        {
+            perror("Error al asignar memoria para las ramas");
+            return -1;
+        }
+        free(repo->version_index);
+        repo->version_index = index;
+        repo->version_bits = bits;
+        for (uint32_t i = 0; i < repo->version_count; i++) branch_index_put(repo, i);
+    }
+
+    repo->version_list[repo->version_count].nombre = name;
+    repo->version_list[repo->version_count].commit = commit_index;
+    branch_index_put(repo, repo->version_count);
+    repo->version_count++;
+    repo->modified = 1;
+    return 0;
+}
+
+/**
+ * @brief Busca una rama por su nombre.
+ * 
+ * @param repo Repositorio.
+ * @param branch Nombre de la rama.
+ * @return Posición de la rama, o BRANCH_NONE si no existe.
+ */
+static uint32_t branch_lookup(ugit_repo *repo, const char *branch)
+{
+    uint32_t name = intern_find(&repo->names, branch);
+    return name == INTERN_NONE ? BRANCH_NONE : branch_find(repo, name);
+}
+
+/**
+ * @brief Arma la ruta de un archivo dentro del árbol de trabajo.
+ * 
+ * @param repo Repositorio.
+ * @param name Ruta relativa al árbol de trabajo.
+ * @param path Destino de PATH_MAX caracteres.
+ * @return 0 en caso de éxito, -1 si la ruta es demasiado larga.
+ */
+static int work_path(ugit_repo *repo, const char *name, char *path)
+{
+    int len = snprintf(path, PATH_MAX, "%.*s%s", (int)repo->worktree_len, repo->dir ? repo->dir : "", name);
+    if (len < 0 || len >= PATH_MAX) 
+    {
+        output_error("Error: La ruta {path:s} es demasiado larga.\n", name);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Indica si un nombre es una ruta relativa que queda dentro del árbol de trabajo.
+ * 
+ * Rechaza rutas absolutas, componentes vacíos, "." y "..", y las que entran al
+ * directorio del repositorio.
+ * 
+ * @param repo Repositorio.
+ * @param filename Nombre entregado por el usuario.
+ * @return 1 si es válido, 0 si no.
+ */
+static int valid_work_name(ugit_repo *repo, const char *filename)
+{
+    const char *repo_name = repo->dir ? repo->dir + repo->worktree_len : NULL;
+    for (const char *part = filename;;) 
+    {
+        size_t len = strcspn(part, "/");
+        if (len == 0 || (len == 1 && part[0] == '.') || (len == 2 && part[0] == '.' && part[1] == '.')) return 0;
+        if (part == filename && repo_name && strlen(repo_name) == len && strncmp(part, repo_name, len) == 0) return 0;
+        if (part[len] == '\0') return 1;
+        part += len + 1;
+    }
+}
+
+/// Resultado de poner un contenido en el área de preparación.
+enum 
+{
+    STAGE_UNCHANGED, ///< El archivo ya estaba con ese contenido.
+    STAGE_REPLACED, ///< El archivo estaba con otro contenido.
+    STAGE_ADDED ///< El archivo no estaba.
+};
+
+/**
+ * @brief Pone un archivo con un contenido dado en el área de preparación.
+ * 
+ * @param repo Repositorio.
+ * @param filename Nombre del archivo (ya validado).
+ * @param blob Índice del blob con el contenido.
+ * @param stat Datos de stat del archivo cuando se leyó ese contenido.
+ * @return STAGE_UNCHANGED, STAGE_REPLACED o STAGE_ADDED, o -1 si no hay memoria.
+ */
+static int stage_content(ugit_repo *repo, const char *filename, uint32_t blob, const FileStat *stat)
+{
+    uint32_t name;
+    if (intern_add(&repo->names, filename, &name) != 0) return -1;
+
+    uint32_t hash = intern_hash(&repo->names, name);
+    FileNode **slot = index_find(repo, name, hash);
+    if (slot != NULL) 
+    { 
+        (*slot)->stat = *stat;
+        repo->modified = 1;
+        if ((*slot)->blob == blob) return STAGE_UNCHANGED;
+        if (log_dirty(repo, name) != 0) return -1;
+        (*slot)->blob = blob;
+        return STAGE_REPLACED;
+    }
+
+    if (log_dirty(repo, name) != 0) return -1;
+    FileNode *node = stage_file(repo, name, hash, blob);
+    if (node == NULL) return -1;
+    node->stat = *stat;
+    return STAGE_ADDED;
+}
+
+/**
+ * @brief Busca el blob preparado de un archivo, para usarlo como base de su versión nueva.
+ * 
+ * @param repo Repositorio.
+ * @param filename Nombre del archivo.
+ * @return Blob preparado, o BLOB_NONE si el archivo no está en preparación.
+ */
+static uint32_t staged_blob(ugit_repo *repo, const char *filename)
+{
+    uint32_t name = intern_find(&repo->names, filename);
+    if (name == INTERN_NONE) return BLOB_NONE;
+    FileNode **slot = index_find(repo, name, intern_hash(&repo->names, name));
+    return slot != NULL ? (*slot)->blob : BLOB_NONE;
+}
+
+/**
+ * @brief Agrega un archivo al área de preparación.
+ * 
+ * Lee el archivo del árbol de trabajo y guarda su contenido como blob. Si el archivo
+ * ya estaba en preparación, reemplaza su contenido, guardando el nuevo como delta
+ * contra el anterior si conviene.
+ * 
+ * @param repo Repositorio.
+ * @param filename Nombre del archivo a agregar.
+ * @return 0 en caso de éxito, -1 si ocurre un error.
+ */
+static int add_locked(ugit_repo *repo, const char *filename)  
+{
+    if (!check_repo_initialized(repo)) return -1;
+    if (!valid_work_name(repo, filename)) 
+    {
+        output_error("Error: Ruta no válida: {path:s}\n", filename);
+        return -1;
+    }
+
+    char path[PATH_MAX];
+    uint32_t blob;
+    struct stat info;
+    if (work_path(repo, filename, path) != 0) return -1;
+    int found = blob_read_file(&repo->blobs, path, staged_blob(repo, filename), &blob, &info);
+    if (found < 0) return -1;
+    if (found > 0) 
+    {
+        output_error("Archivo no encontrado: {path:s}\n", filename);
+        return -1;
+    }
+
+    FileStat stat;
+    stat_cache_record(&stat, &info);
+    switch (stage_content(repo, filename, blob, &stat)) 
+    {
+    case STAGE_UNCHANGED:
+        output_event("add", "El archivo {path:s} no tiene cambios.\n", filename);
+        return 0;
+    case STAGE_REPLACED:
+        output_event("add", "El archivo {path:s} ya existe. Reemplazando el archivo.\n", filename);
+        return 0;
+    case STAGE_ADDED:
+        output_event("add", "Archivo {path:s} agregado al área de preparación.\n", filename);
+        return 0;
+    default:
+        return -1;
+    }
+}
+
+/**
+ * @brief Agrega un archivo al área de preparación tomando el lock de escritura.
+ * 
+ * @param repo Repositorio.
+ * @param filename Nombre del archivo a agregar.
+ * @return 0 en caso de éxito, -1 si ocurre un error.
+ */
+int add_file(ugit_repo *repo, const char *filename)
+{
+    lock_repo(repo);
+    return unlock_repo(repo, add_locked(repo, filename));
+}
+
+/**
+ * @brief Lista de rutas de archivos a agregar en lote.
+ */
+typedef struct PathList 
+{
+    char **items; ///< Rutas completas (prefijo del árbol de trabajo + nombre), cada una con malloc.
+    size_t count; ///< Rutas en la lista.
+    size_t capacity; ///< Capacidad de @c items.
+} PathList;
+
+/**
+ * @brief Agrega una copia de una ruta al final de la lista.
+ * 
+ * @param list Lista de rutas.
+ * @param path Ruta completa.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+static int path_list_push(PathList *list, const char *path)
+{
+    if (list->count == list->capacity) 
+    {
+        size_t capacity = list->capacity ? list->capacity * 2 : 64;
+        char **items = (char **)realloc(list->items, capacity * sizeof(char *));
+        if (!items) 
+        {
+            perror("Error al asignar memoria para la lista de archivos");
+            return -1;
+        }
+        list->items = items;
+        list->capacity = capacity;
+    }
+
+    char *copy = (char *)malloc(strlen(path) + 1);
+    if (!copy) 
+    {
+        perror("Error al asignar memoria para la lista de archivos");
+        return -1;
+    }
+    strcpy(copy, path);
+    list->items[list->count++] = copy;
+    return 0;
+}
+
+/**
+ * @brief Libera las rutas de la lista.
+ * 
+ * @param list Lista de rutas.
+ */
+static void path_list_free(PathList *list)
+{
+    for (size_t i = 0; i < list->count; i++) free(list->items[i]);
+    free(list->items);
+}
+
+/**
+ * @brief Compara dos rutas para ordenarlas con qsort().
+ * 
+ * @param a Puntero a la primera ruta.
+ * @param b Puntero a la segunda ruta.
+ * @return Resultado de strcmp().
+ */
+static int compare_paths(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/**
+ * @brief Agrega a la lista los archivos regulares bajo un directorio, recursivamente.
+ * 
+ * Omite los enlaces simbólicos y los archivos especiales, y en la raíz del árbol de
+ * trabajo también el directorio del repositorio. Solo recorre; la lectura de los
+ * archivos queda para los hilos de hashpool_run().
+ * 
+ * @param repo Repositorio.
+ * @param name Directorio relativo al árbol de trabajo ("" para la raíz).
+ * @param list Lista donde agregar las rutas.
+ * @return 0 en caso de éxito, -1 si ocurrió un error.
+ */
+static int collect_dir(ugit_repo *repo, const char *name, PathList *list)
+{
+    char path[PATH_MAX];
+    if (name[0] == '\0' && repo->worktree_len == 0) strcpy(path, ".");
+    else if (work_path(repo, name, path) != 0) return -1;
+
+    DIR *dir = opendir(path);
+    if (!dir) 
+    {
+        output_error("Error: No se pudo abrir el directorio {path:s}: {reason:s}\n", name[0] ? name : ".", strerror(errno));
+        return -1;
+    }
+
+    const char *repo_name = repo->dir ? repo->dir + repo->worktree_len : NULL;
+    char child[PATH_MAX];
+    int result = 0;
+    for (struct dirent *entry = readdir(dir); entry != NULL && result == 0; entry = readdir(dir)) 
+    {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+        if (name[0] == '\0' && repo_name && strcmp(entry->d_name, repo_name) == 0) continue;
+
+        int len = snprintf(child, sizeof(child), "%s%s%s", name, name[0] ? "/" : "", entry->d_name);
+        if (len < 0 || len >= PATH_MAX) 
+        {
+            output_error("Error: La ruta {path:s} es demasiado larga.\n", entry->d_name);
+            result = -1;
+            break;
+        }
+        if (work_path(repo, child, path) != 0) 
+        {
+            result = -1;
+            break;
+        }
+
+        unsigned char type = entry->d_type;
+        if (type == DT_UNKNOWN) 
+        {
+            struct stat info;
+            if (lstat(path, &info) != 0) continue;
+            type = S_ISDIR(info.st_mode) ? DT_DIR : S_ISREG(info.st_mode) ? DT_REG : DT_LNK;
+        }
+        if (type == DT_DIR) result = collect_dir(repo, child, list);
+        else if (type == DT_REG) result = path_list_push(list, path);
+    }
+    closedir(dir);
+    return result;
+}
+
+/**
+ * @brief Agrega a la lista un archivo, o todos los de un directorio.
+ * 
+ * @param repo Repositorio.
+ * @param filename Ruta entregada por el usuario ("." es todo el árbol de trabajo).
+ * @param list Lista donde agregar las rutas.
+ * @return 0 en caso de éxito, -1 si ocurrió un error.
+ */
+static int collect_paths(ugit_repo *repo, const char *filename, PathList *list)
+{
+    char name[PATH_MAX];
+    size_t len = strlen(filename);
+    while (len > 1 && filename[len - 1] == '/') len--;
+    if (len >= PATH_MAX) 
+    {
+        output_error("Error: La ruta {path:s} es demasiado larga.\n", filename);
+        return -1;
+    }
+    memcpy(name, filename, len);
+    name[len] = '\0';
+
+    if (strcmp(name, ".") == 0) return collect_dir(repo, "", list);
+    if (!valid_work_name(repo, name)) 
+    {
+        output_error("Error: Ruta no válida: {path:s}\n", filename);
+        return -1;
+    }
+
+    char path[PATH_MAX];
+    struct stat info;
+    if (work_path(repo, name, path) != 0) return -1;
+    if (stat(path, &info) == 0 && S_ISDIR(info.st_mode)) return collect_dir(repo, name, list);
+    return path_list_push(list, path);
+}
+
+/**
+ * @brief Estado de un agregado en lote mientras llegan los resultados de los lectores.
+ */
+typedef struct BulkAdd 
+{
+    ugit_repo *repo; ///< Repositorio.
+    char *const *paths; ///< Rutas completas de los archivos.
+    uint32_t *blobs; ///< Blob de cada archivo, en el orden de @c paths.
+    FileStat *stats; ///< Datos de stat de cada archivo, en el orden de @c paths.
+} BulkAdd;
+
+/**
+ * @brief Arma, en el hilo del lector, los bytes a guardar de un archivo ya leído.
+ * 
+ * El delta se calcula contra el blob que el archivo tiene en preparación. El índice de
+ * preparación no cambia hasta que termina la lectura del lote, y los blobs que agrega
+ * bulk_add_result() mientras tanto admiten lectores concurrentes.
+ * 
+ * @param result Resultado del lector.
+ * @param data Estado del agregado (BulkAdd).
+ */
+static void bulk_add_prepare(HashResult *result, void *data)
+{
+    BulkAdd *bulk = (BulkAdd *)data;
+    uint32_t base = staged_blob(bulk->repo, bulk->paths[result->index] + bulk->repo->worktree_len);
+    blob_prepare(&bulk->repo->blobs, &result->id, result->content, result->size, base, &result->stored);
+}
+
+/**
+ * @brief Guarda como blob los bytes de un archivo ya leído y preparado por un lector.
+ * 
+ * @param result Resultado del lector.
+ * @param data Estado del agregado (BulkAdd).
+ * @return 0 para continuar, -1 para detener el lote.
+ */
+static int bulk_add_result(const HashResult *result, void *data)
+{
+    BulkAdd *bulk = (BulkAdd *)data;
+    if (result->error != 0) 
+    {
+        blob_load_error(bulk->paths[result->index] + bulk->repo->worktree_len, result->error);
+        return -1;
+    }
+    stat_cache_record(&bulk->stats[result->index], &result->info);
+    return blob_add_prepared(&bulk->repo->blobs, &result->stored, &bulk->blobs[result->index]);
+}
+
+/**
+ * @brief Pone en preparación una lista de archivos leyéndolos en paralelo.
+ * 
+ * Ordena la lista y quita las rutas repetidas, lee y calcula el hash de los archivos
+ * con hashpool_run() y al final los pone en preparación de una vez, en orden de ruta y
+ * con el índice reservado para todo el lote. Si algún archivo no se puede leer no se
+ * agrega ninguno (los blobs ya guardados quedan sin usar).
+ * 
+ * @param repo Repositorio.
+ * @param list Rutas completas de los archivos (se ordena).
+ * @param outcomes Cantidad de archivos por resultado (STAGE_UNCHANGED, STAGE_REPLACED, STAGE_ADDED).
+ * @return 0 en caso de éxito, -1 si ocurre un error.
+ */
+static int add_batch(ugit_repo *repo, PathList *list, size_t outcomes[3])
+{
+    if (list->count > 0) qsort(list->items, list->count, sizeof(char *), compare_paths);
+    size_t unique = 0;
+    for (size_t i = 0; i < list->count; i++) 
+    {
+        if (unique > 0 && strcmp(list->items[unique - 1], list->items[i]) == 0) free(list->items[i]);
+        else list->items[unique++] = list->items[i];
+    }
+    list->count = unique;
+
+    BulkAdd bulk = { repo, list->items, NULL, NULL };
+    bulk.blobs = (uint32_t *)malloc((list->count ? list->count : 1) * sizeof(uint32_t));
+    bulk.stats = (FileStat *)malloc((list->count ? list->count : 1) * sizeof(FileStat));
+    if (!bulk.blobs || !bulk.stats) 
+    {
+        perror("Error al asignar memoria para la lista de archivos");
+        free(bulk.blobs);
+        free(bulk.stats);
+        return -1;
+    }
+
+    int result = hashpool_run(list->items, list->count, bulk_add_prepare, bulk_add_result, &bulk);
+    if (result == 0) result = index_reserve(repo, list->count);
+    for (size_t i = 0; i < list->count && result == 0; i++) 
+    {
+        int outcome = stage_content(repo, list->items[i] + repo->worktree_len, bulk.blobs[i], &bulk.stats[i]);
+        if (outcome < 0) result = -1;
+        else outcomes[outcome]++;
+    }
+
+    free(bulk.blobs);
+    free(bulk.stats);
+    return result == 0 ? 0 : -1;
+}
+
+/**
+ * @brief Agrega varios archivos o directorios al área de preparación.
+ * 
+ * Junta las rutas y las agrega con add_batch(). Un único archivo se agrega con
+ * add_locked(), que informa su resultado.
+ * 
+ * @param repo Repositorio.
+ * @param filenames Rutas relativas al árbol de trabajo.
+ * @param count Cantidad de rutas.
+ * @return 0 en caso de éxito, -1 si ocurre un error.
+ */
+static int add_paths_locked(ugit_repo *repo, const char *const *filenames, size_t count)
+{
+    if (!check_repo_initialized(repo)) return -1;
+
+    PathList list = { NULL, 0, 0 };
+    for (size_t i = 0; i < count; i++) 
+    {
+        if (collect_paths(repo, filenames[i], &list) != 0) 
+        {
+            path_list_free(&list);
+            return -1;
+        }
+    }
+    if (count == 1 && list.count == 1 && strcmp(list.items[0] + repo->worktree_len, filenames[0]) == 0) 
+    {
+        path_list_free(&list);
+        return add_locked(repo, filenames[0]);
+    }
+
+    size_t outcomes[3] = { 0, 0, 0 };
+    int result = add_batch(repo, &list, outcomes);
+    if (result == 0) 
+    {
+        output_event("add", "{added:z} archivos agregados, {modified:z} reemplazados y {unchanged:z} sin cambios.\n", outcomes[STAGE_ADDED], outcomes[STAGE_REPLACED], outcomes[STAGE_UNCHANGED]);
+    }
+    path_list_free(&list);
+    return result;
+}
+
+/**
+ * @brief Agrega varios archivos o directorios tomando el lock de escritura.
+ * 
+ * @param repo Repositorio.
+ * @param filenames Rutas relativas al árbol de trabajo.
+ * @param count Cantidad de rutas.
+ * @return 0 en caso de éxito, -1 si ocurre un error.
+ */
+int add_paths(ugit_repo *repo, const char *const *filenames, size_t count)
+{
+    lock_repo(repo);
+    return unlock_repo(repo, add_paths_locked(repo, filenames, count));
+}
+
+/**
+ * @brief Elimina un archivo del área de preparación.
+ * 
+ * @param repo Repositorio.
+ * @param filename Nombre del archivo a eliminar.
+ * @return 0 en caso de éxito, -1 si ocurre un error.
+ */
+static int remove_locked(ugit_repo *repo, const char *filename) 
+{ 
+    if (!check_repo_initialized(repo)) return -1;
+
+    uint32_t name = intern_find(&repo->names, filename);
+    FileNode **slot = name == INTERN_NONE ? NULL : index_find(repo, name, intern_hash(&repo->names, name));
+    if (slot == NULL) 
+    { 
+        output_error("Archivo no encontrado: {path:s}\n", filename);
+        return -1;
+    }
+
+    if (log_dirty(repo, name) != 0) return -1;
+    unstage_file(repo, slot);
+    output_event("rm", "Archivo {path:s} eliminado.\n", filename);
+    return 0;
+}
+
+/**
+ * @brief Elimina un archivo del área de preparación tomando el lock de escritura.
+ * 
+ * @param repo Repositorio.
+ * @param filename Nombre del archivo a eliminar.
+ * @return 0 en caso de éxito, -1 si ocurre un error.
+ */
+int remove_file(ugit_repo *repo, const char *filename)
+{
+    lock_repo(repo);
+    return unlock_repo(repo, remove_locked(repo, filename));
+}
+
+/**
+ * @brief Cantidad de commits en la tabla de commits.
+ * 
+ * @param repo Repositorio.
+ * @return Número de registros (mapeados y nuevos).
+ */
+static uint32_t commit_count(ugit_repo *repo)
+{
+    return (uint32_t)(segment_size(&repo->commits) / sizeof(commitGit));
+}
+
+/**
+ * @brief Obtiene un commit por su índice en la tabla de commits.
+ * 
+ * @param repo Repositorio.
+ * @param index Índice menor que commit_count().
+ * @return Registro del commit (solo lectura).
+ */
+static const commitGit *commit_at(ugit_repo *repo, uint32_t index)
+{
+    return (const commitGit *)segment_at(&repo->commits, (size_t)index * sizeof(commitGit));
+}
+
+/**
+ * @brief Calcula el identificador de un commit.
+ * 
+ * El commit serializa el identificador de su árbol, sus padres (si existen) y el
+ * mensaje, igual que un objeto commit de Git.
+ * 
+ * @param repo Repositorio.
+ * @param new_commit Commit con árbol, mensaje y padres asignados.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+static int hash_commit(ugit_repo *repo, commitGit *new_commit)
+{
+    const char *mensaje = intern_string(&repo->names, new_commit->mensaje);
+    char *buffer = (char *)malloc(strlen(mensaje) + (1 + COMMIT_MAX_PARENTS) * (OBJECT_HEX_LENGTH + 16));
+    if (!buffer) 
+    {
+        perror("Error al asignar memoria para el commit");
+        return -1;
+    }
+
+    char hex[OBJECT_HEX_LENGTH + 1];
+    object_id_to_hex(&new_commit->tree, hex);
+    size_t len = (size_t)sprintf(buffer, "tree %s\n", hex);
+    for (int i = 0; i < COMMIT_MAX_PARENTS && new_commit->parents[i] != COMMIT_NONE; i++) 
+    {
+        object_id_to_hex(&commit_at(repo, new_commit->parents[i])->id, hex);
+        len += (size_t)sprintf(buffer + len, "parent %s\n", hex);
+    }
+    len += (size_t)sprintf(buffer + len, "\n%s", mensaje);
+    object_hash("commit", buffer, len, &new_commit->id);
+
+    free(buffer);
+    return 0;
+}
+
+/**
+ * @brief Construye el árbol del área de preparación actual.
+ * 
+ * Aplica al árbol base solo los nombres registrados como modificados, de modo que el
+ * árbol nuevo comparte todos los demás nodos con el anterior. Sin cambios, la raíz es
+ * la misma y no se crea ningún nodo.
+ * 
+ * @param repo Repositorio.
+ * @param root Raíz del árbol resultante.
+ * @return 0 en caso de éxito, -1 si ocurre un error.
+ */
+static int build_staging_tree(ugit_repo *repo, uint32_t *root)
+{
+    *root = repo->staging_base;
+    if (repo->dirty_count == 0) return 0;
+
+    TreeChange *changes = (TreeChange *)malloc(repo->dirty_count * sizeof(TreeChange));
+    if (!changes) 
+    {
+        perror("Error al asignar memoria para el commit");
+        return -1;
+    }
+    for (size_t i = 0; i < repo->dirty_count; i++) 
+    {
+        changes[i].name = repo->dirty_names[i];
+        changes[i].hash = intern_hash(&repo->names, repo->dirty_names[i]);
+        FileNode **slot = index_find(repo, repo->dirty_names[i], changes[i].hash);
+        changes[i].blob = slot ? (*slot)->blob : BLOB_NONE;
+    }
+
+    int result = tree_apply(&repo->trees, repo->staging_base, changes, repo->dirty_count, root);
+    free(changes);
+    return result;
+}
+
+/**
+ * @brief Busca un commit por identificador, prefijo de identificador o mensaje.
+ * 
+ * Los mensajes están internados: si el texto no está en la tabla de cadenas ningún
+ * commit lo usa, y si está, la búsqueda compara identificadores. Se revisan todos los
+ * commits, de cualquier rama, desde el más reciente.
+ * 
+ * @param repo Repositorio.
+ * @param commit_id Texto entregado por el usuario.
+ * @return Índice del commit encontrado, o COMMIT_NONE si no existe o el prefijo es ambiguo.
+ */
+static uint32_t find_commit(ugit_repo *repo, const char *commit_id)
+{
+    uint32_t ref = 0;
+    int matches = objtable_find_prefix(&repo->commit_table, commit_id, &ref);
+    if (matches == 1) return ref - 1;
+    if (matches > 1) 
+    {
+        output_error("Error: El prefijo '{prefix:s}' es ambiguo.\n", commit_id);
+        return COMMIT_NONE;
+    }
+
+    uint32_t mensaje = intern_find(&repo->names, commit_id);
+    for (uint32_t i = mensaje == INTERN_NONE ? 0 : commit_count(repo); i-- > 0;) 
+    {
+        if (commit_at(repo, i)->mensaje == mensaje) return i;
+    }
+    output_error("Error: Commit con ID '{commit:s}' no encontrado.\n", commit_id);
+    return COMMIT_NONE;
+}
+
+/**
+ * @brief Hashes de los nombres que cambia un commit, para armar su filtro de rutas.
+ */
+typedef struct FilterPaths 
+{
+    ugit_repo *repo; ///< Repositorio.
+    uint32_t hashes[PATH_FILTER_MAX_PATHS]; ///< Hash de cada nombre cambiado.
+    size_t count; ///< Nombres cambiados; pasa de PATH_FILTER_MAX_PATHS si hay demasiados.
+} FilterPaths;
+
+/**
+ * @brief Anota un nombre que cambia respecto del primer padre.
+ * 
+ * @param name Identificador del nombre.
+ * @param blob Contenido en el commit nuevo (no se usa).
+ * @param data FilterPaths donde se anota.
+ * @return 0 para seguir, 1 si ya hay más nombres de los que caben en el filtro.
+ */
+static int filter_path(uint32_t name, uint32_t blob, void *data)
+{
+    FilterPaths *paths = (FilterPaths *)data;
+    (void)blob;
+    if (paths->count == PATH_FILTER_MAX_PATHS) 
+    {
+        paths->count++;
+        return 1;
+    }
+    paths->hashes[paths->count++] = intern_hash(&paths->repo->names, name);
+    return 0;
+}
+
+/**
+ * @brief Crea un commit con los archivos en el área de preparación.
+ * 
+ * El árbol del commit se obtiene del árbol base más los cambios del área de
+ * preparación, compartiendo los nodos que no cambiaron, y el registro del nuevo
+ * commit se agrega al final de la tabla de commits. Su primer padre es HEAD; si HEAD
+ * está en una rama, la rama avanza al commit nuevo. El filtro de rutas del commit se
+ * arma comparando el árbol base, que es el del primer padre, con el árbol nuevo: así
+ * cada nombre cuenta una vez y no entran los que volvieron a su contenido original,
+ * aunque figuren entre los nombres modificados. Si ya existe un commit con el mismo
+ * identificador (mismo árbol, padres y mensaje, hecho desde otra rama), HEAD pasa a ese
+ * commit en vez de agregar un registro duplicado.
+ * 
+ * @param repo Repositorio.
+ * @param mensaje Mensaje descriptivo del commit.
+ * @param merge_parent Segundo padre (commit unido con merge), o COMMIT_NONE.
+ * @return 0 en caso de éxito, -1 si ocurre un error.
+ */
+static int create_commit(ugit_repo *repo, const char *mensaje, uint32_t merge_parent)
+{ 
+    commitGit new_commit;
+    memset(&new_commit, 0, sizeof(new_commit));
+    if (build_staging_tree(repo, &new_commit.archivos) != 0) return -1;
+    tree_id(&repo->trees, new_commit.archivos, &new_commit.tree);
+    if (intern_add(&repo->names, mensaje, &new_commit.mensaje) != 0) return -1;
+
+    new_commit.parents[0] = repo->head_commit;
+    new_commit.parents[1] = merge_parent;
+    new_commit.generation = graph_generation(&repo->graph, new_commit.parents);
+    if (hash_commit(repo, &new_commit) != 0) return -1;
+
+    uint32_t existing = objtable_find(&repo->commit_table, &new_commit.id);
+    uint32_t position = existing != 0 ? existing - 1 : commit_count(repo);
+    if (existing == 0) 
+    {
+        FilterPaths paths;
+        paths.repo = repo;
+        paths.count = 0;
+        if (tree_diff(&repo->trees, repo->staging_base, new_commit.archivos, filter_path, &paths) < 0) return -1;
+        PathFilter filter;
+        path_filter_build(&filter, paths.hashes, paths.count);
+
+        if (segment_append(&repo->path_filters, &filter, sizeof(filter), NULL) != 0) return -1;
+        if (segment_append(&repo->commits, &new_commit, sizeof(new_commit), NULL) != 0) 
+        {
+            repo->path_filters.tail_len -= sizeof(filter);
+            return -1;
+        }
+        if (objtable_insert(&repo->commit_table, &new_commit.id, position + 1) != 0) 
+        {
+            repo->path_filters.tail_len -= sizeof(filter);
+            repo->commits.tail_len -= sizeof(new_commit);
+            return -1;
+        }
+    }
+    RCU_PUBLISH(&repo->head_commit, position);
+    if (repo->current_branch != BRANCH_NONE) repo->version_list[repo->current_branch].commit = position;
+    repo->staging_base = new_commit.archivos;
+    repo->dirty_count = 0;
+    repo->modified = 1;
+
+    char hex[OBJECT_HEX_LENGTH + 1];
+    object_id_to_hex(&new_commit.id, hex);
+    output_event("commit", "Commit creado con éxito: [{id:a}] {message:s}\n", hex, mensaje);
+    return 0;
+}
+
+/**
+ * @brief Crea un commit normal (un solo padre) con el área de preparación.
+ * 
+ * @param repo Repositorio.
+ * @param mensaje Mensaje descriptivo del commit.
+ * @return 0 en caso de éxito, -1 si ocurre un error.
+ */
+static int commit_locked(ugit_repo *repo, const char *mensaje)
+{
+    if (!check_repo_initialized(repo)) return -1;
+    return create_commit(repo, mensaje, COMMIT_NONE);
+}
+
+/**
+ * @brief Crea un commit tomando el lock de escritura.
+ * 
+ * @param repo Repositorio.
+ * @param mensaje Mensaje descriptivo del commit.
+ * @return 0 en caso de éxito, -1 si ocurre un error.
+ */
+int commit(ugit_repo *repo, const char *mensaje)
+{
+    lock_repo(repo);
+    return unlock_repo(repo, commit_locked(repo, mensaje));
+}
+
+/**
+ * @brief Prepara opciones que muestran toda la historia.
+ * 
+ * @param options Opciones a llenar.
+ */
+void log_options_init(LogOptions *options)
+{
+    memset(options, 0, sizeof(*options));
+    options->limit = SIZE_MAX;
+}
+
+/**
+ * @brief Indica si un commit agrega, modifica o quita un archivo respecto de su primer padre.
+ * 
+ * Primero consulta el filtro de rutas del commit; solo si responde que quizás, compara
+ * los árboles.
+ * 
+ * @param repo Repositorio.
+ * @param index Índice del commit a revisar.
+ * @param name Identificador del nombre del archivo.
+ * @param hash Hash del nombre.
+ * @return 1 si el commit cambia el archivo, 0 si no.
+ */
+static int commit_touches(ugit_repo *repo, uint32_t index, uint32_t name, uint32_t hash)
+{
+    const PathFilter *filter = (const PathFilter *)segment_at(&repo->path_filters, (size_t)index * sizeof(PathFilter));
+    if (!path_filter_maybe(filter, hash)) return 0;
+
+    const commitGit *commit = commit_at(repo, index);
+    uint32_t parent_root = commit->parents[0] == COMMIT_NONE ? TREE_EMPTY : commit_at(repo, commit->parents[0])->archivos;
+    if (parent_root == commit->archivos) return 0;
+    return tree_lookup(&repo->trees, commit->archivos, name, hash) != tree_lookup(&repo->trees, parent_root, name, hash);
+}
+
+/**
+ * @brief Muestra el historial de commits.
+ * 
+ * Recorre los commits alcanzables desde HEAD, incluyendo los de ramas unidas con
+ * merge, del más reciente al más antiguo (ver GraphWalk), y escribe cada uno apenas
+ * pasa los filtros. Solo se visitan los commits necesarios para llenar @c limit, así
+ * la primera página no depende del largo de la historia.
+ * 
+ * No toma el lock: recorre la historia publicada al momento de leer @c head_commit,
+ * que un commit concurrente no modifica.
+ * 
+ * @param repo Repositorio.
+ * @param options Filtros y paginación, o NULL para toda la historia.
+ * @return 0 en caso de éxito, -1 si ocurre un error.
+ */
+int log_commits(ugit_repo *repo, const LogOptions *options) 
+{
+    if (!check_repo_initialized(repo)) return -1;
+
+    LogOptions all;
+    if (options == NULL) 
+    {
+        log_options_init(&all);
+        options = &all;
+    }
+
+    regex_t pattern;
+    if (options->grep != NULL && !options->fixed_strings && regcomp(&pattern, options->grep, REG_EXTENDED | REG_NOSUB) != 0) 
+    {
+        output_error("Error: Expresión regular no válida: {pattern:s}\n", options->grep);
+        return -1;
+    }
+    int use_regex = options->grep != NULL && !options->fixed_strings;
+
+    uint32_t path_name = INTERN_NONE;
+    uint32_t path_hash = 0;
+    if (options->path != NULL) 
+    {
+        path_name = intern_find(&repo->names, options->path);
+        if (path_name != INTERN_NONE) path_hash = intern_hash(&repo->names, path_name);
+    }
+
+    output_text("==Historial de Commits==\n");
+    uint32_t head = RCU_READ(&repo->head_commit);
+    if (head == COMMIT_NONE) 
+    {
+        output_text("No hay commits.\n");
+    }
+
+    GraphWalk walk;
+    int result = graph_walk_begin(&walk, &repo->commits, options->path != NULL && path_name == INTERN_NONE ? COMMIT_NONE : head);
+    char hex[OBJECT_HEX_LENGTH + 1];
+    size_t skipped = 0;
+    size_t shown = 0;
+    uint32_t index;
+    while (result == 0 && shown < options->limit) 
+    {
+        int step = graph_walk_next(&walk, &index);
+        if (step <= 0) 
+        {
+            result = step;
+            break;
+        }
+
+        const commitGit *current_commit = commit_at(repo, index);
+        const char *mensaje = intern_string(&repo->names, current_commit->mensaje);
+        if (options->path != NULL && !commit_touches(repo, index, path_name, path_hash)) continue;
+        if (options->grep != NULL && (use_regex ? regexec(&pattern, mensaje, 0, NULL, 0) != 0 : strstr(mensaje, options->grep) == NULL)) continue;
+        if (skipped < options->skip) 
+        {
+            skipped++;
+            continue;
+        }
+
+        object_id_to_hex(&current_commit->id, hex);
+        output_event("log", "{id:a} {message:s}\n", hex, mensaje);
+        shown++;
+    }
+
+    graph_walk_end(&walk);
+    if (use_regex) regfree(&pattern);
+    return result;
+}
+
+/**
+ * @brief Cantidad de archivos agregados, modificados y quitados por un checkout.
+ * 
+ * Un checkout se hace en dos pasadas con los mismos cambios: la primera (@c dry_run)
+ * solo revisa que el árbol de trabajo no tenga cambios que se perderían, así un
+ * checkout que no puede hacerse no deja nada a medias.
+ */
+typedef struct CheckoutDelta 
+{
+    ugit_repo *repo; ///< Repositorio en el que se hace el checkout.
+    int dry_run; ///< 1 si solo se revisa el árbol de trabajo, sin cambiar nada.
+    size_t added; ///< Archivos agregados al área de preparación.
+    size_t modified; ///< Archivos cuyo contenido cambió.
+    size_t removed; ///< Archivos quitados del área de preparación.
+} CheckoutDelta;
+
+/**
+ * @brief Deja un archivo preparado con su contenido en el commit destino.
+ * 
+ * Escribe (o borra) primero el archivo del árbol de trabajo y después actualiza el
+ * área de preparación. En la pasada de revisión, en cambio, comprueba que el contenido
+ * preparado sea el del árbol base (si no, es un cambio preparado sin commit que solo
+ * vive en el área de preparación) y que el archivo en disco sea el preparado o ya sea
+ * el del destino: si no, el checkout perdería esos cambios. Si los datos de stat del
+ * archivo no cambiaron, es el preparado sin leerlo.
+ * 
+ * Antes de tocar el nodo registra el nombre con log_dirty, así un checkout que falla a
+ * mitad deja en @c dirty_names todo lo que ya difiere de @c staging_base.
+ * 
+ * @param name Identificador del nombre del archivo.
+ * @param blob Contenido en el commit destino, o BLOB_NONE si no está.
+ * @param data CheckoutDelta donde se cuentan los cambios.
+ * @return 0 en caso de éxito, 1 si el archivo tiene cambios sin preparar o sin commit,
+ *         -1 si ocurre un error.
+ */
+static int sync_staged(uint32_t name, uint32_t blob, void *data)
+{
+    CheckoutDelta *delta = (CheckoutDelta *)data;
+    ugit_repo *repo = delta->repo;
+    uint32_t hash = intern_hash(&repo->names, name);
+    FileNode **slot = index_find(repo, name, hash);
+    uint32_t current = slot ? (*slot)->blob : BLOB_NONE;
+    if (current == blob) return 0;
+
+    const char *filename = intern_string(&repo->names, name);
+    char path[PATH_MAX];
+    if (work_path(repo, filename, path) != 0) return -1;
+
+    if (delta->dry_run) 
+    {
+        if (current != tree_lookup(&repo->trees, repo->staging_base, name, hash)) 
+        {
+            output_error("Error: {path:s} tiene cambios preparados sin commit que se perderían; haz commit antes.\n", filename);
+            return 1;
+        }
+        struct stat info;
+        int clean = slot != NULL && stat(path, &info) == 0 && stat_cache_matches(&(*slot)->stat, &info);
+        if (clean == 0) clean = blob_file_matches(&repo->blobs, current, path);
+        if (clean == 0) clean = blob_file_matches(&repo->blobs, blob, path);
+        if (clean == 0) output_error("Error: {path:s} tiene cambios sin preparar que se perderían; haz add o commit antes.\n", filename);
+        return clean < 0 ? -1 : !clean;
+    }
+
+    if (log_dirty(repo, name) != 0) return -1;
+    if (blob == BLOB_NONE) 
+    {
+        if (remove(path) != 0 && errno != ENOENT) 
+        {
+            output_error("Error: No se pudo borrar {path:s}: {reason:s}\n", filename, strerror(errno));
+            return -1;
+        }
+        unstage_file(repo, slot);
+        delta->removed++;
+        return 0;
+    }
+
+    if (blob_write_file(&repo->blobs, blob, path) != 0) return -1;
+    FileNode *node = slot != NULL ? *slot : stage_file(repo, name, hash, blob);
+    if (node == NULL) return -1;
+    if (slot != NULL) 
+    {
+        node->blob = blob;
+        delta->modified++;
+    }
+    else 
+    {
+        delta->added++;
+    }
+
+    struct stat info;
+    if (stat(path, &info) == 0) stat_cache_record(&node->stat, &info);
+    else stat_cache_clear(&node->stat);
+    return 0;
+}
+
+/**
+ * @brief Aplica (o revisa) todos los cambios entre el área de preparación y un árbol.
+ * 
+ * En vez de vaciar y reconstruir el área de preparación, compara el árbol base con el
+ * destino (saltando los subárboles compartidos) y revisa los nombres modificados
+ * localmente, así el costo es proporcional a lo que cambia. Los nombres que la pasada
+ * real agrega a @c dirty_names ya quedaron sincronizados y no se vuelven a revisar.
+ * 
+ * @param repo Repositorio.
+ * @param root Raíz del árbol destino.
+ * @param delta Contador de cambios, con el modo de la pasada.
+ * @return 0 en caso de éxito, 1 si un archivo tiene cambios sin preparar, -1 si ocurre un error.
+ */
+static int sync_tree(ugit_repo *repo, uint32_t root, CheckoutDelta *delta)
+{
+    size_t dirty_count = repo->dirty_count;
+    int result = tree_diff(&repo->trees, repo->staging_base, root, sync_staged, delta);
+    for (size_t i = 0; result == 0 && i < dirty_count; i++) 
+    {
+        uint32_t hash = intern_hash(&repo->names, repo->dirty_names[i]);
+        result = sync_staged(repo->dirty_names[i], tree_lookup(&repo->trees, root, repo->dirty_names[i], hash), delta);
+    }
+    return result;
+}
+
+/**
+ * @brief Deja el área de preparación y el árbol de trabajo iguales a un commit y mueve HEAD a él.
+ * 
+ * Primero revisa que ningún archivo que cambia tenga modificaciones sin preparar o
+ * preparadas sin commit; si alguno las tiene, no cambia nada.
+ * 
+ * @param repo Repositorio.
+ * @param target Índice del commit destino, o COMMIT_NONE para un área vacía.
+ * @param delta Contador de archivos agregados, modificados y quitados.
+ * @return 0 en caso de éxito, -1 si ocurre un error o el checkout perdería cambios.
+ */
+static int move_head(ugit_repo *repo, uint32_t target, CheckoutDelta *delta)
+{
+    uint32_t root = target == COMMIT_NONE ? TREE_EMPTY : commit_at(repo, target)->archivos;
+    delta->dry_run = 1;
+    if (sync_tree(repo, root, delta) != 0) return -1;
+    delta->dry_run = 0;
+    if (sync_tree(repo, root, delta) != 0) return -1;
+
+    repo->staging_base = root;
+    repo->dirty_count = 0;
+    repo->modified = 1;
+    RCU_PUBLISH(&repo->head_commit, target);
+    return 0;
+}
+
+/**
+ * @brief Cambia a una rama o a una versión anterior (commit).
+ * 
+ * Si el nombre es el de una rama, HEAD queda en esa rama y los commits siguientes la
+ * hacen avanzar. Si no, se busca un commit por hash completo, abreviación única o, en
+ * su defecto, mensaje, y HEAD queda desacoplado en ese commit.
+ * 
+ * @param repo Repositorio.
+ * @param commit_id Rama, ID o mensaje del commit al que se quiere cambiar.
+ * @return 0 en caso de éxito, -1 si ocurre un error.
+ */
+static int checkout_locked(ugit_repo *repo, const char *commit_id)
+{
+    if (!check_repo_initialized(repo)) return -1;
+
+    uint32_t branch = branch_lookup(repo, commit_id);
+    uint32_t target = branch != BRANCH_NONE ? repo->version_list[branch].commit : find_commit(repo, commit_id);
+    if (branch == BRANCH_NONE && target == COMMIT_NONE) return -1;
+
+    CheckoutDelta delta = { repo, 0, 0, 0, 0 };
+    if (move_head(repo, target, &delta) != 0) return -1;
+    repo->current_branch = branch;
+
+    if (branch != BRANCH_NONE) 
+    {
+        output_event("checkout", "Cambiado a la rama: {branch:s} (+{added:z} ~{modified:z} -{removed:z})\n", commit_id, delta.added, delta.modified, delta.removed);
+    }
+    else 
+    {
+        output_event("checkout", "Restaurado al commit: {commit:s} (+{added:z} ~{modified:z} -{removed:z})\n", commit_id, delta.added, delta.modified, delta.removed);
+    }
+    return 0;
+}
+
+/**
+ * @brief Cambia a otro commit tomando el lock de escritura.
+ * 
+ * @param repo Repositorio.
+ * @param commit_id ID o mensaje del commit al que se quiere cambiar.
+ * @return 0 en caso de éxito, -1 si ocurre un error.
+ */
+int checkout_commit(ugit_repo *repo, const char *commit_id)
+{
+    lock_repo(repo);
+    return unlock_repo(repo, checkout_locked(repo, commit_id));
+}
+
+/**
+ * @brief Muestra las ramas, marcando la actual.
+ * 
+ * @param repo Repositorio.
+ * @return 0 en caso de éxito, -1 si ocurre un error.
+ */
+static int list_branches_locked(ugit_repo *repo)
+{
+    if (!check_repo_initialized(repo)) return -1;
+
+    char hex[OBJECT_HEX_LENGTH + 1];
+    if (repo->current_branch == BRANCH_NONE && repo->head_commit != COMMIT_NONE) 
+    {
+        object_id_to_hex(&commit_at(repo, repo->head_commit)->id, hex);
+        output_event("branch", "* (HEAD desacoplado en {id:a})\n", hex);
+    }
+
+    for (uint32_t i = 0; i < repo->version_count; i++) 
+    {
+        const versionGit *version = &repo->version_list[i];
+        const char *mark = i == repo->current_branch ? "*" : " ";
+        const char *name = intern_string(&repo->names, version->nombre);
+        if (version->commit == COMMIT_NONE) 
+        {
+            output_event("branch", "{current:s} {branch:s} (sin commits)\n", mark, name);
+            continue;
+        }
+        object_id_to_hex(&commit_at(repo, version->commit)->id, hex);
+        output_event("branch", "{current:s} {branch:s} {id:a}\n", mark, name, hex);
+    }
+    return 0;
+}
+
+/**
+ * @brief Muestra las ramas tomando el lock de escritura.
+ * 
+ * @param repo Repositorio.
+ * @return 0 en caso de éxito, -1 si ocurre un error.
+ */
+int list_branches(ugit_repo *repo)
+{
+    lock_repo(repo);
+    return unlock_repo(repo, list_branches_locked(repo));
+}
+
+/**
+ * @brief Crea una rama que apunta a HEAD, sin cambiarse a ella.
+ * 
+ * @param repo Repositorio.
+ * @param branch Nombre de la rama nueva.
+ * @return 0 en caso de éxito, -1 si ocurre un error.
+ */
+static int create_branch_locked(ugit_repo *repo, const char *branch)
+{
+    if (!check_repo_initialized(repo)) return -1;
+
+    if (repo->head_commit == COMMIT_NONE) 
+    {
+        output_error("Error: No hay commits para crear la rama {branch:s}.\n", branch);
+        return -1;
+    }
+    if (branch_lookup(repo, branch) != BRANCH_NONE) 
+    {
+        output_error("Error: La rama {branch:s} ya existe.\n", branch);
+        return -1;
+    }
+
+    uint32_t name;
+    if (intern_add(&repo->names, branch, &name) != 0 || branch_add(repo, name, repo->head_commit) != 0) return -1;
+
+    output_event("branch", "Rama {branch:s} creada.\n", branch);
+    return 0;
+}
+
+/**
+ * @brief Crea una rama tomando el lock de escritura.
+ * 
+ * @param repo Repositorio.
+ * @param branch Nombre de la rama nueva.
+ * @return 0 en caso de éxito, -1 si ocurre un error.
+ */
+int create_branch(ugit_repo *repo, const char *branch)
+{
+    lock_repo(repo);
+    return unlock_repo(repo, create_branch_locked(repo, branch));
+}
+
+/**
+ * @brief Estado de un merge de tres vías.
+ */
+typedef struct MergeState 
+{
+    CheckoutDelta delta; ///< Cambios aplicados y modo de la pasada.
+    uint32_t base_root; ///< Árbol del ancestro común.
+    size_t conflicts; ///< Archivos que cambiaron de forma distinta en ambas ramas.
+} MergeState;
+
+/**
+ * @brief Aplica al área de preparación un cambio de la otra rama.
+ * 
+ * Recibe cada nombre que cambió entre el ancestro común y la otra rama. Si la rama
+ * actual no lo tocó (está igual que en el ancestro), se toma el contenido de la otra;
+ * si lo cambió igual, no hay nada que hacer, y si lo cambió distinto es un conflicto.
+ * Los conflictos se cuentan en la pasada de revisión, antes de cambiar nada.
+ * 
+ * @param name Identificador del nombre del archivo.
+ * @param blob Contenido en la otra rama, o BLOB_NONE si allí no está.
+ * @param data MergeState con el ancestro común y los cambios.
+ * @return 0 en caso de éxito, 1 si el archivo tiene cambios sin preparar, -1 si ocurre un error.
+ */
+static int merge_change(uint32_t name, uint32_t blob, void *data)
+{
+    MergeState *state = (MergeState *)data;
+    ugit_repo *repo = state->delta.repo;
+    uint32_t hash = intern_hash(&repo->names, name);
+    FileNode **slot = index_find(repo, name, hash);
+    uint32_t ours = slot ? (*slot)->blob : BLOB_NONE;
+    if (ours == blob) return 0;
+
+    if (ours != tree_lookup(&repo->trees, state->base_root, name, hash)) 
+    {
+        output_error("Conflicto: {path:s} cambió de forma distinta en ambas ramas.\n", intern_string(&repo->names, name));
+        state->conflicts++;
+        return 0;
+    }
+    return sync_staged(name, blob, &state->delta);
+}
+
+/**
+ * @brief Une otra rama con HEAD.
+ * 
+ * Si la otra rama ya está contenida en HEAD no hace nada, y si HEAD está contenido en
+ * ella avanza HEAD sin crear commit. En otro caso aplica los cambios de la otra rama
+ * desde el ancestro común y crea un commit con dos padres. Requiere que no haya
+ * cambios sin commit en el área de preparación. Si algún archivo cambió de forma
+ * distinta en ambas ramas, informa los conflictos sin cambiar nada.
+ * 
+ * @param repo Repositorio.
+ * @param branch Nombre de la rama a unir.
+ * @return 0 en caso de éxito, -1 si ocurre un error.
+ */
+static int merge_locked(ugit_repo *repo, const char *branch)
+{
+    if (!check_repo_initialized(repo)) return -1;
+
+    uint32_t position = branch_lookup(repo, branch);
+    if (position == BRANCH_NONE) 
+    {
+        output_error("Error: Rama no encontrada: {branch:s}\n", branch);
+        return -1;
+    }
+    if (repo->dirty_count != 0) 
+    {
+        output_error("Error: Hay cambios sin commit; haz commit antes de unir ramas.\n");
+        return -1;
+    }
+
+    uint32_t theirs = repo->version_list[position].commit;
+    int contained;
+    if (graph_is_ancestor(&repo->graph, theirs, repo->head_commit, &contained) != 0) return -1;
+    if (theirs == COMMIT_NONE || contained) 
+    {
+        output_event("merge", "Ya está actualizado con {branch:s}.\n", branch);
+        return 0;
+    }
+
+    int fast_forward;
+    if (graph_is_ancestor(&repo->graph, repo->head_commit, theirs, &fast_forward) != 0) return -1;
+    CheckoutDelta delta = { repo, 0, 0, 0, 0 };
+    if (repo->head_commit == COMMIT_NONE || fast_forward) 
+    {
+        if (move_head(repo, theirs, &delta) != 0) return -1;
+        if (repo->current_branch != BRANCH_NONE) repo->version_list[repo->current_branch].commit = theirs;
+
+        char hex[OBJECT_HEX_LENGTH + 1];
+        object_id_to_hex(&commit_at(repo, theirs)->id, hex);
+        output_event("merge", "Avance rápido a [{id:a}] (+{added:z} ~{modified:z} -{removed:z})\n", hex, delta.added, delta.modified, delta.removed);
+        return 0;
+    }
 
-/// Puntero al inicio de la lista de versiones (no usado actualmente).
-static versionGit *version_list = NULL; 
+    uint32_t base;
+    if (graph_merge_base(&repo->graph, repo->head_commit, theirs, &base) != 0) return -1;
+    MergeState state = { { repo, 1, 0, 0, 0 }, base == COMMIT_NONE ? TREE_EMPTY : commit_at(repo, base)->archivos, 0 };
+    uint32_t their_root = commit_at(repo, theirs)->archivos;
+    if (tree_diff(&repo->trees, state.base_root, their_root, merge_change, &state) != 0) return -1;
+    if (state.conflicts > 0) 
+    {
+        output_error("Error: No se unió {branch:s}: hay {count:z} archivos en conflicto.\n", branch, state.conflicts);
+        return -1;
+    }
+    state.delta.dry_run = 0;
+    if (tree_diff(&repo->trees, state.base_root, their_root, merge_change, &state) != 0) return -1;
 
-/// Indicador de si el repositorio ha sido inicializado.
-static int is_repo_initialized = 0; 
+    char mensaje[MAX_COMMAND_LENGTH + 16];
+    snprintf(mensaje, sizeof(mensaje), "Merge %s", branch);
+    return create_commit(repo, mensaje, theirs);
+}
 
 /**
- * @brief Inicializa el repositorio.
+ * @brief Une otra rama con HEAD tomando el lock de escritura.
+ * 
+ * @param repo Repositorio.
+ * @param branch Nombre de la rama a unir.
+ * @return 0 en caso de éxito, -1 si ocurre un error.
+ */
+int merge_branch(ugit_repo *repo, const char *branch)
+{
+    lock_repo(repo);
+    return unlock_repo(repo, merge_locked(repo, branch));
+}
+
+/**
+ * @brief Lista los archivos en el área de preparación.
  * 
- * Si el repositorio ya ha sido inicializado, no se realiza ninguna acción.
+ * Muestra todos los archivos actualmente añadidos para commit. No toma el lock; si hay
+ * un escritor en paralelo, cada archivo listado estaba en preparación en algún momento
+ * del recorrido.
  * 
- * @return 0 en caso de éxito, 1 si ya estaba inicializado.
+ * @param repo Repositorio.
+ * @return 0 en caso de éxito, -1 si ocurre un error.
  */
-int init_repo() 
-{ 
-    if (is_repo_initialized) 
+int list_files(ugit_repo *repo)
+{
+    if (!check_repo_initialized(repo)) return -1;
+
+    __atomic_add_fetch(&repo->list_readers, 1, __ATOMIC_SEQ_CST);
+    FileNode *current = RCU_READ(&repo->file_list);
+    if (!current) 
     {
-        printf("El repositorio ya está inicializado.\n");
-        return 0;
+        output_text("No hay archivos en el área de preparación.\n");
+    }
+    else 
+    {
+        output_text("Archivos en el área de preparación:\n");
     }
+    while (current) 
+    {
+        output_event("file", "{path:s}\n", intern_string(&repo->names, current->name));
+        current = RCU_READ(&current->next);
+    }
+    __atomic_sub_fetch(&repo->list_readers, 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/**
+ * @brief Archivo que aparece en una sección de status.
+ */
+typedef struct StatusEntry 
+{
+    const char *name; ///< Nombre del archivo (en el pool de cadenas o en una PathList).
+    const char *state; ///< "nuevo", "modificado" o "eliminado", o NULL en archivos sin seguimiento.
+} StatusEntry;
+
+/**
+ * @brief Lista de archivos de una sección de status.
+ */
+typedef struct StatusList 
+{
+    StatusEntry *items; ///< Archivos de la sección.
+    size_t count; ///< Archivos en la lista.
+    size_t capacity; ///< Capacidad de @c items.
+} StatusList;
 
-    is_repo_initialized = 1;
+/**
+ * @brief Agrega un archivo a una sección de status.
+ * 
+ * @param list Sección.
+ * @param name Nombre del archivo (debe seguir válido mientras se usa la lista).
+ * @param state Estado del archivo.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+static int status_push(StatusList *list, const char *name, const char *state)
+{
+    if (list->count == list->capacity) 
+    {
+        size_t capacity = list->capacity ? list->capacity * 2 : 16;
+        StatusEntry *items = (StatusEntry *)realloc(list->items, capacity * sizeof(StatusEntry));
+        if (!items) 
+        {
+            perror("Error al asignar memoria para el estado");
+            return -1;
+        }
+        list->items = items;
+        list->capacity = capacity;
+    }
+    list->items[list->count].name = name;
+    list->items[list->count].state = state;
+    list->count++;
     return 0;
 }
 
 /**
- * @brief Verifica si el repositorio ha sido inicializado.
+ * @brief Compara dos archivos de status por nombre para ordenarlos con qsort().
  * 
- * Si no está inicializado, muestra un mensaje de error.
+ * @param a Primer archivo.
+ * @param b Segundo archivo.
+ * @return Resultado de strcmp() entre sus nombres.
+ */
+static int compare_status(const void *a, const void *b)
+{
+    return strcmp(((const StatusEntry *)a)->name, ((const StatusEntry *)b)->name);
+}
+
+/**
+ * @brief Muestra una sección de status ordenada por nombre, si no está vacía.
  * 
- * @return 1 si está inicializado, 0 en caso contrario.
+ * @param title Título de la sección.
+ * @param event Nombre del evento de cada archivo.
+ * @param list Archivos de la sección.
  */
-int check_repo_initialized() 
-{ 
-    if (!is_repo_initialized) 
+static void print_status(const char *title, const char *event, StatusList *list)
+{
+    if (list->count == 0) return;
+
+    qsort(list->items, list->count, sizeof(StatusEntry), compare_status);
+    output_text(title);
+    for (size_t i = 0; i < list->count; i++) 
     {
-        printf("Error: El repositorio no ha sido inicializado. Ejecuta 'init' primero.\n");
-        return 0;
+        if (list->items[i].state) output_event(event, "    {state:s}: {path:s}\n", list->items[i].state, list->items[i].name);
+        else output_event(event, "    {path:s}\n", list->items[i].name);
     }
-    return 1;
 }
 
 /**
- * @brief Agrega un archivo al área de preparación.
+ * @brief Revisión de archivos preparados contra el árbol de trabajo.
  * 
- * Si el archivo ya existe, lo reemplaza.
+ * Los archivos cuyos datos de stat cambiaron se juntan en @c pending y se leen al
+ * final todos juntos, en paralelo.
+ */
+typedef struct StatusCheck 
+{
+    ugit_repo *repo; ///< Repositorio.
+    StatusList *unstaged; ///< Sección de cambios sin preparar.
+    PathList pending; ///< Rutas de los archivos a leer.
+    FileNode **nodes; ///< Nodo de cada archivo de @c pending.
+    size_t node_capacity; ///< Capacidad de @c nodes.
+} StatusCheck;
+
+/**
+ * @brief Compara el contenido leído de un archivo con el preparado.
  * 
- * @param filename Nombre del archivo a agregar.
+ * Si es el mismo, solo cambiaron sus datos de stat (por ejemplo, con touch) y se
+ * actualizan, así la próxima vez basta el stat.
+ * 
+ * @param result Resultado del lector.
+ * @param data Estado de la revisión (StatusCheck).
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+static int status_check_result(const HashResult *result, void *data)
+{
+    StatusCheck *check = (StatusCheck *)data;
+    FileNode *node = check->nodes[result->index];
+    const char *filename = intern_string(&check->repo->names, node->name);
+    if (result->error != 0) return status_push(check->unstaged, filename, result->error == ENOENT ? "eliminado" : "modificado");
+
+    const BlobRecord *record = blob_record(&check->repo->blobs, node->blob);
+    if (memcmp(result->id.hash, record->id.hash, SHA1_DIGEST_SIZE) != 0) return status_push(check->unstaged, filename, "modificado");
+
+    FileStat previous = node->stat;
+    stat_cache_record(&node->stat, &result->info);
+    if (memcmp(&previous, &node->stat, sizeof(previous)) != 0) check->repo->modified = 1;
+    return 0;
+}
+
+/**
+ * @brief Revisa un archivo preparado con un stat y, si sus datos cambiaron, lo deja para leerlo.
+ * 
+ * @param check Revisión en curso.
+ * @param node Archivo preparado.
  * @return 0 en caso de éxito, -1 si ocurre un error.
  */
-int add_file(const char *filename)  
+static int status_check_node(StatusCheck *check, FileNode *node)
 {
-    if (!check_repo_initialized()) return -1;
+    const char *filename = intern_string(&check->repo->names, node->name);
+    char path[PATH_MAX];
+    struct stat info;
+    if (work_path(check->repo, filename, path) != 0) return -1;
+    if (stat(path, &info) != 0) return status_push(check->unstaged, filename, "eliminado");
+    if (!S_ISREG(info.st_mode)) return status_push(check->unstaged, filename, "modificado");
+    if (stat_cache_matches(&node->stat, &info)) return 0;
 
-    FileNode *current = file_list;
-    while (current != NULL) 
-    {    
-        if (strcmp(current->filename, filename) == 0) 
-        { 
-            printf("El archivo %s ya existe. Reemplazando el archivo.\n", filename);
-            strncpy(current->filename, filename, MAX_ARG_LENGTH);
-            current->filename[MAX_ARG_LENGTH - 1] = '\0';
-            return 0;
+    if (check->pending.count == check->node_capacity) 
+    {
+        size_t capacity = check->node_capacity ? check->node_capacity * 2 : 64;
+        FileNode **nodes = (FileNode **)realloc(check->nodes, capacity * sizeof(FileNode *));
+        if (!nodes) 
+        {
+            perror("Error al asignar memoria para el estado");
+            return -1;
         }
-        current = current->next;
+        check->nodes = nodes;
+        check->node_capacity = capacity;
     }
+    check->nodes[check->pending.count] = node;
+    return path_list_push(&check->pending, path);
+}
+
+/**
+ * @brief Lee en paralelo los archivos pendientes de una revisión y libera su estado.
+ * 
+ * @param check Revisión en curso.
+ * @param result Resultado de los pasos anteriores; si no es 0 solo se libera.
+ * @return 0 en caso de éxito, -1 si ocurre un error.
+ */
+static int status_check_finish(StatusCheck *check, int result)
+{
+    if (result == 0) result = hashpool_run(check->pending.items, check->pending.count, NULL, status_check_result, check);
+    free(check->nodes);
+    path_list_free(&check->pending);
+    return result == 0 ? 0 : -1;
+}
+
+/**
+ * @brief Cambios del árbol de trabajo respecto del área de preparación.
+ */
+typedef struct WorktreeStatus 
+{
+    StatusList unstaged; ///< Archivos preparados que cambiaron o se borraron.
+    StatusList untracked; ///< Archivos sin seguimiento.
+    PathList names; ///< Rutas donde viven los nombres de @c untracked (o los entregados por el monitor).
+    PathList dirs; ///< Directorios que el monitor vio desaparecer.
+} WorktreeStatus;
 
-    FileNode *new_node = (FileNode *)malloc(sizeof(FileNode));  
-    if (!new_node) 
+/**
+ * @brief Guarda un nombre entregado por el monitor.
+ * 
+ * @param name Ruta relativa al árbol de trabajo.
+ * @param is_dir 1 si es un directorio que desapareció.
+ * @param data Estado del árbol de trabajo (WorktreeStatus).
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+static int collect_watched(const char *name, int is_dir, void *data)
+{
+    WorktreeStatus *status = (WorktreeStatus *)data;
+    return path_list_push(is_dir ? &status->dirs : &status->names, name);
+}
+
+/**
+ * @brief Indica si un nombre está dentro de alguno de los directorios de una lista.
+ * 
+ * @param dirs Directorios relativos al árbol de trabajo.
+ * @param name Ruta relativa al árbol de trabajo.
+ * @return 1 si está dentro de alguno, 0 si no.
+ */
+static int under_dirs(const PathList *dirs, const char *name)
+{
+    for (size_t i = 0; i < dirs->count; i++) 
     {
-        perror("Error al asignar memoria");
-        return -1;
+        size_t len = strlen(dirs->items[i]);
+        if (strncmp(name, dirs->items[i], len) == 0 && name[len] == '/') return 1;
     }
-    
-    strncpy(new_node->filename, filename, MAX_ARG_LENGTH);
-    new_node->filename[MAX_ARG_LENGTH - 1] = '\0'; 
-    new_node->next = file_list;
-    file_list = new_node;
-
-    printf("Archivo %s agregado al área de preparación.\n", filename);
     return 0;
 }
 
 /**
- * @brief Elimina un archivo del área de preparación.
+ * @brief Revisa todo el árbol de trabajo: un stat por archivo preparado y un recorrido de directorios.
  * 
- * @param filename Nombre del archivo a eliminar.
+ * @param repo Repositorio.
+ * @param status Donde juntar los cambios.
  * @return 0 en caso de éxito, -1 si ocurre un error.
  */
-int remove_file(const char *filename) 
-{ 
-    if (!check_repo_initialized()) return -1;
-
-    FileNode *current = file_list;
-    FileNode *previous = NULL;
-
-    while (current != NULL && strcmp(current->filename, filename) != 0) 
-    { 
-        previous = current;
-        current = current->next;
+static int scan_full(ugit_repo *repo, WorktreeStatus *status)
+{
+    StatusCheck check = { repo, &status->unstaged, { NULL, 0, 0 }, NULL, 0 };
+    int result = 0;
+    for (FileNode *node = repo->file_list; node != NULL && result == 0; node = node->next) 
+    {
+        result = status_check_node(&check, node);
     }
+    if (status_check_finish(&check, result) != 0 || collect_dir(repo, "", &status->names) != 0) return -1;
 
-    if (current == NULL) 
-    { 
-        printf("Archivo no encontrado: %s\n", filename);
-        return -1;
+    for (size_t i = 0; i < status->names.count; i++) 
+    {
+        const char *filename = status->names.items[i] + repo->worktree_len;
+        uint32_t name = intern_find(&repo->names, filename);
+        if (name != INTERN_NONE && index_find(repo, name, intern_hash(&repo->names, name)) != NULL) continue;
+        if (status_push(&status->untracked, filename, NULL) != 0) return -1;
     }
+    return 0;
+}
 
-    if (previous == NULL) 
-    {
-        file_list = current->next;
-    } 
-    else 
+/**
+ * @brief Revisa solo los nombres que el monitor vio cambiar.
+ * 
+ * Un directorio que desapareció obliga a buscar los archivos preparados que tenía,
+ * recorriendo el área de preparación; el resto cuesta un stat por nombre cambiado.
+ * 
+ * @param repo Repositorio.
+ * @param status Nombres entregados por el monitor, donde juntar los cambios.
+ * @return 0 en caso de éxito, -1 si ocurre un error.
+ */
+static int scan_watched(ugit_repo *repo, WorktreeStatus *status)
+{
+    StatusCheck check = { repo, &status->unstaged, { NULL, 0, 0 }, NULL, 0 };
+    int result = 0;
+    for (FileNode *node = status->dirs.count > 0 ? repo->file_list : NULL; node != NULL && result == 0; node = node->next) 
     {
-        previous->next = current->next;
+        if (under_dirs(&status->dirs, intern_string(&repo->names, node->name))) result = status_check_node(&check, node);
     }
 
-    free(current);
-    printf("Archivo %s eliminado.\n", filename);
-    return 0;
+    char path[PATH_MAX];
+    for (size_t i = 0; i < status->names.count && result == 0; i++) 
+    {
+        const char *filename = status->names.items[i];
+        uint32_t name = intern_find(&repo->names, filename);
+        FileNode **slot = name == INTERN_NONE ? NULL : index_find(repo, name, intern_hash(&repo->names, name));
+        struct stat info;
+        if (slot != NULL) 
+        {
+            if (!under_dirs(&status->dirs, filename)) result = status_check_node(&check, *slot);
+        }
+        else if (work_path(repo, filename, path) != 0) 
+        {
+            result = -1;
+        }
+        else if (lstat(path, &info) == 0 && S_ISREG(info.st_mode)) 
+        {
+            result = status_push(&status->untracked, filename, NULL);
+        }
+    }
+    return status_check_finish(&check, result);
 }
 
 /**
- * @brief Crea un commit con los archivos en el área de preparación.
+ * @brief Junta los cambios del árbol de trabajo, con el monitor si está activo.
  * 
- * Copia los archivos actuales en el área de preparación y los guarda en un nuevo commit.
+ * Con el monitor solo se revisan los nombres que cambiaron desde la consulta anterior,
+ * y los que siguen con cambios se vuelven a marcar para la siguiente. Sin monitor, o
+ * si este perdió eventos, se revisa todo el árbol.
  * 
- * @param mensaje Mensaje descriptivo del commit.
+ * @param repo Repositorio.
+ * @param status Donde juntar los cambios (vacío).
  * @return 0 en caso de éxito, -1 si ocurre un error.
  */
-int commit(const char *mensaje)
-{ 
-    if (!check_repo_initialized()) return -1;
+static int scan_worktree(ugit_repo *repo, WorktreeStatus *status)
+{
+    int result = repo->watcher ? watcher_collect(repo->watcher, collect_watched, status) : 1;
+    if (result == 0) result = scan_watched(repo, status);
+    else if (result > 0) result = scan_full(repo, status);
+    if (repo->watcher == NULL) return result;
 
-    commitGit *new_commit = (commitGit *)malloc(sizeof(commitGit));
-    if (!new_commit) 
+    if (result != 0) 
     {
-        perror("Error al asignar memoria para el commit");
-        return -1;
+        watcher_invalidate(repo->watcher);
+        return result;
     }
+    for (size_t i = 0; i < status->unstaged.count; i++) watcher_mark(repo->watcher, status->unstaged.items[i].name);
+    for (size_t i = 0; i < status->untracked.count; i++) watcher_mark(repo->watcher, status->untracked.items[i].name);
+    return 0;
+}
+
+/**
+ * @brief Libera los cambios juntados por scan_worktree().
+ * 
+ * @param status Cambios del árbol de trabajo.
+ */
+static void worktree_status_free(WorktreeStatus *status)
+{
+    free(status->unstaged.items);
+    free(status->untracked.items);
+    path_list_free(&status->names);
+    path_list_free(&status->dirs);
+}
 
-    FileNode *current_file = file_list;
-    int index = 0;
+/**
+ * @brief Junta los cambios preparados: nombres que cambiaron desde @c staging_base.
+ * 
+ * @param repo Repositorio.
+ * @param staged Sección donde agregarlos.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+static int status_staged(ugit_repo *repo, StatusList *staged)
+{
+    StatusList names = { NULL, 0, 0 };
+    for (size_t i = 0; i < repo->dirty_count; i++) 
+    {
+        if (status_push(&names, intern_string(&repo->names, repo->dirty_names[i]), NULL) != 0) 
+        {
+            free(names.items);
+            return -1;
+        }
+    }
+    if (names.count > 0) qsort(names.items, names.count, sizeof(StatusEntry), compare_status);
 
-    while (current_file != NULL && index < MAX_FILES) 
+    int result = 0;
+    for (size_t i = 0; i < names.count && result == 0; i++) 
     {
-        strncpy(new_commit->archivos[index].filename, current_file->filename, MAX_ARG_LENGTH);
-        new_commit->archivos[index].filename[MAX_ARG_LENGTH - 1] = '\0';
-        current_file = current_file->next;
-        index++;
+        if (i > 0 && names.items[i].name == names.items[i - 1].name) continue;
+
+        uint32_t name = intern_find(&repo->names, names.items[i].name);
+        uint32_t hash = intern_hash(&repo->names, name);
+        FileNode **slot = index_find(repo, name, hash);
+        uint32_t base = tree_lookup(&repo->trees, repo->staging_base, name, hash);
+        uint32_t current = slot ? (*slot)->blob : BLOB_NONE;
+        if (base == current) continue;
+
+        const char *state = base == BLOB_NONE ? "nuevo" : current == BLOB_NONE ? "eliminado" : "modificado";
+        result = status_push(staged, names.items[i].name, state);
     }
+    free(names.items);
+    return result;
+}
+
+/**
+ * @brief Muestra los cambios preparados, los cambios sin preparar y los archivos sin seguimiento.
+ * 
+ * @param repo Repositorio.
+ * @return 0 en caso de éxito, -1 si ocurre un error.
+ */
+static int status_locked(ugit_repo *repo)
+{
+    if (!check_repo_initialized(repo)) return -1;
 
-    strncpy(new_commit->mensaje, mensaje, MAX_ARG_LENGTH);
-    new_commit->mensaje[MAX_ARG_LENGTH - 1] = '\0';
+    StatusList staged = { NULL, 0, 0 };
+    WorktreeStatus worktree;
+    memset(&worktree, 0, sizeof(worktree));
+    int result = status_staged(repo, &staged);
+    if (result == 0) result = scan_worktree(repo, &worktree);
 
-    new_commit->next = commit_list;
-    commit_list = new_commit;
+    if (result == 0) 
+    {
+        print_status("Cambios para el commit:\n", "staged", &staged);
+        print_status("Cambios sin preparar:\n", "unstaged", &worktree.unstaged);
+        print_status("Archivos sin seguimiento:\n", "untracked", &worktree.untracked);
+        if (staged.count == 0 && worktree.unstaged.count == 0 && worktree.untracked.count == 0) 
+        {
+            output_event("status", "No hay cambios; el árbol de trabajo está limpio.\n");
+        }
+    }
 
-    printf("Commit creado con éxito: %s\n", mensaje);
-    return 0;
+    free(staged.items);
+    worktree_status_free(&worktree);
+    return result;
 }
 
 /**
- * @brief Muestra el historial de commits.
+ * @brief Muestra el estado del repositorio tomando el lock de escritura.
  * 
- * Lista todos los commits realizados hasta el momento.
+ * Toma el lock de escritura porque actualiza los datos de stat de los archivos que
+ * solo cambiaron de fecha.
  * 
+ * @param repo Repositorio.
  * @return 0 en caso de éxito, -1 si ocurre un error.
  */
-int log_commits() 
+int show_status(ugit_repo *repo)
 {
-    if (!check_repo_initialized()) return -1;
+    lock_repo(repo);
+    return unlock_repo(repo, status_locked(repo));
+}
 
-    printf("==Historial de Commits==\n");
-    commitGit *current_commit = commit_list;
+/**
+ * @brief Deja el área de preparación igual al árbol de trabajo.
+ * 
+ * Agrega los archivos sin seguimiento y los modificados (con add_batch()) y quita de
+ * preparación los que ya no existen.
+ * 
+ * @param repo Repositorio.
+ * @return 0 en caso de éxito, -1 si ocurre un error.
+ */
+static int add_all_locked(ugit_repo *repo)
+{
+    if (!check_repo_initialized(repo)) return -1;
 
-    if (!current_commit) 
+    WorktreeStatus worktree;
+    memset(&worktree, 0, sizeof(worktree));
+    PathList list = { NULL, 0, 0 };
+    char path[PATH_MAX];
+    struct stat info;
+    int result = scan_worktree(repo, &worktree);
+    for (size_t i = 0; i < worktree.untracked.count && result == 0; i++) 
     {
-        printf("No hay commits.\n");
-        return 0;
+        if (work_path(repo, worktree.untracked.items[i].name, path) != 0 || path_list_push(&list, path) != 0) result = -1;
     }
-    
-    while(current_commit)
+    for (size_t i = 0; i < worktree.unstaged.count && result == 0; i++) 
     {
-        printf("%s\n",current_commit->mensaje);
-        current_commit = current_commit->next;
+        if (work_path(repo, worktree.unstaged.items[i].name, path) != 0) result = -1;
+        else if (stat(path, &info) == 0 && S_ISREG(info.st_mode)) result = path_list_push(&list, path);
     }
-    
-    return 0;
+
+    size_t outcomes[3] = { 0, 0, 0 };
+    size_t removed = 0;
+    if (result == 0) result = add_batch(repo, &list, outcomes);
+    for (size_t i = 0; i < worktree.unstaged.count && result == 0; i++) 
+    {
+        const char *filename = worktree.unstaged.items[i].name;
+        if (work_path(repo, filename, path) != 0) result = -1;
+        if (result != 0 || (stat(path, &info) == 0 && S_ISREG(info.st_mode))) continue;
+
+        uint32_t name = intern_find(&repo->names, filename);
+        FileNode **slot = index_find(repo, name, intern_hash(&repo->names, name));
+        if (slot == NULL) continue;
+        if (log_dirty(repo, name) != 0) result = -1;
+        else unstage_file(repo, slot);
+        removed++;
+    }
+    if (result == 0) 
+    {
+        output_event("add", "{added:z} archivos agregados, {modified:z} reemplazados y {removed:z} eliminados.\n", outcomes[STAGE_ADDED], outcomes[STAGE_REPLACED], removed);
+    }
+
+    path_list_free(&list);
+    worktree_status_free(&worktree);
+    return result;
 }
 
 /**
- * @brief Cambia a una versión anterior (commit) basada en su ID.
- * 
- * Limpia el área de preparación y restaura los archivos del commit seleccionado.
+ * @brief Deja el área de preparación igual al árbol de trabajo tomando el lock de escritura.
  * 
- * @param commit_id ID o mensaje del commit al que se quiere cambiar.
+ * @param repo Repositorio.
  * @return 0 en caso de éxito, -1 si ocurre un error.
  */
-int checkout_commit(const char *commit_id)
+int add_all(ugit_repo *repo)
 {
-    if (!check_repo_initialized()) return -1;
+    lock_repo(repo);
+    return unlock_repo(repo, add_all_locked(repo));
+}
 
-    commitGit *current_commit = commit_list;
-    while (current_commit != NULL && strcmp(current_commit->mensaje, commit_id) != 0) 
+/**
+ * @brief Activa el monitor del árbol de trabajo.
+ * 
+ * @param repo Repositorio.
+ * @return 0 en caso de éxito, -1 si ocurre un error.
+ */
+static int watch_locked(ugit_repo *repo)
+{
+    if (!check_repo_initialized(repo)) return -1;
+    if (repo->watcher != NULL) 
     {
-        current_commit = current_commit->next;
+        output_event("watch", "El monitor de archivos ya está activo.\n");
+        return 0;
     }
 
-    if (current_commit == NULL) 
+    char root[PATH_MAX];
+    snprintf(root, sizeof(root), "%.*s", (int)repo->worktree_len, repo->dir ? repo->dir : "");
+    repo->watcher = watcher_start(root, repo->dir ? repo->dir + repo->worktree_len : NULL);
+    if (repo->watcher == NULL) return -1;
+    output_event("watch", "Monitor de archivos activado.\n");
+    return 0;
+}
+
+/**
+ * @brief Activa el monitor del árbol de trabajo tomando el lock de escritura.
+ * 
+ * @param repo Repositorio.
+ * @return 0 en caso de éxito, -1 si ocurre un error.
+ */
+int start_watch(ugit_repo *repo)
+{
+    lock_repo(repo);
+    return unlock_repo(repo, watch_locked(repo));
+}
+
+/**
+ * @brief Detiene el monitor del árbol de trabajo tomando el lock de escritura.
+ * 
+ * @param repo Repositorio.
+ * @return 0 en caso de éxito, -1 si el monitor no estaba activo.
+ */
+int stop_watch(ugit_repo *repo)
+{
+    lock_repo(repo);
+    int result = 0;
+    if (repo->watcher == NULL) 
     {
-        printf("Error: Commit con ID '%s' no encontrado.\n", commit_id);
-        return -1;
+        output_error("Error: El monitor de archivos no está activo.\n");
+        result = -1;
     }
-
-    FileNode *current_file = file_list;
-    while (current_file != NULL) 
+    else 
     {
-        FileNode *temp = current_file;
-        current_file = current_file->next;
-        free(temp);
+        watcher_stop(repo->watcher);
+        repo->watcher = NULL;
+        output_event("watch", "Monitor de archivos detenido.\n");
     }
-    file_list = NULL;
+    return unlock_repo(repo, result);
+}
 
-    for (int i = 0; i < MAX_FILES; i++) 
+/**
+ * @brief Reemplaza los registros de blobs por los de los blobs ya empaquetados.
+ * 
+ * Los registros nuevos se arman en un segmento aparte y solo reemplazan a los
+ * actuales si se pudieron agregar todos; si falta memoria la tabla de blobs queda
+ * intacta. Los bytes quedan solo en el pack, así que se vacían el segmento de datos y
+ * la tabla hash; el pack anterior se cierra y el nuevo pasa a ser el del repositorio.
+ * 
+ * @param repo Repositorio.
+ * @param records Copia de los registros de todos los blobs.
+ * @param positions Posición de cada blob en el índice del pack nuevo.
+ * @param count Cantidad de blobs.
+ * @param pack Pack nuevo, ya abierto (queda abierto si ocurre un error).
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+static int adopt_pack(ugit_repo *repo, const BlobRecord *records, const uint32_t *positions, uint32_t count, PackFile *pack)
+{
+    Segment packed;
+    segment_init(&packed, repo->blob_records.arena, repo->blob_records.chunk_size);
+    for (uint32_t i = 0; i < count; i++) 
     {
-        if (strlen(current_commit->archivos[i].filename) > 0) 
+        BlobRecord record = records[i];
+        record.flags |= BLOB_PACKED;
+        record.offset = positions[i];
+        if (segment_append(&packed, &record, sizeof(BlobRecord), NULL) != 0) 
         {
-            FileNode *new_file = (FileNode *)malloc(sizeof(FileNode));
-            strncpy(new_file->filename, current_commit->archivos[i].filename, MAX_ARG_LENGTH);
-            new_file->filename[MAX_ARG_LENGTH - 1] = '\0';
-            new_file->next = file_list;
-            file_list = new_file;
+            segment_release(&packed);
+            return -1;
         }
     }
 
-    printf("Restaurado al commit: %s\n", commit_id);
+    segment_release(&repo->blob_records);
+    repo->blob_records = packed;
+    segment_release(&repo->blob_data);
+    objtable_free(&repo->blobs.index);
+    pack_close(&repo->blobs.pack);
+    repo->blobs.pack = *pack;
     return 0;
 }
 
 /**
- * @brief Lista los archivos en el área de preparación.
+ * @brief Mueve los bytes de todos los blobs a un pack nuevo.
  * 
- * Muestra todos los archivos actualmente añadidos para commit.
+ * Escribe el pack con los blobs del pack anterior más los agregados después, en orden
+ * de índice (los deltas quedan después de su base y se copian tal cual), lo abre, guarda
+ * el repositorio apuntando a él y recién entonces borra el pack anterior.
  * 
+ * @param repo Repositorio.
  * @return 0 en caso de éxito, -1 si ocurre un error.
  */
-int list_files()
+static int repack_locked(ugit_repo *repo)
 {
-    if (!check_repo_initialized()) return -1;
-
-    FileNode *current = file_list;
-    if (!current) 
+    if (!check_repo_initialized(repo)) return -1;
+    if (repo->dir == NULL) 
+    {
+        output_error("Error: El repositorio solo vive en memoria; no hay dónde guardar el pack.\n");
+        return -1;
+    }
+    if (repo->blobs.index.count == 0) 
     {
-        printf("No hay archivos en el área de preparación.\n");
+        output_event("repack", "No hay objetos sueltos para empaquetar.\n");
         return 0;
     }
-    
-    printf("Archivos en el área de preparación:\n");
-    while (current) 
+
+    uint32_t count = blob_count(&repo->blobs);
+    PackObject *objects = (PackObject *)malloc(count * sizeof(PackObject));
+    BlobRecord *records = (BlobRecord *)malloc(count * sizeof(BlobRecord));
+    uint32_t *positions = (uint32_t *)malloc(count * sizeof(uint32_t));
+    if (!objects || !records || !positions) 
     {
-        printf("%s\n", current->filename);
-        current = current->next;
+        perror("Error al asignar memoria para el pack");
+        free(objects);
+        free(records);
+        free(positions);
+        return -1;
     }
-    return 0;
+
+    int result = 0;
+    for (uint32_t i = 0; i < count && result == 0; i++) 
+    {
+        records[i] = *blob_record(&repo->blobs, i);
+        objects[i].id = records[i].id;
+        objects[i].blob = i;
+        objects[i].bytes = blob_stored(&repo->blobs, i);
+        objects[i].length = records[i].length;
+        if (objects[i].bytes == NULL) 
+        {
+            output_error("Error: El contenido de un archivo no está en el pack.\n");
+            result = -1;
+        }
+    }
+
+    object_id id;
+    PackFile pack;
+    char path[PATH_MAX];
+    object_id old_id = repo->blobs.pack.id;
+    uint32_t old_count = repo->blobs.pack.count;
+    if (result == 0) result = pack_write(repo->dir, objects, count, &id, positions);
+    if (result == 0 && (pack_path(repo->dir, &id, path) != 0 || pack_open(&pack, path) != 0)) result = -1;
+    if (result == 0) 
+    {
+        result = adopt_pack(repo, records, positions, count, &pack);
+        if (result != 0) pack_close(&pack);
+    }
+    if (result == 0) result = save_repo(repo, 1);
+    if (result == 0) 
+    {
+        output_event("repack", "{count:z} objetos empaquetados en {path:s}.\n", (size_t)count, path);
+        if (old_count > 0 && memcmp(old_id.hash, id.hash, SHA1_DIGEST_SIZE) != 0 && pack_path(repo->dir, &old_id, path) == 0) remove(path);
+    }
+
+    free(objects);
+    free(records);
+    free(positions);
+    return result;
+}
+
+/**
+ * @brief Mueve los bytes de todos los blobs a un pack nuevo tomando el lock de escritura.
+ * 
+ * @param repo Repositorio.
+ * @return 0 en caso de éxito, -1 si ocurre un error.
+ */
+int repack_repo(ugit_repo *repo)
+{
+    lock_repo(repo);
+    return unlock_repo(repo, repack_locked(repo));
 }
@@ -5,118 +5,353 @@
  * Este archivo contiene las definiciones de las estructuras de datos y los prototipos
  * de funciones para un sistema simple tipo Git. Incluye funcionalidad para inicializar 
  * un repositorio, agregar/eliminar archivos, hacer commits, listar archivos y restaurar commits previos.
+ * Cada operación recibe el repositorio (ugit_repo) sobre el que trabaja, así un proceso puede
+ * mantener muchos repositorios independientes.
  * 
  * @authors
  * - Benjamin Sanhueza (bsanhuez@umag.cl)
  * - Nicolas Mancilla (nicmanci@umag.cl)
  */
 
+#ifndef GIT_H
 #define GIT_H
 
+#include <stddef.h>
+#include <stdint.h>
+#include "objstore.h"
+#include "statcache.h"
+
 #define MAX_ARG_LENGTH 50 ///< Número máximo de caracteres para nombres de archivos y mensajes de commit.
-#define MAX_COMMAND_LENGTH 100 ///< Número máximo de caracteres para la entrada de comandos.
-#define MAX_FILES 10 ///< Número máximo de archivos permitidos por commit.
-#define MAX_COMMIT 15 ///< Número máximo de commits por versión.
+#define MAX_COMMAND_LENGTH 8192 ///< Capacidad de una línea de comando, contando el '\0'; las líneas más largas se rechazan enteras.
+#define COMMIT_NONE UINT32_MAX ///< Índice que indica la ausencia de commit.
+#define COMMIT_MAX_PARENTS 2 ///< Padres de un commit: el anterior y, en un merge, el de la rama unida.
+#define BRANCH_NONE UINT32_MAX ///< Índice de rama que indica HEAD desacoplado (checkout de un commit).
+#define DEFAULT_BRANCH "main" ///< Rama creada por init_repo().
+#define REPO_DIR ".ugit" ///< Directorio donde se guarda el repositorio.
+#define REPO_STORE_NAME "repo" ///< Nombre del archivo binario dentro del directorio del repositorio.
+#define REPO_FILE REPO_DIR "/" REPO_STORE_NAME ///< Archivo binario del repositorio por defecto.
+
+/**
+ * @brief Repositorio: área de preparación, historia y tablas asociadas.
+ * 
+ * Es opaco; se crea con repo_create() y se destruye con repo_destroy(). Distintos
+ * repositorios no comparten estado, así que pueden usarse desde hilos distintos.
+ * 
+ * Un mismo repositorio también admite varios hilos: las operaciones que lo modifican
+ * (init_repo, open_repo, add_file, remove_file, commit, checkout_commit) se serializan
+ * con un mutex, mientras log_commits() y list_files() leen sin tomarlo, en paralelo con
+ * el escritor. close_repo() y repo_destroy() requieren que ningún otro hilo lo use.
+ */
+typedef struct ugit_repo ugit_repo;
 
 /**
  * @brief Estructura que representa un nodo de archivo en el repositorio.
  * 
- * Esta estructura contiene el nombre del archivo y un puntero al siguiente nodo de archivo.
+ * Esta estructura contiene el identificador del nombre del archivo en la tabla de
+ * cadenas (ver intern.h), su hash, el blob con el contenido preparado (ver blob.h) y
+ * los punteros de la lista doblemente enlazada del área de preparación. El hash se usa como clave en el índice de direccionamiento
+ * abierto, y @c prev permite eliminar en O(1).
  */
 typedef struct FileNode 
 {
-    char filename[MAX_ARG_LENGTH]; ///< Nombre del archivo.
+    uint32_t name; ///< Identificador del nombre del archivo en la tabla de cadenas.
+    uint32_t hash; ///< Hash del nombre (FNV-1a).
+    uint32_t blob; ///< Índice del blob con el contenido que se guardará en el siguiente commit.
+    FileStat stat; ///< Datos de stat del archivo cuando tenía el contenido de @c blob.
     struct FileNode *next; ///< Puntero al siguiente nodo de archivo.
+    struct FileNode *prev; ///< Puntero al nodo de archivo anterior.
 } FileNode;
 
 /**
  * @brief Estructura que representa un commit en el sistema de control de versiones.
  * 
- * Un commit contiene un arreglo de nodos de archivo y un mensaje asociado con el commit.
+ * Un commit contiene los archivos incluidos, con su contenido, y un mensaje asociado con el commit.
+ * Se identifica por el hash SHA-1 de su contenido serializado (árbol de archivos,
+ * commits padre y mensaje), igual que en Git.
+ * 
+ * Es un registro de ancho fijo y sin punteros: el mensaje se referencia por su
+ * identificador en la tabla de cadenas, los archivos por la raíz de su árbol (ver
+ * tree.h), que comparte con los commits vecinos todos los nodos que no cambiaron, y
+ * los padres por su índice en la tabla de commits. Así las tablas se guardan y se
+ * mapean desde disco tal cual.
+ * 
+ * Los padres forman un grafo acíclico: un commit normal tiene un padre y un merge
+ * tiene dos. Como un commit solo puede apuntar a commits que ya existen, el índice de
+ * cada padre es menor que el del hijo. El número de generación (ver graph.h) permite
+ * responder consultas de ascendencia sin recorrer toda la historia.
  */
 typedef struct commitGit 
 {
-    FileNode archivos[MAX_FILES]; ///< Lista de archivos incluidos en el commit.
-    char mensaje[MAX_ARG_LENGTH]; ///< Mensaje del commit.
-    struct commitGit *next; ///< Puntero al siguiente commit en la historia.
+    object_id id; ///< Identificador del commit (hash de su contenido).
+    object_id tree; ///< Identificador del conjunto de archivos del commit.
+    uint32_t parents[COMMIT_MAX_PARENTS]; ///< Índices de los padres (el primero es el anterior en la rama); los que faltan son COMMIT_NONE.
+    uint32_t mensaje; ///< Identificador del mensaje en la tabla de cadenas.
+    uint32_t archivos; ///< Raíz del árbol de archivos del commit (TREE_EMPTY si no tiene).
+    uint32_t generation; ///< Número de generación: 1 sin padres, o 1 más que el mayor de sus padres.
 } commitGit;
 
 /**
- * @brief Estructura que representa una versión en el sistema de control de versiones.
+ * @brief Estructura que representa una versión (rama con nombre) del repositorio.
  * 
- * Una versión contiene un número y un arreglo de commits.
+ * Cada versión es una entrada de la tabla de referencias: el nombre de la rama,
+ * internado en la tabla de cadenas, y el commit al que apunta. Al hacer commit sobre
+ * una rama, esta avanza al commit nuevo. La tabla tiene un índice hash por nombre, así
+ * resolver una rama no recorre ninguna lista.
  */
 typedef struct versionGit 
 {
-    int num_version; ///< Número de versión.
-    commitGit commit[MAX_ARG_LENGTH]; ///< Lista de commits en la versión.
-    struct versionGit *next; ///< Puntero a la siguiente versión.
+    uint32_t nombre; ///< Identificador del nombre de la rama en la tabla de cadenas.
+    uint32_t commit; ///< Índice del commit al que apunta, o COMMIT_NONE si la rama aún no tiene commits.
 } versionGit;
 
+/**
+ * @brief Crea un repositorio vacío, sin inicializar.
+ * 
+ * @param dir Directorio donde se guardará (por ejemplo REPO_DIR), o NULL para un
+ *            repositorio que solo vive en memoria.
+ * @return El repositorio, o NULL si no hay memoria.
+ */
+ugit_repo *repo_create(const char *dir);
+
+/**
+ * @brief Destruye un repositorio y libera su memoria, sin guardarlo.
+ * 
+ * @param repo Repositorio creado con repo_create() (puede ser NULL).
+ */
+void repo_destroy(ugit_repo *repo);
+
 /**
  * @brief Inicializa el repositorio.
  * 
- * Esta función configura el estado inicial del repositorio y lo marca como inicializado.
+ * Esta función configura el estado inicial del repositorio, crea su archivo en disco
+ * y lo marca como inicializado.
+ * 
+ * @param repo Repositorio.
+ * @return 0 en caso de éxito o si ya estaba inicializado, -1 si no se pudo crear.
+ */
+int init_repo(ugit_repo *repo);
+
+/**
+ * @brief Abre el repositorio guardado en disco, si existe.
+ * 
+ * Mapea el archivo del repositorio en memoria y usa sus tablas directamente, sin
+ * interpretarlas ni reservar memoria por commit.
  * 
- * @return 0 en caso de éxito, o 1 si el repositorio ya está inicializado.
+ * @param repo Repositorio.
+ * @return 1 si se cargó un repositorio, 0 si no existe, -1 si ocurrió un error.
  */
-int init_repo();
+int open_repo(ugit_repo *repo);
+
+/**
+ * @brief Guarda el repositorio en disco y libera sus recursos.
+ * 
+ * @param repo Repositorio.
+ * @return 0 en caso de éxito, -1 si no se pudo guardar.
+ */
+int close_repo(ugit_repo *repo);
 
 /**
  * @brief Agrega un archivo al área de preparación.
  * 
- * Esta función agrega un archivo al área de preparación para el siguiente commit.
+ * Esta función lee el archivo desde el árbol de trabajo (el directorio que contiene al
+ * del repositorio) y prepara su contenido para el siguiente commit. Si el archivo ya
+ * estaba en preparación, se reemplaza su contenido.
  * 
- * @param filename El nombre del archivo que se agregará.
+ * @param repo Repositorio.
+ * @param filename Ruta del archivo, relativa al árbol de trabajo.
  * @return 0 en caso de éxito, -1 si ocurrió un error.
  */
-int add_file(const char *filename);
+int add_file(ugit_repo *repo, const char *filename);
+
+/**
+ * @brief Agrega varios archivos o directorios completos al área de preparación.
+ * 
+ * Los directorios se recorren recursivamente ("." es todo el árbol de trabajo, sin el
+ * directorio del repositorio). Los archivos se leen y se les calcula el hash en paralelo,
+ * un hilo por núcleo, y luego se ponen en preparación todos juntos. Si algún archivo no
+ * se puede leer no se agrega ninguno. Con un único archivo equivale a add_file().
+ * 
+ * @param repo Repositorio.
+ * @param filenames Rutas relativas al árbol de trabajo.
+ * @param count Cantidad de rutas.
+ * @return 0 en caso de éxito, -1 si ocurrió un error.
+ */
+int add_paths(ugit_repo *repo, const char *const *filenames, size_t count);
 
 /**
  * @brief Crea un commit con los archivos en preparación.
  * 
  * Esta función realiza el commit de los archivos en preparación en el repositorio con un mensaje dado.
  * 
+ * @param repo Repositorio.
  * @param mensaje El mensaje del commit.
  * @return 0 en caso de éxito, -1 si ocurrió un error.
  */
-int commit(const char *mensaje);
+int commit(ugit_repo *repo, const char *mensaje);
+
+/**
+ * @brief Opciones del historial de commits.
+ * 
+ * Los filtros se combinan: un commit se muestra si cumple todos los indicados. @c skip
+ * y @c limit se aplican a los commits que pasan los filtros.
+ */
+typedef struct LogOptions 
+{
+    size_t limit; ///< Máximo de commits a mostrar (SIZE_MAX para todos).
+    size_t skip; ///< Commits que se omiten antes de empezar a mostrar.
+    const char *grep; ///< Patrón que debe aparecer en el mensaje, o NULL.
+    int fixed_strings; ///< 1 si @c grep es texto literal, 0 si es una expresión regular extendida.
+    const char *path; ///< Archivo que el commit debe agregar, modificar o quitar, o NULL.
+} LogOptions;
+
+/**
+ * @brief Prepara opciones que muestran toda la historia.
+ * 
+ * @param options Opciones a llenar.
+ */
+void log_options_init(LogOptions *options);
 
 /**
  * @brief Muestra el historial de commits.
  * 
- * Esta función imprime la lista de commits realizados en el repositorio.
+ * Esta función imprime los commits alcanzables desde HEAD, del más reciente al más
+ * antiguo. Cada commit se escribe apenas se encuentra, sin armar antes la lista
+ * completa, y el recorrido se detiene al llegar a @c limit.
  * 
+ * @param repo Repositorio.
+ * @param options Filtros y paginación, o NULL para toda la historia.
  * @return 0 en caso de éxito, -1 si ocurrió un error.
  */
-int log_commits();
+int log_commits(ugit_repo *repo, const LogOptions *options);
 
 /**
  * @brief Cambia a un commit anterior.
  * 
- * Esta función restaura el estado del repositorio al commit especificado.
+ * Esta función restaura el estado del repositorio al commit especificado, aplicando solo
+ * las diferencias entre los árboles de archivos y los cambios locales, y escribe o borra
+ * en el árbol de trabajo los archivos que cambian. No se realiza si sobrescribiría un
+ * archivo con cambios que no están en preparación. Si el texto es el
+ * nombre de una rama, HEAD queda en esa rama; si no, el commit se busca por su
+ * identificador completo o por una abreviación única de al menos OBJECT_MIN_PREFIX
+ * caracteres y, si no hay coincidencia, por mensaje, y HEAD queda desacoplado.
  * 
- * @param commit_id El mensaje o ID del commit al que se desea cambiar.
+ * @param repo Repositorio.
+ * @param commit_id La rama, el ID (o prefijo del ID) o el mensaje del commit al que se desea cambiar.
  * @return 0 en caso de éxito, -1 si no se encuentra el commit o ocurrió un error.
  */
-int checkout_commit(const char *commit_id);
+int checkout_commit(ugit_repo *repo, const char *commit_id);
 
 /**
  * @brief Lista los archivos en el área de preparación.
  * 
  * Esta función imprime la lista de archivos que están actualmente en el área de preparación para commit.
  * 
+ * @param repo Repositorio.
  * @return 0 en caso de éxito, -1 si ocurrió un error o no hay archivos en preparación.
  */
-int list_files();
+int list_files(ugit_repo *repo);
+
+/**
+ * @brief Muestra el estado del área de preparación y del árbol de trabajo.
+ * 
+ * Lista los cambios preparados respecto del último commit, los archivos preparados que
+ * cambiaron o se borraron en el árbol de trabajo y los archivos sin seguimiento. Un
+ * archivo cuyos datos de stat (fechas, largo e inodo) no cambiaron desde que se leyó se
+ * da por igual sin leerlo; los demás se leen y se compara su hash.
+ * 
+ * @param repo Repositorio.
+ * @return 0 en caso de éxito, -1 si ocurrió un error.
+ */
+int show_status(ugit_repo *repo);
+
+/**
+ * @brief Deja el área de preparación igual al árbol de trabajo (add -A).
+ * 
+ * Agrega los archivos sin seguimiento y los modificados, y quita los que se borraron.
+ * Usa la misma revisión que show_status(), así que con el monitor activo solo mira
+ * lo que cambió.
+ * 
+ * @param repo Repositorio.
+ * @return 0 en caso de éxito, -1 si ocurrió un error.
+ */
+int add_all(ugit_repo *repo);
+
+/**
+ * @brief Activa el monitor del árbol de trabajo (ver watch.h).
+ * 
+ * Mientras está activo, show_status() y add_all() revisan solo los archivos que
+ * cambiaron desde la consulta anterior, más los que seguían con cambios; la primera
+ * consulta revisa todo. El monitor vive mientras el repositorio esté abierto.
+ * 
+ * @param repo Repositorio.
+ * @return 0 en caso de éxito, -1 si ocurrió un error.
+ */
+int start_watch(ugit_repo *repo);
+
+/**
+ * @brief Detiene el monitor del árbol de trabajo.
+ * 
+ * @param repo Repositorio.
+ * @return 0 en caso de éxito, -1 si el monitor no estaba activo.
+ */
+int stop_watch(ugit_repo *repo);
+
+/**
+ * @brief Mueve el contenido de todos los archivos guardados a un pack (ver pack.h).
+ * 
+ * Después del repack el archivo del repositorio ya no incluye esos bytes, así que
+ * guardarlo deja de costar en proporción al tamaño de la historia. Los blobs
+ * agregados después quedan sueltos hasta el siguiente repack.
+ * 
+ * @param repo Repositorio.
+ * @return 0 en caso de éxito, -1 si ocurrió un error.
+ */
+int repack_repo(ugit_repo *repo);
 
 /**
  * @brief Elimina un archivo del área de preparación.
  * 
- * Esta función elimina un archivo específico del área de preparación.
+ * Esta función elimina un archivo específico del área de preparación. El archivo del
+ * árbol de trabajo no se borra.
  * 
+ * @param repo Repositorio.
  * @param filename El nombre del archivo que se desea eliminar.
  * @return 0 en caso de éxito, -1 si no se encuentra el archivo o si ocurrió un error.
  */
-int remove_file(const char *filename);
+int remove_file(ugit_repo *repo, const char *filename);
+
+/**
+ * @brief Muestra las ramas del repositorio.
+ * 
+ * Imprime cada rama con el commit al que apunta y marca con '*' la rama actual.
+ * 
+ * @param repo Repositorio.
+ * @return 0 en caso de éxito, -1 si ocurrió un error.
+ */
+int list_branches(ugit_repo *repo);
+
+/**
+ * @brief Crea una rama en el commit actual.
+ * 
+ * La rama nueva apunta a HEAD; para trabajar en ella hay que hacer checkout.
+ * 
+ * @param repo Repositorio.
+ * @param branch El nombre de la rama.
+ * @return 0 en caso de éxito, -1 si ya existe, no hay commits o ocurrió un error.
+ */
+int create_branch(ugit_repo *repo, const char *branch);
+
+/**
+ * @brief Une una rama con el commit actual.
+ * 
+ * Avanza HEAD si la rama lo contiene; si las historias divergieron, aplica los cambios
+ * de la rama desde el ancestro común y crea un commit de merge con dos padres. Si ambas
+ * ramas cambiaron el mismo archivo de forma distinta, informa el conflicto y no une.
+ * 
+ * @param repo Repositorio.
+ * @param branch El nombre de la rama a unir.
+ * @return 0 en caso de éxito, -1 si no existe, hay cambios sin commit, hay conflictos o ocurrió un error.
+ */
+int merge_branch(ugit_repo *repo, const char *branch);
 
+#endif
@@ -0,0 +1,472 @@
+/**
+ * @file graph.c
+ * @brief Implementación de las consultas de ascendencia con números de generación.
+ * 
+ * @authors
+ * Benjamin Sanhueza (bsanhuez@umag.cl)
+ * Nicolas Mancilla (nicmanci@umag.cl)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "graph.h"
+
+#define GRAPH_EPOCH_LIMIT (1u << 30) ///< Época a partir de la cual se limpian las marcas.
+
+/**
+ * @brief Obtiene un commit por su índice.
+ * 
+ * @param graph Grafo de commits.
+ * @param index Índice del commit.
+ * @return Registro del commit.
+ */
+static const commitGit *graph_commit(const CommitGraph *graph, uint32_t index)
+{
+    return (const commitGit *)segment_at(graph->commits, (size_t)index * sizeof(commitGit));
+}
+
+/**
+ * @brief Prepara el estado de consultas.
+ * 
+ * @param graph Estado a preparar.
+ * @param commits Segmento con los registros commitGit.
+ */
+void graph_init(CommitGraph *graph, const Segment *commits)
+{
+    memset(graph, 0, sizeof(*graph));
+    graph->commits = commits;
+}
+
+/**
+ * @brief Calcula la generación de un commit nuevo.
+ * 
+ * @param graph Grafo de commits.
+ * @param parents Índices de los padres.
+ * @return 1 más que la mayor generación de los padres (1 si no tiene).
+ */
+uint32_t graph_generation(const CommitGraph *graph, const uint32_t parents[COMMIT_MAX_PARENTS])
+{
+    uint32_t generation = 0;
+    for (int i = 0; i < COMMIT_MAX_PARENTS && parents[i] != COMMIT_NONE; i++)
+    {
+        uint32_t parent = graph_commit(graph, parents[i])->generation;
+        if (parent > generation) generation = parent;
+    }
+    return generation + 1;
+}
+
+/**
+ * @brief Comienza una consulta: garantiza marcas hasta @p top y avanza la época.
+ * 
+ * @param graph Grafo de commits.
+ * @param top Mayor índice que puede visitar la consulta.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+static int begin_query(CommitGraph *graph, uint32_t top)
+{
+    if ((size_t)top >= graph->mark_capacity)
+    {
+        size_t capacity = graph->mark_capacity ? graph->mark_capacity : 1024;
+        while (capacity <= (size_t)top) capacity *= 2;
+        uint32_t *marks = (uint32_t *)realloc(graph->marks, capacity * sizeof(uint32_t));
+        if (!marks)
+        {
+            perror("Error al asignar memoria para el grafo de commits");
+            return -1;
+        }
+        memset(marks + graph->mark_capacity, 0, (capacity - graph->mark_capacity) * sizeof(uint32_t));
+        graph->marks = marks;
+        graph->mark_capacity = capacity;
+    }
+
+    if (++graph->epoch >= GRAPH_EPOCH_LIMIT)
+    {
+        memset(graph->marks, 0, graph->mark_capacity * sizeof(uint32_t));
+        graph->epoch = 1;
+    }
+    graph->queue_len = 0;
+    return 0;
+}
+
+/**
+ * @brief Lados que ya alcanzaron un commit en la consulta actual.
+ * 
+ * @param graph Grafo de commits.
+ * @param index Índice del commit.
+ * @return Marcas (bit 1: primer lado, bit 2: segundo lado), o 0 si no se visitó.
+ */
+static unsigned int get_mark(const CommitGraph *graph, uint32_t index)
+{
+    uint32_t mark = graph->marks[index];
+    return mark >> 2 == graph->epoch ? mark & 3u : 0;
+}
+
+/**
+ * @brief Agrega lados a las marcas de un commit.
+ * 
+ * @param graph Grafo de commits.
+ * @param index Índice del commit.
+ * @param flags Lados a agregar.
+ */
+static void add_mark(CommitGraph *graph, uint32_t index, unsigned int flags)
+{
+    graph->marks[index] = graph->epoch << 2 | get_mark(graph, index) | flags;
+}
+
+/**
+ * @brief Indica si un commit debe salir de la cola antes que otro.
+ * 
+ * Los commits salen por generación descendente (y por índice si empatan), así un
+ * commit sale después de todos sus descendientes pendientes.
+ * 
+ * @param graph Grafo de commits.
+ * @param a Primer índice.
+ * @param b Segundo índice.
+ * @return 1 si @p a va antes que @p b.
+ */
+static int comes_before(const CommitGraph *graph, uint32_t a, uint32_t b)
+{
+    uint32_t ga = graph_commit(graph, a)->generation;
+    uint32_t gb = graph_commit(graph, b)->generation;
+    return ga != gb ? ga > gb : a > b;
+}
+
+/**
+ * @brief Agrega un índice al final de la cola, creciendo si hace falta.
+ * 
+ * @param graph Grafo de commits.
+ * @param index Índice del commit.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+static int queue_append(CommitGraph *graph, uint32_t index)
+{
+    if (graph->queue_len == graph->queue_capacity)
+    {
+        size_t capacity = graph->queue_capacity ? graph->queue_capacity * 2 : 64;
+        uint32_t *queue = (uint32_t *)realloc(graph->queue, capacity * sizeof(uint32_t));
+        if (!queue)
+        {
+            perror("Error al asignar memoria para el grafo de commits");
+            return -1;
+        }
+        graph->queue = queue;
+        graph->queue_capacity = capacity;
+    }
+    graph->queue[graph->queue_len++] = index;
+    return 0;
+}
+
+/**
+ * @brief Inserta un índice en el montículo de la cola.
+ * 
+ * @param graph Grafo de commits.
+ * @param index Índice del commit.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+static int heap_push(CommitGraph *graph, uint32_t index)
+{
+    if (queue_append(graph, index) != 0) return -1;
+
+    size_t i = graph->queue_len - 1;
+    while (i > 0 && comes_before(graph, index, graph->queue[(i - 1) / 2]))
+    {
+        graph->queue[i] = graph->queue[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    graph->queue[i] = index;
+    return 0;
+}
+
+/**
+ * @brief Saca del montículo el commit de mayor generación.
+ * 
+ * @param graph Grafo de commits con la cola no vacía.
+ * @return Índice del commit.
+ */
+static uint32_t heap_pop(CommitGraph *graph)
+{
+    uint32_t top = graph->queue[0];
+    uint32_t last = graph->queue[--graph->queue_len];
+    size_t i = 0;
+    for (;;)
+    {
+        size_t child = 2 * i + 1;
+        if (child >= graph->queue_len) break;
+        if (child + 1 < graph->queue_len && comes_before(graph, graph->queue[child + 1], graph->queue[child])) child++;
+        if (!comes_before(graph, graph->queue[child], last)) break;
+        graph->queue[i] = graph->queue[child];
+        i = child;
+    }
+    if (graph->queue_len > 0) graph->queue[i] = last;
+    return top;
+}
+
+/**
+ * @brief Indica si un commit es ancestro de otro.
+ * 
+ * Recorre en profundidad desde @p descendant sin entrar a commits cuya generación no
+ * supera la de @p ancestor (o cuyo índice es menor), porque desde ellos no se puede
+ * llegar a él.
+ * 
+ * @param graph Grafo de commits.
+ * @param ancestor Posible ancestro.
+ * @param descendant Posible descendiente.
+ * @param result 1 si es ancestro, 0 si no.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+int graph_is_ancestor(CommitGraph *graph, uint32_t ancestor, uint32_t descendant, int *result)
+{
+    *result = 0;
+    if (ancestor == COMMIT_NONE || descendant == COMMIT_NONE || ancestor > descendant) return 0;
+    if (ancestor == descendant)
+    {
+        *result = 1;
+        return 0;
+    }
+
+    uint32_t floor = graph_commit(graph, ancestor)->generation;
+    if (graph_commit(graph, descendant)->generation <= floor) return 0;
+    if (begin_query(graph, descendant) != 0 || queue_append(graph, descendant) != 0) return -1;
+    add_mark(graph, descendant, 1);
+
+    while (graph->queue_len > 0)
+    {
+        const commitGit *current = graph_commit(graph, graph->queue[--graph->queue_len]);
+        for (int i = 0; i < COMMIT_MAX_PARENTS && current->parents[i] != COMMIT_NONE; i++)
+        {
+            uint32_t parent = current->parents[i];
+            if (parent == ancestor)
+            {
+                *result = 1;
+                return 0;
+            }
+            if (parent < ancestor || get_mark(graph, parent) != 0 || graph_commit(graph, parent)->generation <= floor) continue;
+            add_mark(graph, parent, 1);
+            if (queue_append(graph, parent) != 0) return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Busca el mejor ancestro común de dos commits.
+ * 
+ * Marca los ancestros de cada lado sacando los commits por generación descendente:
+ * cuando un commit sale, ya recibió las marcas de todos sus descendientes pendientes,
+ * así el primero que tiene ambas marcas es un ancestro común que no es ancestro de
+ * otro. La búsqueda termina ahí, sin visitar la historia bajo él.
+ * 
+ * @param graph Grafo de commits.
+ * @param a Primer commit.
+ * @param b Segundo commit.
+ * @param base Ancestro común resultante, o COMMIT_NONE.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+int graph_merge_base(CommitGraph *graph, uint32_t a, uint32_t b, uint32_t *base)
+{
+    *base = COMMIT_NONE;
+    if (a == COMMIT_NONE || b == COMMIT_NONE) return 0;
+    if (a == b)
+    {
+        *base = a;
+        return 0;
+    }
+
+    if (begin_query(graph, a > b ? a : b) != 0 || heap_push(graph, a) != 0 || heap_push(graph, b) != 0) return -1;
+    add_mark(graph, a, 1);
+    add_mark(graph, b, 2);
+
+    while (graph->queue_len > 0)
+    {
+        uint32_t index = heap_pop(graph);
+        unsigned int flags = get_mark(graph, index);
+        if (flags == 3u)
+        {
+            *base = index;
+            return 0;
+        }
+
+        const commitGit *current = graph_commit(graph, index);
+        for (int i = 0; i < COMMIT_MAX_PARENTS && current->parents[i] != COMMIT_NONE; i++)
+        {
+            uint32_t parent = current->parents[i];
+            unsigned int seen = get_mark(graph, parent);
+            if ((seen | flags) == seen) continue;
+            add_mark(graph, parent, flags);
+            if (seen == 0 && heap_push(graph, parent) != 0) return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Calcula la posición del bit @p i de un nombre en un filtro.
+ * 
+ * Usa doble hashing: el hash del nombre y una mezcla de él como paso.
+ * 
+ * @param hash Hash del nombre.
+ * @param i Número de la posición (menor que PATH_FILTER_HASHES).
+ * @return Posición del bit dentro del filtro.
+ */
+static unsigned int filter_bit(uint32_t hash, unsigned int i)
+{
+    uint32_t step = hash * 0x9E3779B1u;
+    step = (step ^ (step >> 15)) | 1u;
+    return (hash + i * step) % (PATH_FILTER_WORDS * 64);
+}
+
+/**
+ * @brief Arma el filtro de un commit.
+ * 
+ * @param filter Filtro a llenar.
+ * @param hashes Hash de cada nombre cambiado.
+ * @param count Cantidad de nombres.
+ */
+void path_filter_build(PathFilter *filter, const uint32_t *hashes, size_t count)
+{
+    memset(filter, count > PATH_FILTER_MAX_PATHS ? 0xFF : 0, sizeof(*filter));
+    if (count > PATH_FILTER_MAX_PATHS) return;
+
+    for (size_t n = 0; n < count; n++) 
+    {
+        for (unsigned int i = 0; i < PATH_FILTER_HASHES; i++) 
+        {
+            unsigned int bit = filter_bit(hashes[n], i);
+            filter->bits[bit / 64] |= (uint64_t)1 << (bit % 64);
+        }
+    }
+}
+
+/**
+ * @brief Indica si un nombre puede estar en el filtro.
+ * 
+ * @param filter Filtro de un commit.
+ * @param hash Hash del nombre.
+ * @return 0 si seguro no está, 1 si puede estar.
+ */
+int path_filter_maybe(const PathFilter *filter, uint32_t hash)
+{
+    for (unsigned int i = 0; i < PATH_FILTER_HASHES; i++) 
+    {
+        unsigned int bit = filter_bit(hash, i);
+        if (!(filter->bits[bit / 64] & ((uint64_t)1 << (bit % 64)))) return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Agrega un commit a la cola de un recorrido, si no se agregó antes.
+ * 
+ * @param walk Recorrido.
+ * @param index Índice del commit.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+static int walk_push(GraphWalk *walk, uint32_t index)
+{
+    if (walk->seen[index / 8] & (1u << (index % 8))) return 0;
+    walk->seen[index / 8] |= (unsigned char)(1u << (index % 8));
+
+    if (walk->heap_len == walk->heap_capacity) 
+    {
+        size_t capacity = walk->heap_capacity ? walk->heap_capacity * 2 : 16;
+        uint32_t *heap = (uint32_t *)realloc(walk->heap, capacity * sizeof(uint32_t));
+        if (!heap) 
+        {
+            perror("Error al asignar memoria para el recorrido de commits");
+            return -1;
+        }
+        walk->heap = heap;
+        walk->heap_capacity = capacity;
+    }
+
+    size_t i = walk->heap_len++;
+    while (i > 0 && walk->heap[(i - 1) / 2] < index) 
+    {
+        walk->heap[i] = walk->heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    walk->heap[i] = index;
+    return 0;
+}
+
+/**
+ * @brief Comienza un recorrido desde un commit.
+ * 
+ * @param walk Recorrido a preparar.
+ * @param commits Segmento con los registros commitGit.
+ * @param head Commit inicial, o COMMIT_NONE.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+int graph_walk_begin(GraphWalk *walk, const Segment *commits, uint32_t head)
+{
+    memset(walk, 0, sizeof(*walk));
+    walk->commits = commits;
+    if (head == COMMIT_NONE) return 0;
+
+    walk->seen = (unsigned char *)calloc((size_t)head / 8 + 1, 1);
+    if (!walk->seen) 
+    {
+        perror("Error al asignar memoria para el recorrido de commits");
+        return -1;
+    }
+    return walk_push(walk, head);
+}
+
+/**
+ * @brief Entrega el siguiente commit del recorrido y encola sus padres.
+ * 
+ * @param walk Recorrido.
+ * @param index Índice del commit entregado.
+ * @return 1 si entregó un commit, 0 si terminó, -1 si no hay memoria.
+ */
+int graph_walk_next(GraphWalk *walk, uint32_t *index)
+{
+    if (walk->heap_len == 0) return 0;
+
+    uint32_t top = walk->heap[0];
+    uint32_t last = walk->heap[--walk->heap_len];
+    size_t i = 0;
+    for (;;) 
+    {
+        size_t child = 2 * i + 1;
+        if (child >= walk->heap_len) break;
+        if (child + 1 < walk->heap_len && walk->heap[child + 1] > walk->heap[child]) child++;
+        if (walk->heap[child] <= last) break;
+        walk->heap[i] = walk->heap[child];
+        i = child;
+    }
+    if (walk->heap_len > 0) walk->heap[i] = last;
+
+    const commitGit *current = (const commitGit *)segment_at(walk->commits, (size_t)top * sizeof(commitGit));
+    for (int p = 0; p < COMMIT_MAX_PARENTS && current->parents[p] != COMMIT_NONE; p++) 
+    {
+        if (walk_push(walk, current->parents[p]) != 0) return -1;
+    }
+    *index = top;
+    return 1;
+}
+
+/**
+ * @brief Libera la memoria de un recorrido.
+ * 
+ * @param walk Recorrido.
+ */
+void graph_walk_end(GraphWalk *walk)
+{
+    free(walk->seen);
+    free(walk->heap);
+    memset(walk, 0, sizeof(*walk));
+}
+
+/**
+ * @brief Libera las marcas y la cola.
+ * 
+ * @param graph Grafo de commits.
+ */
+void graph_free(CommitGraph *graph)
+{
+    free(graph->marks);
+    free(graph->queue);
+    graph_init(graph, graph->commits);
+}
@@ -0,0 +1,178 @@
+/**
+ * @file graph.h
+ * @brief Consultas de ascendencia sobre el grafo de commits con números de generación.
+ * 
+ * La tabla de commits ya es un grafo plano: cada registro guarda los índices de sus
+ * padres y su número de generación (1 para un commit sin padres, y 1 más que el mayor
+ * de sus padres en otro caso). Como la tabla se guarda y se mapea tal cual, el índice
+ * queda persistido junto con los commits sin una sección aparte.
+ * 
+ * La generación permite podar: si A es ancestro de B, la generación de A es menor que
+ * la de B, y ningún commit con generación menor que la de A puede llevar hasta A. Así
+ * "¿es A ancestro de B?" y el ancestro común de dos commits recorren solo la parte del
+ * grafo que está sobre la respuesta, no toda la historia.
+ * 
+ * Junto a la tabla de commits hay un índice paralelo de filtros de Bloom (PathFilter)
+ * con los nombres que cada commit agregó o quitó respecto de su primer padre. Las
+ * consultas limitadas a un archivo descartan con él casi todos los commits sin mirar
+ * sus árboles.
+ * 
+ * @authors
+ * - Benjamin Sanhueza (bsanhuez@umag.cl)
+ * - Nicolas Mancilla (nicmanci@umag.cl)
+ */
+
+#ifndef GRAPH_H
+#define GRAPH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "git.h"
+#include "store.h"
+
+#define PATH_FILTER_WORDS 4 ///< Palabras de 64 bits de cada filtro (256 bits).
+#define PATH_FILTER_HASHES 4 ///< Posiciones que marca cada nombre.
+#define PATH_FILTER_MAX_PATHS 32 ///< Cambios sobre los que el filtro se llena entero ("quizás" para todo).
+
+/**
+ * @brief Filtro de Bloom de los nombres que cambió un commit.
+ * 
+ * Es de ancho fijo para que el índice de filtros se guarde y se mapee igual que la
+ * tabla de commits: el filtro del commit i está en la posición i. Un filtro puede dar
+ * falsos positivos, nunca falsos negativos.
+ */
+typedef struct PathFilter 
+{
+    uint64_t bits[PATH_FILTER_WORDS]; ///< Bits del filtro.
+} PathFilter;
+
+/**
+ * @brief Estado reutilizable de las consultas sobre el grafo de commits.
+ * 
+ * Las marcas llevan el número de la consulta en sus bits altos, así no hay que
+ * limpiarlas entre consultas. No es seguro usarlo desde dos hilos a la vez.
+ */
+typedef struct CommitGraph 
+{
+    const Segment *commits; ///< Registros commitGit.
+    uint32_t *marks; ///< Por commit: (época << 2) | lados que lo alcanzan.
+    size_t mark_capacity; ///< Elementos de @c marks.
+    uint32_t epoch; ///< Número de la consulta actual.
+    uint32_t *queue; ///< Cola de prioridad (montículo) o pila de índices pendientes.
+    size_t queue_len; ///< Elementos en @c queue.
+    size_t queue_capacity; ///< Capacidad de @c queue.
+} CommitGraph;
+
+/**
+ * @brief Recorrido incremental de los commits alcanzables desde uno dado.
+ * 
+ * Entrega los commits de mayor a menor índice (del más reciente al más antiguo), cada
+ * uno una sola vez y después de todos sus descendientes. Solo visita lo que se pide,
+ * así mostrar los primeros commits no depende del largo de la historia. Solo lee la
+ * tabla de commits, por lo que puede usarse sin el lock de escritura.
+ */
+typedef struct GraphWalk 
+{
+    const Segment *commits; ///< Registros commitGit.
+    unsigned char *seen; ///< Un bit por commit: ya se agregó a la cola.
+    uint32_t *heap; ///< Montículo de índices pendientes (el mayor primero).
+    size_t heap_len; ///< Elementos en @c heap.
+    size_t heap_capacity; ///< Capacidad de @c heap.
+} GraphWalk;
+
+/**
+ * @brief Prepara el estado de consultas sobre una tabla de commits.
+ * 
+ * @param graph Estado a preparar.
+ * @param commits Segmento con los registros commitGit.
+ */
+void graph_init(CommitGraph *graph, const Segment *commits);
+
+/**
+ * @brief Calcula la generación de un commit nuevo a partir de sus padres.
+ * 
+ * @param graph Grafo de commits.
+ * @param parents Índices de los padres (COMMIT_NONE en los que faltan).
+ * @return Número de generación del commit.
+ */
+uint32_t graph_generation(const CommitGraph *graph, const uint32_t parents[COMMIT_MAX_PARENTS]);
+
+/**
+ * @brief Indica si un commit es ancestro de otro (o el mismo).
+ * 
+ * @param graph Grafo de commits.
+ * @param ancestor Posible ancestro.
+ * @param descendant Posible descendiente.
+ * @param result 1 si @p ancestor es alcanzable desde @p descendant, 0 si no.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+int graph_is_ancestor(CommitGraph *graph, uint32_t ancestor, uint32_t descendant, int *result);
+
+/**
+ * @brief Busca el mejor ancestro común de dos commits.
+ * 
+ * El resultado es un ancestro común que no es ancestro de ningún otro ancestro común.
+ * 
+ * @param graph Grafo de commits.
+ * @param a Primer commit (puede ser COMMIT_NONE).
+ * @param b Segundo commit (puede ser COMMIT_NONE).
+ * @param base Ancestro común resultante, o COMMIT_NONE si no tienen.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+int graph_merge_base(CommitGraph *graph, uint32_t a, uint32_t b, uint32_t *base);
+
+/**
+ * @brief Arma el filtro de un commit a partir de los nombres que cambió.
+ * 
+ * Si son más de PATH_FILTER_MAX_PATHS, el filtro queda lleno y responde que sí a
+ * cualquier nombre, porque con tantos cambios dejaría de descartar commits.
+ * 
+ * @param filter Filtro a llenar.
+ * @param hashes Hash de cada nombre (el de la tabla de cadenas).
+ * @param count Cantidad de nombres.
+ */
+void path_filter_build(PathFilter *filter, const uint32_t *hashes, size_t count);
+
+/**
+ * @brief Indica si un nombre puede estar en el filtro.
+ * 
+ * @param filter Filtro de un commit.
+ * @param hash Hash del nombre.
+ * @return 0 si el commit seguro no cambió el nombre, 1 si puede haberlo cambiado.
+ */
+int path_filter_maybe(const PathFilter *filter, uint32_t hash);
+
+/**
+ * @brief Comienza un recorrido desde un commit.
+ * 
+ * @param walk Recorrido a preparar.
+ * @param commits Segmento con los registros commitGit.
+ * @param head Commit inicial, o COMMIT_NONE para un recorrido vacío.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+int graph_walk_begin(GraphWalk *walk, const Segment *commits, uint32_t head);
+
+/**
+ * @brief Entrega el siguiente commit del recorrido.
+ * 
+ * @param walk Recorrido.
+ * @param index Índice del commit entregado.
+ * @return 1 si entregó un commit, 0 si el recorrido terminó, -1 si no hay memoria.
+ */
+int graph_walk_next(GraphWalk *walk, uint32_t *index);
+
+/**
+ * @brief Libera la memoria de un recorrido.
+ * 
+ * @param walk Recorrido.
+ */
+void graph_walk_end(GraphWalk *walk);
+
+/**
+ * @brief Libera las marcas y la cola del estado de consultas.
+ * 
+ * @param graph Grafo de commits.
+ */
+void graph_free(CommitGraph *graph);
+
+#endif
@@ -0,0 +1,224 @@
+/**
+ * @file hashpool.c
+ * @brief Implementación del grupo de hilos que lee y calcula el hash de archivos.
+ * 
+ * @authors
+ * Benjamin Sanhueza (bsanhuez@umag.cl)
+ * Nicolas Mancilla (nicmanci@umag.cl)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "hashpool.h"
+#include "blob.h"
+
+/**
+ * @brief Estado compartido entre los lectores y el hilo que consume los resultados.
+ */
+typedef struct HashPool
+{
+    char *const *paths; ///< Rutas de los archivos.
+    size_t count; ///< Cantidad de rutas.
+    size_t next; ///< Próximo archivo a tomar (se incrementa de forma atómica).
+    int stop; ///< Distinto de 0 si los lectores deben dejar de tomar archivos.
+    hash_prepare_fn prepare; ///< Función que completa cada resultado en el lector, o NULL.
+    void *data; ///< Dato para @c prepare.
+
+    pthread_mutex_t lock; ///< Protege la cola y @c running.
+    pthread_cond_t ready; ///< Hay resultados en la cola o terminó un lector.
+    pthread_cond_t space; ///< Hay espacio en la cola.
+    HashResult queue[HASHPOOL_QUEUE_SIZE]; ///< Cola circular de resultados.
+    size_t head; ///< Posición del resultado más antiguo.
+    size_t len; ///< Resultados en la cola.
+    size_t running; ///< Lectores que no han terminado.
+} HashPool;
+
+/**
+ * @brief Lee un archivo, calcula su identificador de blob y lo completa con la función
+ *        de preparación.
+ * 
+ * @param pool Estado con la lista de archivos.
+ * @param index Posición del archivo en la lista.
+ * @param result Resultado a completar.
+ */
+static void hash_file(const HashPool *pool, size_t index, HashResult *result)
+{
+    memset(result, 0, sizeof(*result));
+    result->index = index;
+    result->error = blob_load(pool->paths[index], &result->content, &result->size, &result->info);
+    if (result->error != 0) return;
+    object_hash("blob", result->content, result->size, &result->id);
+    if (pool->prepare) pool->prepare(result, pool->data);
+}
+
+/**
+ * @brief Libera la memoria de un resultado ya entregado.
+ * 
+ * @param result Resultado.
+ */
+static void result_free(HashResult *result)
+{
+    free(result->content);
+    free(result->stored.buffer);
+}
+
+/**
+ * @brief Cuerpo de cada lector: toma archivos hasta agotar la lista y encola los resultados.
+ * 
+ * Espera cuando la cola está llena, así los lectores no se adelantan más de
+ * HASHPOOL_QUEUE_SIZE archivos al consumidor.
+ * 
+ * @param arg Estado compartido.
+ * @return NULL.
+ */
+static void *hash_worker(void *arg)
+{
+    HashPool *pool = (HashPool *)arg;
+    for (;;)
+    {
+        if (__atomic_load_n(&pool->stop, __ATOMIC_ACQUIRE)) break;
+        size_t index = __atomic_fetch_add(&pool->next, 1, __ATOMIC_RELAXED);
+        if (index >= pool->count) break;
+
+        HashResult result;
+        hash_file(pool, index, &result);
+
+        pthread_mutex_lock(&pool->lock);
+        while (pool->len == HASHPOOL_QUEUE_SIZE) pthread_cond_wait(&pool->space, &pool->lock);
+        pool->queue[(pool->head + pool->len) % HASHPOOL_QUEUE_SIZE] = result;
+        pool->len++;
+        pthread_cond_signal(&pool->ready);
+        pthread_mutex_unlock(&pool->lock);
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->running--;
+    pthread_cond_signal(&pool->ready);
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+/**
+ * @brief Cantidad de lectores a usar: uno por núcleo, sin pasar del máximo ni de los archivos.
+ * 
+ * @param count Cantidad de archivos.
+ * @return Cantidad de hilos.
+ */
+static size_t thread_count(size_t count)
+{
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t threads = cores > 0 ? (size_t)cores : 1;
+    if (threads > HASHPOOL_MAX_THREADS) threads = HASHPOOL_MAX_THREADS;
+    if (threads > count) threads = count;
+    return threads;
+}
+
+/**
+ * @brief Lee los archivos en el hilo actual, cuando no hay lectores disponibles.
+ * 
+ * @param pool Estado con la lista de archivos.
+ * @param fn Función a llamar con cada resultado.
+ * @param data Dato para @p fn.
+ * @return 0 en caso de éxito, o el valor distinto de 0 de @p fn.
+ */
+static int run_inline(HashPool *pool, hash_result_fn fn, void *data)
+{
+    int result = 0;
+    for (size_t i = pool->next; i < pool->count && result == 0; i++)
+    {
+        HashResult item;
+        hash_file(pool, i, &item);
+        result = fn(&item, data);
+        result_free(&item);
+    }
+    return result;
+}
+
+/**
+ * @brief Lee y calcula el hash de una lista de archivos con un grupo de hilos.
+ * 
+ * El hilo que llama solo consume la cola. Si @p fn pide detenerse, los lectores dejan
+ * de tomar archivos y los resultados que ya estaban en camino se descartan.
+ * 
+ * @param paths Rutas de los archivos.
+ * @param count Cantidad de rutas.
+ * @param prepare Función a llamar en los lectores con cada archivo leído, o NULL.
+ * @param fn Función a llamar con cada resultado.
+ * @param data Dato para @p prepare y @p fn.
+ * @return 0 en caso de éxito, o el valor distinto de 0 de @p fn.
+ */
+int hashpool_run(char *const *paths, size_t count, hash_prepare_fn prepare, hash_result_fn fn, void *data)
+{
+    if (count == 0) return 0;
+
+    HashPool *pool = (HashPool *)calloc(1, sizeof(HashPool));
+    if (!pool)
+    {
+        perror("Error al asignar memoria para los lectores");
+        return -1;
+    }
+    pool->paths = paths;
+    pool->count = count;
+    pool->prepare = prepare;
+    pool->data = data;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->ready, NULL);
+    pthread_cond_init(&pool->space, NULL);
+
+    pthread_t threads[HASHPOOL_MAX_THREADS];
+    size_t wanted = thread_count(count);
+    size_t started = 0;
+    pthread_mutex_lock(&pool->lock);
+    for (; started < wanted; started++)
+    {
+        pool->running++;
+        if (pthread_create(&threads[started], NULL, hash_worker, pool) != 0)
+        {
+            pool->running--;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    int result = 0;
+    if (started == 0)
+    {
+        result = run_inline(pool, fn, data);
+    }
+    else
+    {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->len > 0 || pool->running > 0)
+        {
+            if (pool->len == 0)
+            {
+                pthread_cond_wait(&pool->ready, &pool->lock);
+                continue;
+            }
+            HashResult item = pool->queue[pool->head];
+            pool->head = (pool->head + 1) % HASHPOOL_QUEUE_SIZE;
+            pool->len--;
+            pthread_cond_signal(&pool->space);
+            pthread_mutex_unlock(&pool->lock);
+
+            if (result == 0)
+            {
+                result = fn(&item, data);
+                if (result != 0) __atomic_store_n(&pool->stop, 1, __ATOMIC_RELEASE);
+            }
+            result_free(&item);
+            pthread_mutex_lock(&pool->lock);
+        }
+        pthread_mutex_unlock(&pool->lock);
+        for (size_t i = 0; i < started; i++) pthread_join(threads[i], NULL);
+    }
+
+    pthread_cond_destroy(&pool->space);
+    pthread_cond_destroy(&pool->ready);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+    return result;
+}
@@ -0,0 +1,79 @@
+/**
+ * @file hashpool.h
+ * @brief Lectura y cálculo del hash de muchos archivos en paralelo.
+ * 
+ * Un grupo de hilos (uno por núcleo) toma los archivos de la lista, los lee y calcula
+ * el identificador de blob de cada uno. Los resultados vuelven al hilo que llamó por
+ * una cola acotada, así la memoria usada depende del largo de la cola y no de la
+ * cantidad de archivos, y solo ese hilo toca las tablas del repositorio. Opcionalmente
+ * cada lector también arma los bytes a guardar (delta y compresión, ver blob_prepare()),
+ * así el hilo que llamó solo agrega los registros.
+ * 
+ * @authors
+ * - Benjamin Sanhueza (bsanhuez@umag.cl)
+ * - Nicolas Mancilla (nicmanci@umag.cl)
+ */
+
+#ifndef HASHPOOL_H
+#define HASHPOOL_H
+
+#include <stddef.h>
+#include <sys/stat.h>
+#include "objstore.h"
+#include "blob.h"
+
+#define HASHPOOL_MAX_THREADS 64 ///< Máximo de hilos lectores.
+#define HASHPOOL_QUEUE_SIZE 64 ///< Resultados que pueden esperar en la cola antes de que los lectores se detengan.
+
+/**
+ * @brief Resultado de leer un archivo.
+ */
+typedef struct HashResult
+{
+    size_t index; ///< Posición del archivo en la lista de entrada.
+    int error; ///< 0 si se leyó, o el código errno de la falla (ver blob_load()).
+    char *content; ///< Contenido del archivo (solo si @c error es 0).
+    size_t size; ///< Largo del contenido.
+    object_id id; ///< Identificador de blob del contenido.
+    struct stat info; ///< Datos de stat del archivo, tomados antes de leerlo.
+    BlobBytes stored; ///< Bytes a guardar, si los armó la función de preparación (su @c buffer se libera al volver).
+} HashResult;
+
+/**
+ * @brief Función que completa cada resultado leído sin error, en el hilo del lector.
+ * 
+ * Corre en paralelo con las demás y con la función de resultados, así que solo debe
+ * leer datos que esta no modifique o que admitan lectores concurrentes.
+ * 
+ * @param result Resultado de un archivo.
+ * @param data Dato del usuario.
+ */
+typedef void (*hash_prepare_fn)(HashResult *result, void *data);
+
+/**
+ * @brief Función que recibe cada resultado, en el hilo que llamó a hashpool_run().
+ * 
+ * Los resultados llegan en el orden en que terminan los lectores, no en el de la lista.
+ * El contenido se libera al volver.
+ * 
+ * @param result Resultado de un archivo.
+ * @param data Dato del usuario.
+ * @return 0 para continuar, distinto de 0 para detener la lectura.
+ */
+typedef int (*hash_result_fn)(const HashResult *result, void *data);
+
+/**
+ * @brief Lee y calcula el hash de una lista de archivos con un grupo de hilos.
+ * 
+ * Entrega a @p fn exactamente un resultado por archivo, salvo que @p fn pida detenerse.
+ * 
+ * @param paths Rutas de los archivos.
+ * @param count Cantidad de rutas.
+ * @param prepare Función a llamar en los lectores con cada archivo leído, o NULL.
+ * @param fn Función a llamar con cada resultado.
+ * @param data Dato para @p prepare y @p fn.
+ * @return 0 en caso de éxito, o el valor distinto de 0 de @p fn.
+ */
+int hashpool_run(char *const *paths, size_t count, hash_prepare_fn prepare, hash_result_fn fn, void *data);
+
+#endif
@@ -0,0 +1,315 @@
+/**
+ * @file intern.c
+ * @brief Implementación de la tabla de internación de cadenas.
+ * 
+ * @authors
+ * Benjamin Sanhueza (bsanhuez@umag.cl)
+ * Nicolas Mancilla (nicmanci@umag.cl)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "intern.h"
+#include "output.h"
+
+/**
+ * @brief Calcula el hash FNV-1a de una cadena.
+ * 
+ * @param text Cadena.
+ * @return Hash de 32 bits.
+ */
+uint32_t intern_hash_string(const char *text)
+{
+    uint32_t hash = 2166136261u;
+    for (; *text != '\0'; text++) 
+    {
+        hash ^= (unsigned char)*text;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief Obtiene los datos de una cadena internada.
+ * 
+ * @param table Tabla de internación.
+ * @param id Identificador.
+ * @return Su InternEntry.
+ */
+static const InternEntry *entry_at(const InternTable *table, uint32_t id)
+{
+    return (const InternEntry *)segment_at(table->entries, (size_t)id * sizeof(InternEntry));
+}
+
+/**
+ * @brief Cantidad de cadenas internadas.
+ * 
+ * @param table Tabla de internación.
+ * @return Cantidad de identificadores.
+ */
+uint32_t intern_count(const InternTable *table)
+{
+    return (uint32_t)(segment_size(table->entries) / sizeof(InternEntry));
+}
+
+/**
+ * @brief Obtiene el texto de una cadena internada.
+ * 
+ * @param table Tabla de internación.
+ * @param id Identificador.
+ * @return La cadena.
+ */
+const char *intern_string(const InternTable *table, uint32_t id)
+{
+    return (const char *)segment_at(table->pool, entry_at(table, id)->offset);
+}
+
+/**
+ * @brief Obtiene el hash de una cadena internada.
+ * 
+ * @param table Tabla de internación.
+ * @param id Identificador.
+ * @return Hash de la cadena.
+ */
+uint32_t intern_hash(const InternTable *table, uint32_t id)
+{
+    return entry_at(table, id)->hash;
+}
+
+/**
+ * @brief Busca una cadena con su hash ya calculado.
+ * 
+ * @param table Tabla de internación.
+ * @param text Cadena.
+ * @param hash Hash de la cadena.
+ * @return Identificador, o INTERN_NONE.
+ */
+static uint32_t find_hashed(const InternTable *table, const char *text, uint32_t hash)
+{
+    uint32_t found;
+    unsigned int start;
+    do 
+    {
+        start = rcu_read_begin(&table->generation);
+        found = INTERN_NONE;
+        unsigned int bits = RCU_READ(&table->bits);
+        const InternSlot *slots = RCU_READ(&table->slots);
+        if (!slots) return INTERN_NONE;
+
+        size_t mask = ((size_t)1 << bits) - 1;
+        uint32_t ref;
+        for (size_t i = hash & mask; (ref = RCU_READ(&slots[i].ref)) != 0; i = (i + 1) & mask) 
+        {
+            if (slots[i].hash == hash && strcmp(intern_string(table, ref - 1), text) == 0) 
+            {
+                found = ref - 1;
+                break;
+            }
+        }
+    } while (rcu_read_retry(&table->generation, start));
+    return found;
+}
+
+/**
+ * @brief Busca el identificador de una cadena sin agregarla.
+ * 
+ * @param table Tabla de internación.
+ * @param text Cadena.
+ * @return Identificador, o INTERN_NONE.
+ */
+uint32_t intern_find(const InternTable *table, const char *text)
+{
+    return find_hashed(table, text, intern_hash_string(text));
+}
+
+/**
+ * @brief Coloca un identificador en la tabla hash (sin comprobar duplicados).
+ * 
+ * La referencia se publica al final, después del hash y de los datos de la cadena.
+ * 
+ * @param slots Tabla con capacidad disponible.
+ * @param bits Logaritmo de la capacidad.
+ * @param hash Hash de la cadena.
+ * @param id Identificador.
+ */
+static void slot_put(InternSlot *slots, unsigned int bits, uint32_t hash, uint32_t id)
+{
+    size_t mask = ((size_t)1 << bits) - 1;
+    size_t i = hash & mask;
+    while (slots[i].ref != 0) i = (i + 1) & mask;
+    slots[i].hash = hash;
+    RCU_PUBLISH(&slots[i].ref, id + 1);
+}
+
+/**
+ * @brief Reconstruye la tabla hash en memoria propia con 2^bits posiciones.
+ * 
+ * Sirve para crecer y para copiar una tabla mapeada antes de modificarla. La tabla
+ * anterior se retira en vez de liberarse.
+ * 
+ * @param table Tabla de internación.
+ * @param bits Logaritmo de la nueva capacidad.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+static int slots_rebuild(InternTable *table, unsigned int bits)
+{
+    InternSlot *slots = (InternSlot *)calloc((size_t)1 << bits, sizeof(InternSlot));
+    if (!slots) 
+    {
+        perror("Error al asignar memoria para la tabla de cadenas");
+        return -1;
+    }
+
+    InternSlot *old = table->slots;
+    size_t old_capacity = old ? (size_t)1 << table->bits : 0;
+    for (size_t i = 0; i < old_capacity; i++) 
+    {
+        if (old[i].ref != 0) slot_put(slots, bits, old[i].hash, old[i].ref - 1);
+    }
+
+    rcu_write_begin(&table->generation);
+    RCU_PUBLISH(&table->slots, slots);
+    RCU_PUBLISH(&table->bits, bits);
+    rcu_write_end(&table->generation);
+    if (!table->mapped) rcu_retire(&table->retired, old);
+    table->mapped = 0;
+    return 0;
+}
+
+/**
+ * @brief Deja lugar en la tabla hash para una cadena más.
+ * 
+ * Crece la tabla si quedaría más llena que la mitad y copia a memoria propia una tabla
+ * mapeada antes de modificarla.
+ * 
+ * @param table Tabla de internación.
+ * @param count Cadenas que ya están en la tabla hash.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+static int slots_reserve(InternTable *table, uint32_t count)
+{
+    if (!table->slots || ((size_t)count + 1) * 2 > ((size_t)1 << table->bits)) 
+    {
+        return slots_rebuild(table, table->slots ? table->bits + 1 : 10);
+    }
+    return table->mapped ? slots_rebuild(table, table->bits) : 0;
+}
+
+/**
+ * @brief Obtiene el identificador de una cadena, internándola si es nueva.
+ * 
+ * @param table Tabla de internación.
+ * @param text Cadena.
+ * @param id Identificador resultante.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+int intern_add(InternTable *table, const char *text, uint32_t *id)
+{
+    uint32_t hash = intern_hash_string(text);
+    uint32_t found = find_hashed(table, text, hash);
+    if (found != INTERN_NONE) 
+    {
+        *id = found;
+        return 0;
+    }
+
+    uint32_t count = intern_count(table);
+    if (count >= INTERN_NONE - 1) 
+    {
+        output_error("Error: La tabla de cadenas está llena.\n");
+        return -1;
+    }
+    if (slots_reserve(table, count) != 0) return -1;
+
+    size_t offset;
+    if (segment_append(table->pool, text, strlen(text) + 1, &offset) != 0) return -1;
+    if (offset > UINT32_MAX) 
+    {
+        output_error("Error: El pool de cadenas está lleno.\n");
+        return -1;
+    }
+
+    InternEntry entry = { (uint32_t)offset, hash };
+    if (segment_append(table->entries, &entry, sizeof(entry), NULL) != 0) return -1;
+
+    slot_put(table->slots, table->bits, hash, count);
+    *id = count;
+    return 0;
+}
+
+/**
+ * @brief Usa una tabla hash mapeada desde disco.
+ * 
+ * @param table Tabla de internación.
+ * @param slots Posiciones mapeadas.
+ * @param bits Logaritmo de la capacidad.
+ */
+void intern_attach(InternTable *table, const InternSlot *slots, unsigned int bits)
+{
+    table->bits = bits;
+    table->mapped = 1;
+    RCU_PUBLISH(&table->slots, (InternSlot *)slots);
+}
+
+/**
+ * @brief Comprueba que una tabla cargada desde disco es coherente.
+ * 
+ * El pool debe terminar en '\0' para que ninguna cadena se lea más allá de él, y la
+ * tabla hash necesita una posición libre para que las búsquedas terminen.
+ * 
+ * @param table Tabla de internación.
+ * @return 1 si la tabla es válida, 0 si no.
+ */
+int intern_valid(const InternTable *table)
+{
+    uint32_t count = intern_count(table);
+    size_t pool_size = segment_size(table->pool);
+    if (segment_size(table->entries) % sizeof(InternEntry) != 0) return 0;
+    if (count > 0 && (pool_size == 0 || *(const char *)segment_at(table->pool, pool_size - 1) != '\0')) return 0;
+    for (uint32_t id = 0; id < count; id++) 
+    {
+        if (entry_at(table, id)->offset >= pool_size) return 0;
+    }
+
+    if (!table->slots) return 1;
+    size_t free_slots = 0;
+    for (size_t i = 0; i < (size_t)1 << table->bits; i++) 
+    {
+        if (table->slots[i].ref > count) return 0;
+        if (table->slots[i].ref == 0) free_slots++;
+    }
+    return free_slots > 0;
+}
+
+/**
+ * @brief Agrega a la tabla hash las cadenas que el archivo guardó sin indexar.
+ * 
+ * @param table Tabla de internación.
+ * @param first Primer identificador que falta en la tabla hash.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+int intern_reindex(InternTable *table, uint32_t first)
+{
+    uint32_t count = intern_count(table);
+    for (uint32_t id = first; id < count; id++) 
+    {
+        if (slots_reserve(table, id) != 0) return -1;
+        slot_put(table->slots, table->bits, intern_hash(table, id), id);
+    }
+    return 0;
+}
+
+/**
+ * @brief Libera la tabla hash y las tablas retiradas.
+ * 
+ * @param table Tabla de internación.
+ */
+void intern_free(InternTable *table)
+{
+    if (!table->mapped) free(table->slots);
+    rcu_reclaim(&table->retired);
+    table->slots = NULL;
+    table->bits = 0;
+    table->mapped = 0;
+}
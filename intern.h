@@ -0,0 +1,146 @@
+/**
+ * @file intern.h
+ * @brief Tabla de internación de cadenas (nombres de archivo y mensajes).
+ * 
+ * Cada cadena distinta se guarda una sola vez en el pool y recibe un identificador
+ * de 32 bits. El área de preparación, los árboles y los commits usan ese identificador,
+ * así comparar dos nombres es comparar dos enteros. La tabla no usa punteros, por lo
+ * que se guarda en disco y se usa mapeada igual que las demás tablas.
+ * 
+ * intern_find() e intern_string() pueden correr en paralelo con un intern_add(); la
+ * publicación sigue las reglas de rcu.h.
+ * 
+ * @authors
+ * - Benjamin Sanhueza (bsanhuez@umag.cl)
+ * - Nicolas Mancilla (nicmanci@umag.cl)
+ */
+
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "store.h"
+
+#define INTERN_NONE UINT32_MAX ///< Identificador que indica "cadena no internada".
+
+/**
+ * @brief Datos de una cadena internada, indexados por su identificador.
+ */
+typedef struct InternEntry 
+{
+    uint32_t offset; ///< Desplazamiento de la cadena en el pool.
+    uint32_t hash; ///< Hash FNV-1a de la cadena.
+} InternEntry;
+
+/**
+ * @brief Posición de la tabla hash de búsqueda por contenido.
+ */
+typedef struct InternSlot 
+{
+    uint32_t hash; ///< Hash de la cadena.
+    uint32_t ref; ///< Identificador + 1, o 0 si la posición está libre.
+} InternSlot;
+
+/**
+ * @brief Tabla de internación.
+ */
+typedef struct InternTable 
+{
+    Segment *pool; ///< Texto de las cadenas, terminadas en '\0'.
+    Segment *entries; ///< InternEntry por identificador.
+    InternSlot *slots; ///< Tabla de direccionamiento abierto de hash a identificador.
+    unsigned int bits; ///< Logaritmo de la capacidad de @c slots.
+    int mapped; ///< 1 si @c slots apunta a memoria mapeada de solo lectura.
+    unsigned int generation; ///< Contador de reemplazos de @c slots (impar durante uno).
+    RetireList retired; ///< Tablas hash reemplazadas, liberadas en intern_free().
+} InternTable;
+
+/**
+ * @brief Calcula el hash FNV-1a de una cadena.
+ * 
+ * @param text Cadena.
+ * @return Hash de 32 bits.
+ */
+uint32_t intern_hash_string(const char *text);
+
+/**
+ * @brief Cantidad de cadenas internadas.
+ * 
+ * @param table Tabla de internación.
+ * @return Cantidad de identificadores asignados.
+ */
+uint32_t intern_count(const InternTable *table);
+
+/**
+ * @brief Busca el identificador de una cadena sin agregarla.
+ * 
+ * @param table Tabla de internación.
+ * @param text Cadena buscada.
+ * @return Su identificador, o INTERN_NONE si no está internada.
+ */
+uint32_t intern_find(const InternTable *table, const char *text);
+
+/**
+ * @brief Obtiene el identificador de una cadena, internándola si es nueva.
+ * 
+ * @param table Tabla de internación.
+ * @param text Cadena.
+ * @param id Identificador resultante.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+int intern_add(InternTable *table, const char *text, uint32_t *id);
+
+/**
+ * @brief Obtiene el texto de una cadena internada.
+ * 
+ * @param table Tabla de internación.
+ * @param id Identificador.
+ * @return La cadena.
+ */
+const char *intern_string(const InternTable *table, uint32_t id);
+
+/**
+ * @brief Obtiene el hash de una cadena internada.
+ * 
+ * @param table Tabla de internación.
+ * @param id Identificador.
+ * @return Hash FNV-1a de la cadena.
+ */
+uint32_t intern_hash(const InternTable *table, uint32_t id);
+
+/**
+ * @brief Usa una tabla hash mapeada desde disco.
+ * 
+ * @param table Tabla con @c pool y @c entries ya cargados.
+ * @param slots Posiciones mapeadas (2^bits elementos).
+ * @param bits Logaritmo de la capacidad.
+ */
+void intern_attach(InternTable *table, const InternSlot *slots, unsigned int bits);
+
+/**
+ * @brief Comprueba que una tabla cargada desde disco es coherente.
+ * 
+ * @param table Tabla con @c pool, @c entries y @c slots ya cargados.
+ * @return 1 si cada cadena empieza dentro del pool y la tabla hash solo tiene
+ *         identificadores asignados y alguna posición libre, 0 si no.
+ */
+int intern_valid(const InternTable *table);
+
+/**
+ * @brief Agrega a la tabla hash las cadenas que el archivo guardó sin indexar.
+ * 
+ * @param table Tabla ya validada con intern_valid().
+ * @param first Primer identificador que falta en la tabla hash; los siguientes también faltan.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+int intern_reindex(InternTable *table, uint32_t first);
+
+/**
+ * @brief Libera la tabla hash (los segmentos se liberan aparte).
+ * 
+ * @param table Tabla de internación.
+ */
+void intern_free(InternTable *table);
+
+#endif
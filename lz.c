@@ -0,0 +1,290 @@
+/**
+ * @file lz.c
+ * @brief Implementación del compresor y el descompresor de bloques LZ.
+ * 
+ * @authors
+ * Benjamin Sanhueza (bsanhuez@umag.cl)
+ * Nicolas Mancilla (nicmanci@umag.cl)
+ */
+
+#include <string.h>
+#include "lz.h"
+
+#define LZ_HASH_BITS 12 ///< Bits de la tabla hash de posiciones (4096 entradas).
+#define LZ_LAST_LITERALS 5 ///< Bytes finales que siempre van como literales.
+#define LZ_MATCH_LIMIT 12 ///< Una copia no empieza en los últimos bytes de la entrada.
+#define LZ_SKIP_SHIFT 6 ///< Cada 2^LZ_SKIP_SHIFT búsquedas fallidas seguidas el avance crece en uno.
+#define LZ_RUN_MASK 15 ///< Valor del nibble que indica que el largo sigue en bytes adicionales.
+#define LZ_WILD_COPY 16 ///< Bytes que se copian de una vez cuando sobra espacio después del destino.
+
+/**
+ * @brief Lee cuatro bytes sin exigir alineamiento.
+ * 
+ * @param p Posición.
+ * @return Los bytes como entero.
+ */
+static inline uint32_t read32(const uint8_t *p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+/**
+ * @brief Posición en la tabla hash de los cuatro bytes de una posición.
+ * 
+ * @param sequence Cuatro bytes leídos con read32().
+ * @return Índice en la tabla.
+ */
+static inline uint32_t lz_hash(uint32_t sequence)
+{
+    return (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/**
+ * @brief Cuenta los bytes iguales a partir de dos posiciones.
+ * 
+ * @param a Primera posición.
+ * @param b Segunda posición (anterior a @p a).
+ * @param end Límite de @p a.
+ * @return Cantidad de bytes iguales.
+ */
+static size_t match_length(const uint8_t *a, const uint8_t *b, const uint8_t *end)
+{
+    const uint8_t *start = a;
+    while (a + sizeof(uint64_t) <= end)
+    {
+        uint64_t x, y;
+        memcpy(&x, a, sizeof(x));
+        memcpy(&y, b, sizeof(y));
+        if (x != y)
+        {
+#if defined(__GNUC__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            return (size_t)(a - start) + (size_t)(__builtin_ctzll(x ^ y) >> 3);
+#else
+            break;
+#endif
+        }
+        a += sizeof(uint64_t);
+        b += sizeof(uint64_t);
+    }
+    while (a < end && *a == *b)
+    {
+        a++;
+        b++;
+    }
+    return (size_t)(a - start);
+}
+
+/**
+ * @brief Escribe el resto de un largo como bytes adicionales (255 mientras sobre).
+ * 
+ * @param out Destino.
+ * @param len Largo que excede LZ_RUN_MASK.
+ * @return Posición siguiente del destino.
+ */
+static uint8_t *put_length(uint8_t *out, size_t len)
+{
+    while (len >= 255)
+    {
+        *out++ = 255;
+        len -= 255;
+    }
+    *out++ = (uint8_t)len;
+    return out;
+}
+
+/**
+ * @brief Escribe un par de literales y copia.
+ * 
+ * @param out Posición del destino.
+ * @param end Fin del destino.
+ * @param literals Literales.
+ * @param literal_len Cantidad de literales.
+ * @param distance Distancia de la copia (0 en el último par, que no tiene copia).
+ * @param match_len Largo de la copia (se ignora en el último par).
+ * @return Posición siguiente del destino, o NULL si no cabe.
+ */
+static uint8_t *put_sequence(uint8_t *out, const uint8_t *end, const uint8_t *literals, size_t literal_len,
+                             size_t distance, size_t match_len)
+{
+    size_t code = distance > 0 ? match_len - LZ_MIN_MATCH : 0;
+    size_t need = 1 + literal_len + literal_len / 255 + 1 + (distance > 0 ? 2 + code / 255 + 1 : 0);
+    if (need > (size_t)(end - out)) return NULL;
+
+    uint8_t *token = out++;
+    *token = (uint8_t)((literal_len < LZ_RUN_MASK ? literal_len : LZ_RUN_MASK) << 4);
+    if (literal_len >= LZ_RUN_MASK) out = put_length(out, literal_len - LZ_RUN_MASK);
+    memcpy(out, literals, literal_len);
+    out += literal_len;
+    if (distance == 0) return out;
+
+    *out++ = (uint8_t)(distance & 0xFF);
+    *out++ = (uint8_t)(distance >> 8);
+    *token |= (uint8_t)(code < LZ_RUN_MASK ? code : LZ_RUN_MASK);
+    if (code >= LZ_RUN_MASK) out = put_length(out, code - LZ_RUN_MASK);
+    return out;
+}
+
+/**
+ * @brief Largo máximo del bloque comprimido de una entrada que no se comprime.
+ * 
+ * @param size Largo de la entrada.
+ * @return Capacidad que siempre alcanza para lz_compress().
+ */
+size_t lz_bound(size_t size)
+{
+    return size + size / 255 + 16;
+}
+
+/**
+ * @brief Comprime una entrada en un bloque.
+ * 
+ * Cada posición se busca en la tabla hash por sus cuatro primeros bytes; si la
+ * posición anterior con el mismo hash está dentro de LZ_MAX_DISTANCE y coincide, la
+ * copia se extiende hacia atrás sobre los literales pendientes y hacia adelante hasta
+ * LZ_LAST_LITERALS bytes del final. Sin coincidencias, el avance crece con la cantidad
+ * de búsquedas fallidas desde la última copia.
+ * 
+ * @param src Entrada.
+ * @param size Largo de la entrada.
+ * @param dst Destino de @p capacity bytes.
+ * @param capacity Largo máximo aceptable del bloque.
+ * @return Largo del bloque, o 0 si no cabe en @p capacity.
+ */
+size_t lz_compress(const uint8_t *src, size_t size, uint8_t *dst, size_t capacity)
+{
+    uint32_t table[1u << LZ_HASH_BITS];
+    memset(table, 0, sizeof(table));
+
+    const uint8_t *end = dst + capacity;
+    uint8_t *out = dst;
+    const uint8_t *anchor = src;
+    if (size > LZ_MATCH_LIMIT)
+    {
+        const uint8_t *ip = src + 1;
+        const uint8_t *limit = src + size - LZ_MATCH_LIMIT;
+        const uint8_t *match_end = src + size - LZ_LAST_LITERALS;
+        size_t misses = 0;
+        while (ip < limit)
+        {
+            uint32_t sequence = read32(ip);
+            uint32_t slot = lz_hash(sequence);
+            const uint8_t *ref = src + table[slot];
+            table[slot] = (uint32_t)(ip - src);
+            if (ref >= ip || (size_t)(ip - ref) > LZ_MAX_DISTANCE || read32(ref) != sequence)
+            {
+                ip += 1 + (misses++ >> LZ_SKIP_SHIFT);
+                continue;
+            }
+
+            while (ip > anchor && ref > src && ip[-1] == ref[-1])
+            {
+                ip--;
+                ref--;
+            }
+            size_t len = LZ_MIN_MATCH + match_length(ip + LZ_MIN_MATCH, ref + LZ_MIN_MATCH, match_end);
+            out = put_sequence(out, end, anchor, (size_t)(ip - anchor), (size_t)(ip - ref), len);
+            if (!out) return 0;
+
+            ip += len;
+            anchor = ip;
+            misses = 0;
+            if (ip < limit) table[lz_hash(read32(ip - 2))] = (uint32_t)(ip - 2 - src);
+        }
+    }
+    out = put_sequence(out, end, anchor, (size_t)(src + size - anchor), 0, 0);
+    return out ? (size_t)(out - dst) : 0;
+}
+
+/**
+ * @brief Lee los bytes adicionales de un largo.
+ * 
+ * @param src Bloque.
+ * @param size Largo del bloque.
+ * @param pos Posición de lectura, que avanza.
+ * @param len Largo al que se suman los bytes.
+ * @param max Valor a partir del cual el largo ya es inválido.
+ * @return 0 en caso de éxito, -1 si el bloque se acaba o el largo supera @p max.
+ */
+static int get_length(const uint8_t *src, size_t size, size_t *pos, size_t *len, size_t max)
+{
+    uint8_t byte;
+    do
+    {
+        if (*pos >= size || *len > max) return -1;
+        byte = src[(*pos)++];
+        *len += byte;
+    } while (byte == 255);
+    return 0;
+}
+
+/**
+ * @brief Descomprime un bloque, comprobando que no se lea ni escriba fuera de los límites.
+ * 
+ * Una copia puede solaparse con lo que ella misma escribe (distancia menor que su
+ * largo), lo que repite un patrón; en ese caso se copia por tramos que no se solapan,
+ * cada uno del doble del anterior. Lejos del final del bloque y del destino, los
+ * literales cortos y las copias sin solapamiento se copian en tramos de largo fijo que
+ * pueden pasarse del final; lo que sobra lo sobrescribe el par siguiente.
+ * 
+ * @param src Bloque creado con lz_compress().
+ * @param size Largo del bloque.
+ * @param dst Destino de @p dst_size bytes.
+ * @param dst_size Largo exacto del resultado.
+ * @return 0 en caso de éxito, -1 si el bloque está dañado o no da @p dst_size bytes.
+ */
+int lz_decompress(const uint8_t *src, size_t size, uint8_t *dst, size_t dst_size)
+{
+    size_t ip = 0;
+    size_t op = 0;
+    for (;;)
+    {
+        if (ip >= size) return -1;
+        uint8_t token = src[ip++];
+
+        size_t literal_len = token >> 4;
+        if (literal_len == LZ_RUN_MASK && get_length(src, size, &ip, &literal_len, dst_size) != 0) return -1;
+        if (literal_len > size - ip || literal_len > dst_size - op) return -1;
+        if (literal_len <= LZ_WILD_COPY && size - ip >= LZ_WILD_COPY && dst_size - op >= LZ_WILD_COPY)
+        {
+            memcpy(dst + op, src + ip, LZ_WILD_COPY);
+        }
+        else memcpy(dst + op, src + ip, literal_len);
+        ip += literal_len;
+        op += literal_len;
+        if (ip == size) return op == dst_size ? 0 : -1;
+
+        if (size - ip < 2) return -1;
+        size_t distance = (size_t)src[ip] | (size_t)src[ip + 1] << 8;
+        ip += 2;
+        if (distance == 0 || distance > op) return -1;
+
+        size_t len = token & LZ_RUN_MASK;
+        if (len == LZ_RUN_MASK && get_length(src, size, &ip, &len, dst_size) != 0) return -1;
+        len += LZ_MIN_MATCH;
+        if (len > dst_size - op) return -1;
+
+        uint8_t *out = dst + op;
+        const uint8_t *ref = out - distance;
+        op += len;
+        if (distance >= sizeof(uint64_t) && dst_size - op >= sizeof(uint64_t))
+        {
+            const uint8_t *end = out + len;
+            do
+            {
+                memcpy(out, ref, sizeof(uint64_t));
+                out += sizeof(uint64_t);
+                ref += sizeof(uint64_t);
+            } while (out < end);
+            continue;
+        }
+        while (len > 0)
+        {
+            size_t chunk = len < (size_t)(out - ref) ? len : (size_t)(out - ref);
+            memcpy(out, ref, chunk);
+            out += chunk;
+            len -= chunk;
+        }
+    }
+}
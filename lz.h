@@ -0,0 +1,61 @@
+/**
+ * @file lz.h
+ * @brief Compresión rápida por bloques de la familia LZ77, sin dependencias.
+ * 
+ * El formato es el de los bloques de LZ4: una secuencia de pares (literales, copia).
+ * Cada par empieza con un byte cuyos cuatro bits altos son la cantidad de literales y
+ * los cuatro bajos el largo de la copia menos LZ_MIN_MATCH; el valor 15 indica que el
+ * largo sigue en bytes adicionales (se suman mientras valgan 255). Después van los
+ * literales, la distancia hacia atrás de la copia en dos bytes (little-endian) y los
+ * bytes adicionales del largo de la copia. El último par solo tiene literales.
+ * 
+ * El compresor busca coincidencias de cuatro bytes con una tabla hash de posiciones y
+ * avanza cada vez más rápido mientras no encuentra ninguna, así que los datos que no
+ * se comprimen se recorren casi sin costo. El largo del resultado no va en el bloque:
+ * quien lo guarda debe conocerlo para descomprimir.
+ * 
+ * @authors
+ * - Benjamin Sanhueza (bsanhuez@umag.cl)
+ * - Nicolas Mancilla (nicmanci@umag.cl)
+ */
+
+#ifndef LZ_H
+#define LZ_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define LZ_MIN_MATCH 4 ///< Largo mínimo de una copia.
+#define LZ_MAX_DISTANCE 65535 ///< Distancia máxima hacia atrás de una copia.
+
+/**
+ * @brief Largo máximo del bloque comprimido de una entrada que no se comprime.
+ * 
+ * @param size Largo de la entrada.
+ * @return Capacidad que siempre alcanza para lz_compress().
+ */
+size_t lz_bound(size_t size);
+
+/**
+ * @brief Comprime una entrada en un bloque.
+ * 
+ * @param src Entrada.
+ * @param size Largo de la entrada.
+ * @param dst Destino de @p capacity bytes.
+ * @param capacity Largo máximo aceptable del bloque.
+ * @return Largo del bloque, o 0 si no cabe en @p capacity.
+ */
+size_t lz_compress(const uint8_t *src, size_t size, uint8_t *dst, size_t capacity);
+
+/**
+ * @brief Descomprime un bloque, comprobando que no se lea ni escriba fuera de los límites.
+ * 
+ * @param src Bloque creado con lz_compress().
+ * @param size Largo del bloque.
+ * @param dst Destino de @p dst_size bytes.
+ * @param dst_size Largo exacto del resultado.
+ * @return 0 en caso de éxito, -1 si el bloque está dañado o no da @p dst_size bytes.
+ */
+int lz_decompress(const uint8_t *src, size_t size, uint8_t *dst, size_t dst_size);
+
+#endif
@@ -3,7 +3,10 @@
  * @brief Implementación principal del sistema de control de versiones uGit.
  * 
  * Este archivo contiene la lógica principal de interacción con el usuario para el sistema de control de versiones uGit.
- * Permite ejecutar comandos como `init`, `add`, `rm`, `commit`, `log`, `checkout`, `ls` y `exit` a través de un prompt interactivo.
+ * Permite ejecutar comandos como `init`, `add`, `rm`, `commit`, `log`, `checkout`, `ls`, `status`, `watch`, `repack`, `branch`, `merge` y `exit` a través de un prompt interactivo.
+ * Con `-f script`, o cuando la entrada no es una terminal, los comandos se leen en modo por lotes:
+ * sin prompt ni mensajes de bienvenida y vaciando la salida una sola vez al final.
+ * `--quiet` muestra solo los errores y `--json` escribe un objeto JSON por línea (ver output.h).
  * 
  * @authors
  * - Benjamin Sanhueza (bsanhuez@umag.cl)
@@ -12,115 +15,128 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
 #include "git.h"
+#include "command.h"
+#include "output.h"
+
+/**
+ * @brief Lee una línea de comando completa.
+ * 
+ * Si la línea no cabe en @p command se descarta entera, hasta el salto de línea, para
+ * que su resto no se ejecute como si fuera otro comando.
+ * 
+ * @param input Entrada de comandos.
+ * @param command Destino, sin el salto de línea.
+ * @param size Capacidad de @p command.
+ * @return 1 si se leyó una línea, 0 al final de la entrada, -1 si la línea era demasiado larga.
+ */
+static int read_command(FILE *input, char *command, size_t size)
+{
+    if (fgets(command, (int)size, input) == NULL) return 0;
+
+    size_t len = strcspn(command, "\n");
+    int c = command[len] == '\n' ? '\n' : fgetc(input);
+    command[len] = '\0';
+    if (c == '\n' || c == EOF) return 1;
+
+    while ((c = fgetc(input)) != EOF && c != '\n') continue;
+    return -1;
+}
 
 /**
  * @brief Función principal que ejecuta el sistema uGit.
  * 
  * Esta función inicializa el prompt interactivo que permite a los usuarios ejecutar
- * los comandos de uGit para administrar un repositorio simulado.
+ * los comandos de uGit para administrar un repositorio simulado. Si recibe
+ * `-f script` lee los comandos de ese archivo; si la entrada no es una terminal
+ * (por ejemplo, una tubería) también pasa al modo por lotes. `--quiet` y `--json`
+ * eligen el modo de salida.
  * 
- * @return 0 si el programa finaliza correctamente.
+ * @param argc Cantidad de argumentos.
+ * @param argv Argumentos de la línea de comandos.
+ * @return 0 si el programa finaliza correctamente, 1 si hubo un error de uso o al guardar.
  */
-int main() {
+int main(int argc, char *argv[]) {
     char command[MAX_COMMAND_LENGTH]; ///< Almacena el comando introducido por el usuario.
-    char *result;
-
-    printf("Bienvenido a uGit\n");
+    const char *script = NULL;
+    FILE *input = stdin;
 
-    while (1) // Bucle infinito para el prompt de la consola
+    for (int i = 1; i < argc; i++) 
     {
-        printf("ugit> "); // Prompt para el usuario
-        
-        result = fgets(command, MAX_COMMAND_LENGTH, stdin); // Leer el comando y verificar si se ha leído correctamente
-        if (result == NULL) 
+        if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) 
         {
-            printf("Error al leer el comando.\n"); // Warning del inicio del programa
-            continue;
+            script = argv[++i];
         }
-
-        command[strcspn(command, "\n")] = 0; // Remover el salto de línea al final de la entrada
-
-        char *token = strtok(command, " "); // Parsear el comando y argumentos
-        if (token == NULL) continue;
-
-        if (strcmp(token, "init") == 0) // Inicializa desde el prompt
-        {
-            if (init_repo() == 0) 
-            {
-                printf("Repositorio inicializado correctamente.\n");
-            } 
-            else
-            {
-                printf("Error al inicializar el repositorio.\n"); // Warning de la inicialización
-            }
-        } 
-        else if (strcmp(token, "add") == 0) // Añade archivo desde el prompt
-        {
-            char *filename = strtok(NULL, " ");
-            if (filename != NULL) 
-            {
-                add_file(filename);
-            } 
-            else
-            {
-                printf("Error: nombre del archivo no proporcionado.\n"); // Warning de creación de archivos
-            }
-        } 
-        else if (strcmp(token, "rm") == 0) // Borra archivo desde el prompt
+        else if (strcmp(argv[i], "-q") == 0 || strcmp(argv[i], "--quiet") == 0) 
         {
-            char *filename = strtok(NULL, " ");
-            if (filename != NULL) 
-            {
-                remove_file(filename);
-            } 
-            else 
-            {
-                printf("Error: nombre del archivo no proporcionado.\n"); // Warning del remove de archivos
-            }
-        } 
-        else if (strcmp(token, "commit") == 0) // Genera un commit desde el prompt
+            output_set_mode(OUTPUT_QUIET);
+        }
+        else if (strcmp(argv[i], "--json") == 0) 
         {
-            char *message = strtok(NULL, "");
-            if (message != NULL) 
-            {
-                commit(message);
-            } 
-            else 
-            {
-                printf("Error: mensaje de commit no proporcionado.\n"); // Warning de los commits
-            }
-        } 
-        else if (strcmp(token, "log") == 0) // Genera el historial desde el prompt
+            output_set_mode(OUTPUT_JSON);
+        }
+        else 
         {
-            log_commits();
-        } 
-        else if (strcmp(token, "checkout") == 0) // Cambia las versiones desde el prompt
+            fprintf(stderr, "Uso: %s [-f script] [--quiet | --json]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (script != NULL) 
+    {
+        input = fopen(script, "r");
+        if (!input) 
         {
-            char *commit_id = strtok(NULL, " ");
-            if (commit_id != NULL) 
-            {
-                checkout_commit(commit_id);
-            } 
-            else 
-            {
-                printf("Error: ID del commit no proporcionado.\n"); // Warning de las versiones
-            }
-        } 
-        else if (strcmp(token, "ls") == 0) // Genera una lista de archivos de la versión desde el prompt
+            perror("Error al abrir el script");
+            return 1;
+        }
+    }
+
+    int interactive = script == NULL && isatty(fileno(stdin)); // Prompt solo al escribir en una terminal
+    if (interactive) output_text("Bienvenido a uGit\n");
+
+    ugit_repo *repo = repo_create(REPO_DIR);
+    if (!repo) return 1;
+
+    int loaded = open_repo(repo);
+    if (loaded > 0 && interactive) 
+    {
+        output_text("Repositorio cargado desde {path:s}.\n", REPO_FILE);
+    }
+
+    while (1) // Bucle infinito para el prompt de la consola
+    {
+        if (interactive) 
         {
-            list_files();
-        } 
-        else if (strcmp(token, "exit") == 0) // Finaliza el programa desde el prompt
+            output_text("ugit> "); // Prompt para el usuario
+            output_flush(); // En modo por lotes la salida se vacía solo al llenarse el búfer y al final
+        }
+        
+        int read = read_command(input, command, sizeof(command)); // Leer la línea completa, sin el salto de línea
+        if (read == 0) // Fin de la entrada: se sale guardando el repositorio
         {
-            printf("Saliendo de uGit.\n");
+            if (interactive) output_text("\n");
             break;
-        } 
-        else 
+        }
+        if (read < 0) // Una línea truncada podría ejecutar su resto como otro comando
         {
-            printf("Comando no reconocido: %s\n", command); // Warning en caso de comando no reconocido
+            output_error("Error: La línea supera los {max:z} caracteres y no se ejecutó.\n", (size_t)MAX_COMMAND_LENGTH - 1);
+            continue;
         }
+
+        if (command_execute(repo, command) == COMMAND_EXIT) break; // Buscar el comando en la tabla y ejecutarlo
     }
 
-    return 0;
+    if (input != stdin) fclose(input);
+
+    int status = 0;
+    if (close_repo(repo) != 0) 
+    {
+        output_error("Error al guardar el repositorio.\n");
+        status = 1;
+    }
+    repo_destroy(repo);
+    output_flush();
+    return status;
 }
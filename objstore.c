@@ -0,0 +1,335 @@
+/**
+ * @file objstore.c
+ * @brief Implementación del almacén de objetos direccionado por contenido.
+ * 
+ * @authors
+ * Benjamin Sanhueza (bsanhuez@umag.cl)
+ * Nicolas Mancilla (nicmanci@umag.cl)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "objstore.h"
+
+/**
+ * @brief Obtiene los 32 bits más significativos de un identificador.
+ * 
+ * @param id Identificador.
+ * @return Primeros cuatro bytes del hash como entero big-endian.
+ */
+static unsigned int id_top32(const object_id *id)
+{
+    return (unsigned int)id->hash[0] << 24 | (unsigned int)id->hash[1] << 16 |
+           (unsigned int)id->hash[2] << 8 | (unsigned int)id->hash[3];
+}
+
+/**
+ * @brief Posición inicial de un identificador en una tabla de 2^bits entradas.
+ * 
+ * @param top Primeros 32 bits del identificador.
+ * @param bits Logaritmo de la capacidad.
+ * @return Índice de la posición inicial.
+ */
+static size_t home_slot(unsigned int top, unsigned int bits)
+{
+    return bits == 0 ? 0 : (size_t)(top >> (32 - bits));
+}
+
+/**
+ * @brief Calcula el identificador de un objeto a partir de su contenido.
+ * 
+ * @param type Tipo del objeto.
+ * @param data Contenido serializado.
+ * @param len Largo del contenido.
+ * @param id Identificador resultante.
+ */
+void object_hash(const char *type, const void *data, size_t len, object_id *id)
+{
+    char header[32];
+    int header_len = snprintf(header, sizeof(header), "%s %zu", type, len);
+
+    SHA1Context ctx;
+    sha1_init(&ctx);
+    sha1_update(&ctx, header, (size_t)header_len + 1);
+    sha1_update(&ctx, data, len);
+    sha1_final(&ctx, id->hash);
+}
+
+/**
+ * @brief Convierte un identificador a texto hexadecimal.
+ * 
+ * @param id Identificador.
+ * @param hex Destino de OBJECT_HEX_LENGTH + 1 caracteres.
+ */
+void object_id_to_hex(const object_id *id, char *hex)
+{
+    static const char digits[] = "0123456789abcdef";
+    for (int i = 0; i < SHA1_DIGEST_SIZE; i++) 
+    {
+        hex[i * 2] = digits[id->hash[i] >> 4];
+        hex[i * 2 + 1] = digits[id->hash[i] & 0xF];
+    }
+    hex[OBJECT_HEX_LENGTH] = '\0';
+}
+
+/**
+ * @brief Coloca una entrada en la primera posición libre desde su posición inicial.
+ * 
+ * La referencia se publica después del identificador, así un lector que ve la entrada
+ * ocupada también ve su identificador completo.
+ * 
+ * @param entries Arreglo con capacidad disponible.
+ * @param bits Logaritmo de la capacidad del arreglo.
+ * @param id Identificador.
+ * @param ref Referencia asociada.
+ */
+static void table_put(ObjectEntry *entries, unsigned int bits, const object_id *id, uint32_t ref)
+{
+    size_t mask = ((size_t)1 << bits) - 1;
+    size_t i = home_slot(id_top32(id), bits);
+    while (entries[i].ref != 0) 
+    {
+        i = (i + 1) & mask;
+    }
+    entries[i].id = *id;
+    RCU_PUBLISH(&entries[i].ref, ref);
+}
+
+/**
+ * @brief Reemplaza el arreglo de entradas por uno propio de 2^bits posiciones.
+ * 
+ * Sirve tanto para crecer como para copiar una tabla mapeada antes de modificarla.
+ * El arreglo nuevo se llena antes de publicarlo y el anterior se retira, porque un
+ * lector puede seguir recorriéndolo.
+ * 
+ * @param table Tabla de objetos.
+ * @param bits Logaritmo de la nueva capacidad.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+static int table_rebuild(ObjectTable *table, unsigned int bits)
+{
+    ObjectEntry *entries = (ObjectEntry *)calloc((size_t)1 << bits, sizeof(ObjectEntry));
+    if (!entries) 
+    {
+        perror("Error al asignar memoria para la tabla de objetos");
+        return -1;
+    }
+
+    ObjectEntry *old = table->entries;
+    size_t old_capacity = old ? (size_t)1 << table->bits : 0;
+    for (size_t i = 0; i < old_capacity; i++) 
+    {
+        if (old[i].ref != 0) table_put(entries, bits, &old[i].id, old[i].ref);
+    }
+
+    rcu_write_begin(&table->generation);
+    RCU_PUBLISH(&table->entries, entries);
+    RCU_PUBLISH(&table->bits, bits);
+    rcu_write_end(&table->generation);
+    if (!table->mapped) rcu_retire(&table->retired, old);
+    table->mapped = 0;
+    return 0;
+}
+
+/**
+ * @brief Inserta un objeto en la tabla, manteniendo el factor de carga bajo 3/4.
+ * 
+ * @param table Tabla de objetos.
+ * @param id Identificador.
+ * @param ref Referencia asociada.
+ * @return 0 si se insertó, 1 si ya existía, -1 si no hay memoria.
+ */
+int objtable_insert(ObjectTable *table, const object_id *id, uint32_t ref)
+{
+    if (objtable_find(table, id) != 0) return 1;
+
+    if (!table->entries || (table->count + 1) * 4 > ((size_t)3 << table->bits)) 
+    {
+        if (table_rebuild(table, table->entries ? table->bits + 1 : 8) != 0) return -1;
+    }
+    else if (table->mapped) 
+    {
+        if (table_rebuild(table, table->bits) != 0) return -1;
+    }
+
+    table_put(table->entries, table->bits, id, ref);
+    table->count++;
+    return 0;
+}
+
+/**
+ * @brief Busca un objeto por su identificador completo.
+ * 
+ * Puede correr en paralelo con objtable_insert(); si la tabla cambia de arreglo
+ * durante la búsqueda, esta se repite.
+ * 
+ * @param table Tabla de objetos.
+ * @param id Identificador.
+ * @return La referencia del objeto, o 0 si no existe.
+ */
+uint32_t objtable_find(const ObjectTable *table, const object_id *id)
+{
+    uint32_t found;
+    unsigned int start;
+    do 
+    {
+        start = rcu_read_begin(&table->generation);
+        found = 0;
+        unsigned int bits = RCU_READ(&table->bits);
+        const ObjectEntry *entries = RCU_READ(&table->entries);
+        if (!entries) return 0;
+
+        size_t mask = ((size_t)1 << bits) - 1;
+        uint32_t ref;
+        for (size_t i = home_slot(id_top32(id), bits); (ref = RCU_READ(&entries[i].ref)) != 0; i = (i + 1) & mask) 
+        {
+            if (memcmp(entries[i].id.hash, id->hash, SHA1_DIGEST_SIZE) == 0) 
+            {
+                found = ref;
+                break;
+            }
+        }
+    } while (rcu_read_retry(&table->generation, start));
+    return found;
+}
+
+/**
+ * @brief Indica si un identificador comienza con un prefijo hexadecimal.
+ * 
+ * @param id Identificador.
+ * @param prefix Prefijo en minúsculas.
+ * @param len Largo del prefijo.
+ * @return 1 si coincide, 0 en caso contrario.
+ */
+static int id_has_prefix(const object_id *id, const char *prefix, size_t len)
+{
+    char hex[OBJECT_HEX_LENGTH + 1];
+    object_id_to_hex(id, hex);
+    return strncmp(hex, prefix, len) == 0;
+}
+
+/**
+ * @brief Busca un objeto por un prefijo hexadecimal de su identificador.
+ * 
+ * Como la posición inicial depende solo de los bits altos, todas las entradas que
+ * comparten el prefijo parten dentro del tramo [primera, última] de posiciones
+ * iniciales posibles; la búsqueda recorre ese tramo y continúa hasta la siguiente
+ * posición vacía, donde terminan los desplazamientos del sondeo lineal.
+ * 
+ * @param table Tabla de objetos.
+ * @param prefix Prefijo hexadecimal.
+ * @param ref Referencia encontrada si la coincidencia es única.
+ * @return 0, 1 o 2 (ambiguo) coincidencias; -1 si el prefijo no es válido.
+ */
+int objtable_find_prefix(const ObjectTable *table, const char *prefix, uint32_t *ref)
+{
+    char lower[OBJECT_HEX_LENGTH + 1];
+    size_t len = strlen(prefix);
+    if (len < OBJECT_MIN_PREFIX || len > OBJECT_HEX_LENGTH) return -1;
+
+    unsigned int top = 0;
+    for (size_t i = 0; i < len; i++) 
+    {
+        if (!isxdigit((unsigned char)prefix[i])) return -1;
+        lower[i] = (char)tolower((unsigned char)prefix[i]);
+        if (i < 8) 
+        {
+            top |= (unsigned int)(isdigit((unsigned char)lower[i]) ? lower[i] - '0' : lower[i] - 'a' + 10) << (28 - 4 * i);
+        }
+    }
+    lower[len] = '\0';
+
+    unsigned int known_bits = len >= 8 ? 32 : (unsigned int)len * 4;
+    unsigned int last_top = known_bits == 32 ? top : top | (0xFFFFFFFFu >> known_bits);
+
+    int matches;
+    unsigned int start;
+    do 
+    {
+        start = rcu_read_begin(&table->generation);
+        *ref = 0;
+        matches = 0;
+        unsigned int bits = RCU_READ(&table->bits);
+        const ObjectEntry *entries = RCU_READ(&table->entries);
+        if (!entries) return 0;
+
+        size_t capacity = (size_t)1 << bits;
+        size_t mask = capacity - 1;
+        size_t first = home_slot(top, bits);
+        size_t span = home_slot(last_top, bits) - first;
+
+        for (size_t step = 0, i = first; step < capacity && matches < 2; step++, i = (i + 1) & mask) 
+        {
+            uint32_t found = RCU_READ(&entries[i].ref);
+            if (found == 0) 
+            {
+                if (step >= span) break;
+                continue;
+            }
+            if (id_has_prefix(&entries[i].id, lower, len)) 
+            {
+                matches++;
+                *ref = found;
+            }
+        }
+    } while (rcu_read_retry(&table->generation, start));
+
+    if (matches > 1) *ref = 0;
+    return matches;
+}
+
+/**
+ * @brief Usa entradas mapeadas desde disco como contenido de la tabla.
+ * 
+ * @param table Tabla vacía.
+ * @param entries Entradas mapeadas.
+ * @param bits Logaritmo de la capacidad.
+ * @param count Cantidad de objetos.
+ */
+void objtable_attach(ObjectTable *table, const ObjectEntry *entries, unsigned int bits, size_t count)
+{
+    table->bits = bits;
+    table->count = count;
+    RCU_PUBLISH(&table->entries, (ObjectEntry *)entries);
+    table->mapped = 1;
+}
+
+/**
+ * @brief Comprueba que una tabla cargada desde disco es coherente.
+ * 
+ * Cada referencia debe apuntar a un objeto existente y debe quedar una posición
+ * libre, porque las búsquedas se detienen en ella.
+ * 
+ * @param table Tabla de objetos.
+ * @param max_ref Referencia más alta válida.
+ * @return 1 si la tabla es válida, 0 si no.
+ */
+int objtable_valid(const ObjectTable *table, uint32_t max_ref)
+{
+    if (!table->entries) return table->count == 0;
+
+    size_t used = 0;
+    for (size_t i = 0; i < (size_t)1 << table->bits; i++) 
+    {
+        if (table->entries[i].ref > max_ref) return 0;
+        if (table->entries[i].ref != 0) used++;
+    }
+    return used == table->count && used < (size_t)1 << table->bits;
+}
+
+/**
+ * @brief Libera el arreglo de entradas de la tabla y los arreglos retirados.
+ * 
+ * @param table Tabla de objetos.
+ */
+void objtable_free(ObjectTable *table)
+{
+    if (!table->mapped) free(table->entries);
+    rcu_reclaim(&table->retired);
+    table->mapped = 0;
+    table->entries = NULL;
+    table->bits = 0;
+    table->count = 0;
+}
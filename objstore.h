@@ -0,0 +1,146 @@
+/**
+ * @file objstore.h
+ * @brief Almacén de objetos direccionado por contenido.
+ * 
+ * Cada objeto (los commits y los blobs con el contenido de los archivos) se identifica
+ * por el hash SHA-1 de su contenido serializado. El almacén mantiene una tabla hash de
+ * direccionamiento abierto que va del identificador al objeto, y permite resolver
+ * abreviaciones hexadecimales únicas.
+ * 
+ * @authors
+ * - Benjamin Sanhueza (bsanhuez@umag.cl)
+ * - Nicolas Mancilla (nicmanci@umag.cl)
+ */
+
+#ifndef OBJSTORE_H
+#define OBJSTORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sha1.h"
+#include "rcu.h"
+
+#define OBJECT_HEX_LENGTH (SHA1_DIGEST_SIZE * 2) ///< Caracteres hexadecimales de un identificador.
+#define OBJECT_ABBREV_LENGTH 7 ///< Largo de la abreviación que se muestra al usuario.
+#define OBJECT_MIN_PREFIX 4 ///< Largo mínimo aceptado para un prefijo de identificador.
+
+/**
+ * @brief Identificador de un objeto (hash SHA-1 de su contenido).
+ */
+typedef struct object_id 
+{
+    unsigned char hash[SHA1_DIGEST_SIZE]; ///< Bytes del hash.
+} object_id;
+
+/**
+ * @brief Entrada de la tabla de objetos.
+ */
+typedef struct ObjectEntry 
+{
+    object_id id; ///< Identificador del objeto.
+    uint32_t ref; ///< Referencia al objeto (índice + 1), o 0 si la posición está libre.
+} ObjectEntry;
+
+/**
+ * @brief Tabla hash de identificador a objeto.
+ * 
+ * La posición inicial de cada entrada se toma de los bits más significativos del
+ * identificador, de modo que los objetos que comparten un prefijo quedan contiguos
+ * y una abreviación se resuelve revisando solo un tramo de la tabla.
+ * 
+ * Las entradas no contienen punteros, así que la tabla puede guardarse tal cual en
+ * disco y usarse directamente desde un archivo mapeado en memoria.
+ * 
+ * Las búsquedas pueden correr en paralelo con un objtable_insert() (ver rcu.h): cada
+ * entrada se publica escribiendo su @c ref al final, y al crecer se publica un arreglo
+ * nuevo ya lleno mientras el anterior queda retirado.
+ */
+typedef struct ObjectTable 
+{
+    ObjectEntry *entries; ///< Arreglo de entradas.
+    unsigned int bits; ///< Logaritmo en base 2 de la capacidad.
+    size_t count; ///< Cantidad de objetos almacenados.
+    int mapped; ///< 1 si @c entries apunta a memoria mapeada de solo lectura.
+    unsigned int generation; ///< Contador de reemplazos del arreglo (impar durante uno).
+    RetireList retired; ///< Arreglos reemplazados, liberados en objtable_free().
+} ObjectTable;
+
+/**
+ * @brief Calcula el identificador de un objeto.
+ * 
+ * Igual que Git, el hash cubre una cabecera "<tipo> <largo>\0" seguida del contenido.
+ * 
+ * @param type Tipo del objeto (por ejemplo "commit").
+ * @param data Contenido serializado.
+ * @param len Largo del contenido.
+ * @param id Identificador resultante.
+ */
+void object_hash(const char *type, const void *data, size_t len, object_id *id);
+
+/**
+ * @brief Convierte un identificador a texto hexadecimal.
+ * 
+ * @param id Identificador.
+ * @param hex Destino de al menos OBJECT_HEX_LENGTH + 1 caracteres.
+ */
+void object_id_to_hex(const object_id *id, char *hex);
+
+/**
+ * @brief Inserta un objeto en la tabla.
+ * 
+ * Si el identificador ya existe, se conserva el objeto previo.
+ * Si la tabla está mapeada, la primera inserción la copia a memoria propia.
+ * 
+ * @param table Tabla de objetos.
+ * @param id Identificador del objeto.
+ * @param ref Referencia a asociar (distinta de 0).
+ * @return 0 si se insertó, 1 si ya existía, -1 si no hay memoria.
+ */
+int objtable_insert(ObjectTable *table, const object_id *id, uint32_t ref);
+
+/**
+ * @brief Busca un objeto por su identificador completo.
+ * 
+ * @param table Tabla de objetos.
+ * @param id Identificador buscado.
+ * @return La referencia del objeto, o 0 si no existe.
+ */
+uint32_t objtable_find(const ObjectTable *table, const object_id *id);
+
+/**
+ * @brief Busca un objeto por un prefijo hexadecimal de su identificador.
+ * 
+ * @param table Tabla de objetos.
+ * @param prefix Prefijo hexadecimal (entre OBJECT_MIN_PREFIX y OBJECT_HEX_LENGTH caracteres).
+ * @param ref Referencia encontrada cuando la coincidencia es única.
+ * @return Cantidad de coincidencias: 0, 1, o 2 si el prefijo es ambiguo; -1 si el prefijo no es válido.
+ */
+int objtable_find_prefix(const ObjectTable *table, const char *prefix, uint32_t *ref);
+
+/**
+ * @brief Usa un arreglo de entradas mapeado desde disco como contenido de la tabla.
+ * 
+ * @param table Tabla vacía.
+ * @param entries Entradas mapeadas (2^bits elementos).
+ * @param bits Logaritmo de la capacidad.
+ * @param count Cantidad de objetos en las entradas.
+ */
+void objtable_attach(ObjectTable *table, const ObjectEntry *entries, unsigned int bits, size_t count);
+
+/**
+ * @brief Comprueba que una tabla cargada desde disco es coherente.
+ * 
+ * @param table Tabla de objetos.
+ * @param max_ref Referencia más alta válida (la cantidad de objetos referidos).
+ * @return 1 si las referencias están en rango y queda alguna posición libre, 0 si no.
+ */
+int objtable_valid(const ObjectTable *table, uint32_t max_ref);
+
+/**
+ * @brief Libera la memoria de la tabla (no libera los objetos ni memoria mapeada).
+ * 
+ * @param table Tabla de objetos.
+ */
+void objtable_free(ObjectTable *table);
+
+#endif
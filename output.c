@@ -0,0 +1,335 @@
+/**
+ * @file output.c
+ * @brief Implementación de la capa de salida con búfer.
+ * 
+ * @authors
+ * Benjamin Sanhueza (bsanhuez@umag.cl)
+ * Nicolas Mancilla (nicmanci@umag.cl)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include "output.h"
+#include "objstore.h"
+
+#define OUTPUT_MESSAGE_MAX 1024 ///< Largo máximo del mensaje de un error en modo JSON.
+
+/**
+ * @brief Mensaje de un error en modo JSON, armado fuera del búfer de salida.
+ */
+typedef struct MessageText 
+{
+    char data[OUTPUT_MESSAGE_MAX]; ///< Texto del mensaje (truncado si no cabe).
+    size_t len; ///< Bytes usados de @c data.
+} MessageText;
+
+/// Modo de salida actual.
+static OutputMode output_mode = OUTPUT_TEXT;
+
+/// Búfer donde se acumula la salida; cada hilo tiene el suyo y lo reserva al primer uso.
+static _Thread_local char *output_buffer = NULL;
+
+/// Bytes usados de @c output_buffer.
+static _Thread_local size_t output_used = 0;
+
+/**
+ * @brief Cambia el modo de salida.
+ * 
+ * @param mode Nuevo modo.
+ */
+void output_set_mode(OutputMode mode)
+{
+    output_mode = mode;
+}
+
+/**
+ * @brief Modo de salida actual.
+ * 
+ * @return El modo.
+ */
+OutputMode output_get_mode()
+{
+    return output_mode;
+}
+
+/**
+ * @brief Escribe en la salida estándar todo lo acumulado por el hilo actual.
+ */
+void output_flush()
+{
+    if (output_used > 0) fwrite(output_buffer, 1, output_used, stdout);
+    output_used = 0;
+    fflush(stdout);
+}
+
+/**
+ * @brief Reserva el búfer del hilo actual si aún no existe.
+ * 
+ * @return 1 si hay búfer, 0 si no hay memoria (la salida se escribe directamente).
+ */
+static int buffer_ready()
+{
+    if (!output_buffer) output_buffer = (char *)malloc(OUTPUT_BUFFER_SIZE);
+    return output_buffer != NULL;
+}
+
+/**
+ * @brief Agrega bytes al búfer, vaciándolo si no caben.
+ * 
+ * @param data Bytes a escribir.
+ * @param len Cantidad de bytes.
+ */
+static void put_bytes(const char *data, size_t len)
+{
+    if (!buffer_ready()) 
+    {
+        fwrite(data, 1, len, stdout);
+        return;
+    }
+    if (len > OUTPUT_BUFFER_SIZE - output_used) 
+    {
+        output_flush();
+        if (len > OUTPUT_BUFFER_SIZE) 
+        {
+            fwrite(data, 1, len, stdout);
+            return;
+        }
+    }
+    memcpy(output_buffer + output_used, data, len);
+    output_used += len;
+}
+
+/**
+ * @brief Agrega una cadena al búfer.
+ * 
+ * @param text Cadena.
+ */
+static void put_string(const char *text)
+{
+    put_bytes(text, strlen(text));
+}
+
+/**
+ * @brief Agrega un entero sin signo en decimal.
+ * 
+ * @param value Valor.
+ */
+static void put_size(size_t value)
+{
+    char digits[24];
+    size_t pos = sizeof(digits);
+    do 
+    {
+        digits[--pos] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+    put_bytes(digits + pos, sizeof(digits) - pos);
+}
+
+/**
+ * @brief Agrega una cadena JSON entre comillas, escapando los caracteres especiales.
+ * 
+ * @param text Cadena.
+ * @param len Cantidad de bytes a escribir.
+ */
+static void put_json_string(const char *text, size_t len)
+{
+    static const char hex[] = "0123456789abcdef";
+    put_bytes("\"", 1);
+    size_t start = 0;
+    for (size_t i = 0; i < len; i++) 
+    {
+        unsigned char c = (unsigned char)text[i];
+        if (c != '"' && c != '\\' && c >= 0x20) continue;
+
+        put_bytes(text + start, i - start);
+        if (c == '"' || c == '\\') 
+        {
+            char escaped[2] = { '\\', (char)c };
+            put_bytes(escaped, 2);
+        }
+        else 
+        {
+            char escaped[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 15] };
+            put_bytes(escaped, 6);
+        }
+        start = i + 1;
+    }
+    put_bytes(text + start, len - start);
+    put_bytes("\"", 1);
+}
+
+/**
+ * @brief Escribe un formato en modo texto, reemplazando cada campo por su valor.
+ * 
+ * @param format Formato con campos {nombre:tipo}.
+ * @param args Valores de los campos.
+ */
+static void render_text(const char *format, va_list args)
+{
+    for (const char *p = strchr(format, '{'); p != NULL; p = strchr(format, '{')) 
+    {
+        const char *type = strchr(p, ':');
+        if (!type) break;
+
+        put_bytes(format, (size_t)(p - format));
+        if (type[1] == 's') put_string(va_arg(args, const char *));
+        else if (type[1] == 'z') put_size(va_arg(args, size_t));
+        else if (type[1] == 'a') put_bytes(va_arg(args, const char *), OBJECT_ABBREV_LENGTH);
+        format = type + 3;
+    }
+    put_string(format);
+}
+
+/**
+ * @brief Agrega bytes a un mensaje, descartando los que no caben.
+ * 
+ * @param message Mensaje.
+ * @param data Bytes a agregar.
+ * @param len Cantidad de bytes.
+ */
+static void message_put(MessageText *message, const char *data, size_t len)
+{
+    size_t room = sizeof(message->data) - message->len;
+    if (len > room) len = room;
+    memcpy(message->data + message->len, data, len);
+    message->len += len;
+}
+
+/**
+ * @brief Arma un formato en modo texto dentro de un mensaje, como render_text().
+ * 
+ * @param message Mensaje vacío.
+ * @param format Formato con campos {nombre:tipo}.
+ * @param args Valores de los campos.
+ */
+static void render_message(MessageText *message, const char *format, va_list args)
+{
+    for (const char *p = strchr(format, '{'); p != NULL; p = strchr(format, '{')) 
+    {
+        const char *type = strchr(p, ':');
+        if (!type) break;
+
+        message_put(message, format, (size_t)(p - format));
+        if (type[1] == 's') 
+        {
+            const char *value = va_arg(args, const char *);
+            message_put(message, value, strlen(value));
+        }
+        else if (type[1] == 'z') 
+        {
+            char digits[24];
+            int len = snprintf(digits, sizeof(digits), "%zu", va_arg(args, size_t));
+            message_put(message, digits, (size_t)len);
+        }
+        else if (type[1] == 'a') message_put(message, va_arg(args, const char *), OBJECT_ABBREV_LENGTH);
+        format = type + 3;
+    }
+    message_put(message, format, strlen(format));
+}
+
+/**
+ * @brief Escribe los campos de un formato como pares JSON ("nombre":valor).
+ * 
+ * @param format Formato con campos {nombre:tipo}.
+ * @param args Valores de los campos.
+ */
+static void render_fields(const char *format, va_list args)
+{
+    for (const char *p = strchr(format, '{'); p != NULL; p = strchr(p, '{')) 
+    {
+        const char *type = strchr(p, ':');
+        if (!type) break;
+
+        put_bytes(",", 1);
+        put_json_string(p + 1, (size_t)(type - p - 1));
+        put_bytes(":", 1);
+        if (type[1] == 'z') put_size(va_arg(args, size_t));
+        else 
+        {
+            const char *value = va_arg(args, const char *);
+            put_json_string(value, strlen(value));
+        }
+        p = type + 2;
+    }
+}
+
+/**
+ * @brief Escribe texto solo en modo texto.
+ * 
+ * @param format Formato.
+ * @param ... Valores.
+ */
+void output_text(const char *format, ...)
+{
+    if (output_mode != OUTPUT_TEXT) return;
+
+    va_list args;
+    va_start(args, format);
+    render_text(format, args);
+    va_end(args);
+}
+
+/**
+ * @brief Informa un evento.
+ * 
+ * @param event Nombre del evento.
+ * @param format Formato.
+ * @param ... Valores.
+ */
+void output_event(const char *event, const char *format, ...)
+{
+    if (output_mode == OUTPUT_QUIET) return;
+
+    va_list args;
+    va_start(args, format);
+    if (output_mode == OUTPUT_TEXT) 
+    {
+        render_text(format, args);
+    }
+    else 
+    {
+        put_string("{\"event\":");
+        put_json_string(event, strlen(event));
+        render_fields(format, args);
+        put_bytes("}\n", 2);
+    }
+    va_end(args);
+}
+
+/**
+ * @brief Informa un error en cualquier modo.
+ * 
+ * En modo JSON el mensaje se arma primero en modo texto dentro de un arreglo local,
+ * sin tocar el búfer de salida, y luego se escribe escapado.
+ * 
+ * @param format Formato.
+ * @param ... Valores.
+ */
+void output_error(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    if (output_mode != OUTPUT_JSON) 
+    {
+        render_text(format, args);
+        va_end(args);
+        return;
+    }
+
+    va_list fields;
+    va_copy(fields, args);
+    MessageText message;
+    message.len = 0;
+    render_message(&message, format, args);
+    while (message.len > 0 && message.data[message.len - 1] == '\n') message.len--;
+
+    put_string("{\"event\":\"error\",\"message\":");
+    put_json_string(message.data, message.len);
+    render_fields(format, fields);
+    put_bytes("}\n", 2);
+    va_end(fields);
+    va_end(args);
+}
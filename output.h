@@ -0,0 +1,84 @@
+/**
+ * @file output.h
+ * @brief Capa única de salida de uGit: texto, silencioso o JSON por líneas.
+ * 
+ * Todos los mensajes pasan por aquí y se acumulan en un búfer grande que se vacía
+ * cuando se llena, antes de leer un comando interactivo y al terminar. Cada hilo tiene
+ * su propio búfer, que debe vaciar con output_flush() antes de terminar. Cada mensaje
+ * se describe con un formato con campos con nombre, por ejemplo
+ * "Archivo {path:s} eliminado.\n": en modo texto los campos se reemplazan por su valor,
+ * y en modo JSON se escribe una línea {"event":...,"path":...}. En modo silencioso los
+ * eventos se descartan sin formatear nada; los errores siempre se muestran.
+ * 
+ * Tipos de campo: @c s (cadena), @c z (size_t) y @c a (identificador hexadecimal
+ * completo, que en modo texto se abrevia a OBJECT_ABBREV_LENGTH caracteres).
+ * 
+ * @authors
+ * - Benjamin Sanhueza (bsanhuez@umag.cl)
+ * - Nicolas Mancilla (nicmanci@umag.cl)
+ */
+
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#define OUTPUT_BUFFER_SIZE (1 << 20) ///< Bytes del búfer de salida.
+
+/**
+ * @brief Forma en que se escriben los mensajes.
+ */
+typedef enum OutputMode 
+{
+    OUTPUT_TEXT, ///< Mensajes para personas (por defecto).
+    OUTPUT_QUIET, ///< Solo errores.
+    OUTPUT_JSON ///< Un objeto JSON por línea.
+} OutputMode;
+
+/**
+ * @brief Cambia el modo de salida.
+ * 
+ * @param mode Nuevo modo.
+ */
+void output_set_mode(OutputMode mode);
+
+/**
+ * @brief Modo de salida actual.
+ * 
+ * @return El modo.
+ */
+OutputMode output_get_mode();
+
+/**
+ * @brief Escribe texto que solo tiene sentido para personas (títulos, prompt).
+ * 
+ * Se omite en los modos silencioso y JSON.
+ * 
+ * @param format Formato con campos con nombre.
+ * @param ... Valores de los campos, en orden.
+ */
+void output_text(const char *format, ...);
+
+/**
+ * @brief Informa un evento (resultado normal de un comando).
+ * 
+ * @param event Nombre del evento en modo JSON.
+ * @param format Formato con campos con nombre.
+ * @param ... Valores de los campos, en orden.
+ */
+void output_event(const char *event, const char *format, ...);
+
+/**
+ * @brief Informa un error; se muestra en todos los modos.
+ * 
+ * En modo JSON genera {"event":"error","message":...} más los campos del formato.
+ * 
+ * @param format Formato con campos con nombre.
+ * @param ... Valores de los campos, en orden.
+ */
+void output_error(const char *format, ...);
+
+/**
+ * @brief Escribe en la salida estándar todo lo acumulado en el búfer.
+ */
+void output_flush();
+
+#endif
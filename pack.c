@@ -0,0 +1,317 @@
+/**
+ * @file pack.c
+ * @brief Implementación de la escritura y lectura (mmap) de packs.
+ * 
+ * @authors
+ * Benjamin Sanhueza (bsanhuez@umag.cl)
+ * Nicolas Mancilla (nicmanci@umag.cl)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "pack.h"
+#include "store.h"
+#include "output.h"
+
+/// Redondea un desplazamiento al siguiente múltiplo de 8.
+#define ALIGN8(x) (((x) + 7) & ~(uint64_t)7)
+
+/**
+ * @brief Desplazamiento de los registros dentro del pack.
+ * 
+ * @param count Cantidad de objetos.
+ * @return Inicio de la tabla de PackEntry.
+ */
+static uint64_t entries_offset(uint64_t count)
+{
+    return ALIGN8(sizeof(PackHeader) + PACK_FANOUT * sizeof(uint32_t) + count * sizeof(object_id));
+}
+
+/**
+ * @brief Arma la ruta del pack con un identificador dado.
+ * 
+ * @param dir Directorio del repositorio.
+ * @param id Identificador del pack.
+ * @param path Destino de PATH_MAX caracteres.
+ * @return 0 en caso de éxito, -1 si la ruta es demasiado larga.
+ */
+int pack_path(const char *dir, const object_id *id, char *path)
+{
+    char hex[OBJECT_HEX_LENGTH + 1];
+    object_id_to_hex(id, hex);
+    int len = snprintf(path, PATH_MAX, "%s/pack-%s", dir, hex);
+    return len < 0 || len >= PATH_MAX ? -1 : 0;
+}
+
+/**
+ * @brief Compara dos objetos por identificador, para qsort().
+ * 
+ * @param a Puntero a un puntero a PackObject.
+ * @param b Puntero a un puntero a PackObject.
+ * @return Negativo, cero o positivo según el orden de los identificadores.
+ */
+static int compare_objects(const void *a, const void *b)
+{
+    const PackObject *left = *(const PackObject *const *)a;
+    const PackObject *right = *(const PackObject *const *)b;
+    return memcmp(left->id.hash, right->id.hash, SHA1_DIGEST_SIZE);
+}
+
+/**
+ * @brief Escribe las secciones del pack en un archivo abierto.
+ * 
+ * @param file Archivo de destino.
+ * @param objects Objetos, en el orden de los datos.
+ * @param sorted Los mismos objetos ordenados por identificador.
+ * @param ids Identificadores ordenados.
+ * @param count Cantidad de objetos.
+ * @return 0 en caso de éxito, -1 si falló la escritura.
+ */
+static int write_pack(FILE *file, const PackObject *objects, const PackObject *const *sorted, const object_id *ids, size_t count)
+{
+    static const char zeros[8] = { 0 };
+    PackHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PACK_MAGIC, 8);
+    header.version = PACK_VERSION;
+    header.count = (uint32_t)count;
+
+    uint64_t *offsets = (uint64_t *)malloc(count * sizeof(uint64_t));
+    if (!offsets) return -1;
+    for (size_t i = 0; i < count; i++)
+    {
+        offsets[i] = header.data_size;
+        header.data_size += objects[i].length;
+    }
+
+    uint32_t fanout[PACK_FANOUT] = { 0 };
+    for (size_t i = 0; i < count; i++) fanout[ids[i].hash[0]]++;
+    for (size_t i = 1; i < PACK_FANOUT; i++) fanout[i] += fanout[i - 1];
+
+    size_t ids_end = sizeof(PackHeader) + sizeof(fanout) + count * sizeof(object_id);
+    size_t pad = (size_t)(entries_offset(count) - ids_end);
+    int failed = fwrite(&header, sizeof(header), 1, file) != 1 ||
+                 fwrite(fanout, sizeof(fanout), 1, file) != 1 ||
+                 fwrite(ids, sizeof(object_id), count, file) != count ||
+                 (pad > 0 && fwrite(zeros, 1, pad, file) != pad);
+    for (size_t i = 0; i < count && !failed; i++)
+    {
+        PackEntry entry;
+        entry.offset = offsets[sorted[i] - objects];
+        entry.length = sorted[i]->length;
+        entry.blob = sorted[i]->blob;
+        failed = fwrite(&entry, sizeof(entry), 1, file) != 1;
+    }
+    for (size_t i = 0; i < count && !failed; i++)
+    {
+        failed = objects[i].length > 0 && fwrite(objects[i].bytes, 1, objects[i].length, file) != objects[i].length;
+    }
+    free(offsets);
+    return failed ? -1 : 0;
+}
+
+/**
+ * @brief Escribe un pack con una lista de objetos.
+ * 
+ * @param dir Directorio del repositorio.
+ * @param objects Objetos, con identificadores distintos.
+ * @param count Cantidad de objetos (mayor que 0).
+ * @param id Identificador del pack escrito.
+ * @param positions Posición de cada objeto de la lista en el índice del pack.
+ * @return 0 en caso de éxito, -1 si ocurrió un error.
+ */
+int pack_write(const char *dir, const PackObject *objects, size_t count, object_id *id, uint32_t *positions)
+{
+    const PackObject **sorted = (const PackObject **)malloc(count * sizeof(PackObject *));
+    object_id *ids = (object_id *)malloc(count * sizeof(object_id));
+    if (!sorted || !ids)
+    {
+        perror("Error al asignar memoria para el pack");
+        free(sorted);
+        free(ids);
+        return -1;
+    }
+    for (size_t i = 0; i < count; i++) sorted[i] = &objects[i];
+    qsort(sorted, count, sizeof(PackObject *), compare_objects);
+    for (size_t i = 0; i < count; i++)
+    {
+        ids[i] = sorted[i]->id;
+        positions[sorted[i] - objects] = (uint32_t)i;
+    }
+    object_hash("pack", ids, count * sizeof(object_id), id);
+
+    char path[PATH_MAX];
+    char temp_path[PATH_MAX + 4];
+    FILE *file = NULL;
+    int failed = pack_path(dir, id, path) != 0;
+    if (!failed)
+    {
+        snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+        file = fopen(temp_path, "wb");
+        failed = !file;
+    }
+    if (file)
+    {
+        if (write_pack(file, objects, sorted, ids, count) != 0) failed = 1;
+        if (fflush(file) != 0 || fsync(fileno(file)) != 0) failed = 1;
+        if (fclose(file) != 0) failed = 1;
+    }
+    free(sorted);
+    free(ids);
+
+    if (failed || rename(temp_path, path) != 0)
+    {
+        perror("Error al escribir el pack");
+        if (file) remove(temp_path);
+        return -1;
+    }
+    if (store_sync_dir(path) != 0) 
+    {
+        perror("Error al sincronizar el directorio del pack");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Comprueba que las secciones de un pack mapeado son coherentes.
+ * 
+ * @param pack Pack con el mapeo y la cantidad de objetos.
+ * @param data_size Bytes de la sección de datos según la cabecera.
+ * @return 1 si el pack es válido, 0 si no.
+ */
+static int pack_valid(PackFile *pack, uint64_t data_size)
+{
+    uint64_t count = pack->count;
+    uint64_t data_offset = entries_offset(count) + count * sizeof(PackEntry);
+    if (data_offset > pack->size || data_size != pack->size - data_offset) return 0;
+
+    const unsigned char *bytes = (const unsigned char *)pack->map;
+    pack->fanout = (const uint32_t *)(bytes + sizeof(PackHeader));
+    pack->ids = (const object_id *)(bytes + sizeof(PackHeader) + PACK_FANOUT * sizeof(uint32_t));
+    pack->entries = (const PackEntry *)(bytes + entries_offset(count));
+    pack->data = bytes + data_offset;
+
+    uint32_t seen = 0;
+    for (size_t i = 0; i < PACK_FANOUT; i++)
+    {
+        if (pack->fanout[i] < seen) return 0;
+        seen = pack->fanout[i];
+    }
+    if (seen != count) return 0;
+    for (uint32_t i = 0; i < pack->count; i++)
+    {
+        const PackEntry *entry = &pack->entries[i];
+        if (entry->offset > data_size || entry->length > data_size - entry->offset) return 0;
+        if (pack->fanout[pack->ids[i].hash[0]] <= i) return 0;
+        if (i > 0 && memcmp(pack->ids[i - 1].hash, pack->ids[i].hash, SHA1_DIGEST_SIZE) >= 0) return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Abre un pack con mmap y valida su estructura.
+ * 
+ * @param pack Pack a llenar.
+ * @param path Ruta del pack.
+ * @return 0 en caso de éxito, -1 si no existe, es inválido o hubo un error.
+ */
+int pack_open(PackFile *pack, const char *path)
+{
+    memset(pack, 0, sizeof(*pack));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        output_error("Error: No se pudo abrir el pack {path:s}: {reason:s}\n", path, strerror(errno));
+        return -1;
+    }
+
+    struct stat info;
+    void *map = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && (size_t)info.st_size >= sizeof(PackHeader))
+    {
+        map = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        output_error("Error: El archivo {path:s} no es un pack válido.\n", path);
+        return -1;
+    }
+
+    const PackHeader *header = (const PackHeader *)map;
+    pack->map = map;
+    pack->size = (size_t)info.st_size;
+    pack->count = header->count;
+    if (memcmp(header->magic, PACK_MAGIC, 8) != 0 || header->version != PACK_VERSION ||
+        (uint64_t)header->count > pack->size / (sizeof(object_id) + sizeof(PackEntry)) ||
+        !pack_valid(pack, header->data_size))
+    {
+        output_error("Error: El archivo {path:s} no es un pack válido.\n", path);
+        pack_close(pack);
+        return -1;
+    }
+    object_hash("pack", pack->ids, (size_t)pack->count * sizeof(object_id), &pack->id);
+    return 0;
+}
+
+/**
+ * @brief Busca un identificador en el índice del pack.
+ * 
+ * El fanout da el tramo de identificadores que empiezan con el mismo byte, y dentro
+ * de él se busca en forma binaria.
+ * 
+ * @param pack Pack abierto (o vacío).
+ * @param id Identificador buscado.
+ * @return Posición del objeto en el índice, o PACK_NONE si no está.
+ */
+uint32_t pack_find(const PackFile *pack, const object_id *id)
+{
+    if (pack->count == 0) return PACK_NONE;
+
+    unsigned char first = id->hash[0];
+    uint32_t low = first > 0 ? pack->fanout[first - 1] : 0;
+    uint32_t high = pack->fanout[first];
+    while (low < high)
+    {
+        uint32_t middle = low + (high - low) / 2;
+        int order = memcmp(pack->ids[middle].hash, id->hash, SHA1_DIGEST_SIZE);
+        if (order == 0) return middle;
+        if (order < 0) low = middle + 1;
+        else high = middle;
+    }
+    return PACK_NONE;
+}
+
+/**
+ * @brief Obtiene los bytes de un objeto del pack.
+ * 
+ * @param pack Pack abierto.
+ * @param position Posición en el índice.
+ * @param length Largo de los bytes.
+ * @return Bytes del objeto, o NULL si la posición no existe.
+ */
+const void *pack_object(const PackFile *pack, uint32_t position, uint32_t *length)
+{
+    if (position >= pack->count) return NULL;
+    *length = pack->entries[position].length;
+    return pack->data + pack->entries[position].offset;
+}
+
+/**
+ * @brief Cierra el mapeo de un pack y lo deja vacío.
+ * 
+ * @param pack Pack (abierto o vacío).
+ */
+void pack_close(PackFile *pack)
+{
+    if (pack->map) munmap(pack->map, pack->size);
+    memset(pack, 0, sizeof(*pack));
+}
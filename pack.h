@@ -0,0 +1,143 @@
+/**
+ * @file pack.h
+ * @brief Pack de blobs: los bytes de muchos objetos en un solo archivo con índice ordenado.
+ * 
+ * El archivo del repositorio se reescribe completo en cada guardado, así que el
+ * contenido de los archivos de toda la historia se volvería a escribir cada vez. El
+ * comando repack mueve esos bytes a un pack, que se escribe una sola vez y después
+ * solo se lee con mmap.
+ * 
+ * Un pack tiene una cabecera, una tabla de 256 contadores acumulados por primer byte
+ * del identificador (fanout), los identificadores ordenados, un registro por objeto en
+ * el mismo orden y al final los bytes de los objetos (completos o deltas, ver delta.h).
+ * Buscar un identificador cuesta una búsqueda binaria dentro del tramo que indica el
+ * fanout. El archivo se llama "pack-" más el hash de sus identificadores, así que un
+ * pack nuevo nunca reemplaza al que todavía usa el repositorio guardado.
+ * 
+ * @authors
+ * - Benjamin Sanhueza (bsanhuez@umag.cl)
+ * - Nicolas Mancilla (nicmanci@umag.cl)
+ */
+
+#ifndef PACK_H
+#define PACK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "objstore.h"
+
+#define PACK_MAGIC "UGITPACK" ///< Firma de los primeros ocho bytes del pack.
+#define PACK_VERSION 1 ///< Versión del formato del pack.
+#define PACK_FANOUT 256 ///< Contadores de la tabla fanout (uno por valor del primer byte).
+#define PACK_NONE UINT32_MAX ///< Posición que indica "objeto no encontrado".
+
+/**
+ * @brief Cabecera del pack.
+ */
+typedef struct PackHeader
+{
+    char magic[8]; ///< Firma PACK_MAGIC.
+    uint32_t version; ///< Versión del formato.
+    uint32_t count; ///< Cantidad de objetos.
+    uint64_t data_size; ///< Bytes de la sección de datos.
+} PackHeader;
+
+/**
+ * @brief Registro de un objeto del pack, en el orden de los identificadores.
+ */
+typedef struct PackEntry
+{
+    uint64_t offset; ///< Inicio de los bytes del objeto en la sección de datos.
+    uint32_t length; ///< Bytes guardados del objeto.
+    uint32_t blob; ///< Índice del blob en la tabla de blobs del repositorio.
+} PackEntry;
+
+/**
+ * @brief Pack abierto con mmap.
+ */
+typedef struct PackFile
+{
+    void *map; ///< Inicio del mapeo, o NULL si no hay pack abierto.
+    size_t size; ///< Largo del mapeo.
+    uint32_t count; ///< Cantidad de objetos.
+    const uint32_t *fanout; ///< Objetos cuyo primer byte es menor o igual a cada valor.
+    const object_id *ids; ///< Identificadores ordenados.
+    const PackEntry *entries; ///< Registro de cada identificador.
+    const unsigned char *data; ///< Sección de datos.
+    object_id id; ///< Identificador del pack (hash de @c ids).
+} PackFile;
+
+/**
+ * @brief Objeto a escribir en un pack.
+ */
+typedef struct PackObject
+{
+    object_id id; ///< Identificador del objeto.
+    uint32_t blob; ///< Índice del blob en la tabla de blobs.
+    const void *bytes; ///< Bytes guardados (contenido o delta).
+    uint32_t length; ///< Largo de @c bytes.
+} PackObject;
+
+/**
+ * @brief Arma la ruta del pack con un identificador dado.
+ * 
+ * @param dir Directorio del repositorio.
+ * @param id Identificador del pack.
+ * @param path Destino de PATH_MAX caracteres.
+ * @return 0 en caso de éxito, -1 si la ruta es demasiado larga.
+ */
+int pack_path(const char *dir, const object_id *id, char *path);
+
+/**
+ * @brief Escribe un pack con una lista de objetos.
+ * 
+ * Los bytes se escriben en el orden de la lista (así un delta queda después de su
+ * base) y el índice en el orden de los identificadores. Se escribe primero un archivo
+ * temporal que se sincroniza con el disco antes de renombrarlo, y después se sincroniza
+ * el directorio, de modo que el pack ya es durable cuando el repositorio pasa a nombrarlo.
+ * 
+ * @param dir Directorio del repositorio.
+ * @param objects Objetos, con identificadores distintos.
+ * @param count Cantidad de objetos (mayor que 0).
+ * @param id Identificador del pack escrito.
+ * @param positions Posición de cada objeto de la lista en el índice del pack.
+ * @return 0 en caso de éxito, -1 si ocurrió un error.
+ */
+int pack_write(const char *dir, const PackObject *objects, size_t count, object_id *id, uint32_t *positions);
+
+/**
+ * @brief Abre un pack con mmap y valida su estructura.
+ * 
+ * @param pack Pack a llenar.
+ * @param path Ruta del pack.
+ * @return 0 en caso de éxito, -1 si no existe, es inválido o hubo un error.
+ */
+int pack_open(PackFile *pack, const char *path);
+
+/**
+ * @brief Busca un identificador en el índice del pack.
+ * 
+ * @param pack Pack abierto (o vacío).
+ * @param id Identificador buscado.
+ * @return Posición del objeto en el índice, o PACK_NONE si no está.
+ */
+uint32_t pack_find(const PackFile *pack, const object_id *id);
+
+/**
+ * @brief Obtiene los bytes de un objeto del pack.
+ * 
+ * @param pack Pack abierto.
+ * @param position Posición en el índice.
+ * @param length Largo de los bytes.
+ * @return Bytes del objeto, o NULL si la posición no existe.
+ */
+const void *pack_object(const PackFile *pack, uint32_t position, uint32_t *length);
+
+/**
+ * @brief Cierra el mapeo de un pack y lo deja vacío.
+ * 
+ * @param pack Pack (abierto o vacío).
+ */
+void pack_close(PackFile *pack);
+
+#endif
@@ -0,0 +1,105 @@
+/**
+ * @file rcu.c
+ * @brief Implementación de la publicación para lectores sin bloqueo.
+ * 
+ * @authors
+ * Benjamin Sanhueza (bsanhuez@umag.cl)
+ * Nicolas Mancilla (nicmanci@umag.cl)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
+#include "rcu.h"
+
+/**
+ * @brief Retira un bloque para liberarlo al cerrar.
+ * 
+ * @param list Lista de retirados.
+ * @param ptr Bloque (puede ser NULL).
+ */
+void rcu_retire(RetireList *list, void *ptr)
+{
+    if (!ptr) return;
+    if (list->count == list->cap) 
+    {
+        size_t capacity = list->cap ? list->cap * 2 : 8;
+        void **items = (void **)realloc(list->items, capacity * sizeof(void *));
+        if (!items) 
+        {
+            perror("Error al asignar memoria para la lista de retirados");
+            return;
+        }
+        list->items = items;
+        list->cap = capacity;
+    }
+    list->items[list->count++] = ptr;
+}
+
+/**
+ * @brief Libera todos los bloques retirados.
+ * 
+ * @param list Lista de retirados.
+ */
+void rcu_reclaim(RetireList *list)
+{
+    for (size_t i = 0; i < list->count; i++) free(list->items[i]);
+    free(list->items);
+    list->items = NULL;
+    list->count = 0;
+    list->cap = 0;
+}
+
+/**
+ * @brief Marca el inicio de un reemplazo de arreglo.
+ * 
+ * La barrera posterior impide que las escrituras del reemplazo se vean antes que la
+ * generación impar.
+ * 
+ * @param generation Contador de la tabla.
+ */
+void rcu_write_begin(unsigned int *generation)
+{
+    __atomic_store_n(generation, *generation + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Marca el fin de un reemplazo de arreglo.
+ * 
+ * @param generation Contador de la tabla.
+ */
+void rcu_write_end(unsigned int *generation)
+{
+    __atomic_store_n(generation, *generation + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Comienza una lectura, esperando si hay un reemplazo en curso.
+ * 
+ * @param generation Contador de la tabla.
+ * @return Generación observada (par).
+ */
+unsigned int rcu_read_begin(const unsigned int *generation)
+{
+    unsigned int start = __atomic_load_n(generation, __ATOMIC_ACQUIRE);
+    while (start & 1u) 
+    {
+        sched_yield();
+        start = __atomic_load_n(generation, __ATOMIC_ACQUIRE);
+    }
+    return start;
+}
+
+/**
+ * @brief Indica si la lectura cruzó un reemplazo.
+ * 
+ * @param generation Contador de la tabla.
+ * @param start Generación observada al comenzar.
+ * @return 1 si hay que repetir, 0 si no.
+ */
+int rcu_read_retry(const unsigned int *generation, unsigned int start)
+{
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(generation, __ATOMIC_RELAXED) != start;
+}
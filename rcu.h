@@ -0,0 +1,95 @@
+/**
+ * @file rcu.h
+ * @brief Publicación de datos para lectores sin bloqueo (estilo RCU).
+ * 
+ * Un solo escritor a la vez (protegido por el mutex del repositorio) modifica las
+ * tablas, mientras cualquier cantidad de lectores las recorre sin tomar locks. Para
+ * que eso sea seguro:
+ * - Los datos se escriben completos antes de publicar el puntero o contador que los
+ *   hace visibles (RCU_PUBLISH, con semántica release), y los lectores leen ese
+ *   puntero o contador con RCU_READ (acquire).
+ * - Un arreglo reemplazado (por crecer o por copiar uno mapeado) no se libera de
+ *   inmediato: se retira a una RetireList y se libera al cerrar el repositorio, cuando
+ *   ya no puede haber lectores. Como los arreglos crecen al doble, lo retirado nunca
+ *   supera lo que está en uso.
+ * - Las tablas que cambian de arreglo llevan un contador de generación (impar mientras
+ *   se reemplaza) para que un lector que cruzó un reemplazo repita la búsqueda.
+ * 
+ * @authors
+ * - Benjamin Sanhueza (bsanhuez@umag.cl)
+ * - Nicolas Mancilla (nicmanci@umag.cl)
+ */
+
+#ifndef RCU_H
+#define RCU_H
+
+#include <stddef.h>
+
+/// Lee un valor publicado por el escritor (acquire).
+#define RCU_READ(ptr) __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+
+/// Publica un valor ya preparado para los lectores (release).
+#define RCU_PUBLISH(ptr, value) __atomic_store_n((ptr), (value), __ATOMIC_RELEASE)
+
+/**
+ * @brief Arreglos reemplazados que aún pueden estar en uso por lectores.
+ */
+typedef struct RetireList 
+{
+    void **items; ///< Punteros retirados.
+    size_t count; ///< Punteros en uso.
+    size_t cap; ///< Capacidad de @c items.
+} RetireList;
+
+/**
+ * @brief Retira un bloque de memoria para liberarlo después.
+ * 
+ * Si no hay memoria para registrarlo, el bloque se pierde en vez de liberarse antes
+ * de tiempo.
+ * 
+ * @param list Lista de retirados.
+ * @param ptr Bloque obtenido con malloc (puede ser NULL).
+ */
+void rcu_retire(RetireList *list, void *ptr);
+
+/**
+ * @brief Libera todos los bloques retirados.
+ * 
+ * Solo debe llamarse cuando ningún lector puede estar usando la estructura.
+ * 
+ * @param list Lista de retirados.
+ */
+void rcu_reclaim(RetireList *list);
+
+/**
+ * @brief Marca el inicio de un reemplazo de arreglo (generación impar).
+ * 
+ * @param generation Contador de la tabla.
+ */
+void rcu_write_begin(unsigned int *generation);
+
+/**
+ * @brief Marca el fin de un reemplazo de arreglo (generación par).
+ * 
+ * @param generation Contador de la tabla.
+ */
+void rcu_write_end(unsigned int *generation);
+
+/**
+ * @brief Comienza una lectura, esperando si hay un reemplazo en curso.
+ * 
+ * @param generation Contador de la tabla.
+ * @return Generación observada, para rcu_read_retry().
+ */
+unsigned int rcu_read_begin(const unsigned int *generation);
+
+/**
+ * @brief Indica si la lectura cruzó un reemplazo y debe repetirse.
+ * 
+ * @param generation Contador de la tabla.
+ * @param start Valor devuelto por rcu_read_begin().
+ * @return 1 si hay que repetir la lectura, 0 si fue consistente.
+ */
+int rcu_read_retry(const unsigned int *generation, unsigned int start);
+
+#endif
@@ -0,0 +1,462 @@
+/**
+ * @file sha1.c
+ * @brief Implementación de SHA-1 (FIPS 180-4).
+ * 
+ * Hay dos versiones de la función de compresión: una portable en C y otra con las
+ * instrucciones SHA de x86 (SHA-NI, que usan registros SSE4). La que se usa se elige
+ * una sola vez, consultando CPUID la primera vez que se calcula un hash.
+ * 
+ * @authors
+ * Benjamin Sanhueza (bsanhuez@umag.cl)
+ * Nicolas Mancilla (nicmanci@umag.cl)
+ */
+
+#include <string.h>
+#include "sha1.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SHA1_X86 1 ///< Compila la versión con instrucciones SHA de x86.
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+/// Rotación circular a la izquierda de 32 bits.
+#define ROL32(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+/// Palabra @p i del mensaje expandido, guardando solo las últimas 16 en @c w.
+#define SHA1_W(w, i) ((w)[(i) & 15] = ROL32((w)[((i) + 13) & 15] ^ (w)[((i) + 8) & 15] ^ (w)[((i) + 2) & 15] ^ (w)[(i) & 15], 1))
+
+/// Una ronda: rota las variables de trabajo a través de sus nombres.
+#define SHA1_ROUND(a, b, c, d, e, f, k, word) \
+    do { e += ROL32(a, 5) + (f) + (k) + (word); b = ROL32(b, 30); } while (0)
+
+/**
+ * @brief Función de compresión de una secuencia de bloques de 64 bytes.
+ */
+typedef void (*sha1_blocks_fn)(uint32_t state[5], const unsigned char *data, size_t blocks);
+
+/**
+ * @brief Procesa bloques de 64 bytes en C portable.
+ * 
+ * Las rondas van en cuatro tramos sin condiciones dentro, de cinco rondas cada
+ * iteración para que las variables roten por nombre en vez de copiarse, y el mensaje
+ * expandido se calcula sobre una ventana de 16 palabras.
+ * 
+ * @param state Estado del hash a actualizar.
+ * @param data Bloques de entrada.
+ * @param blocks Cantidad de bloques.
+ */
+static void sha1_blocks_scalar(uint32_t state[5], const unsigned char *data, size_t blocks)
+{
+    for (; blocks > 0; blocks--, data += 64)
+    {
+        uint32_t w[16];
+        for (int i = 0; i < 16; i++)
+        {
+            w[i] = (uint32_t)data[i * 4] << 24 | (uint32_t)data[i * 4 + 1] << 16 |
+                   (uint32_t)data[i * 4 + 2] << 8 | (uint32_t)data[i * 4 + 3];
+        }
+
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+        int i = 0;
+        for (; i < 15; i += 5)
+        {
+            SHA1_ROUND(a, b, c, d, e, d ^ (b & (c ^ d)), 0x5A827999, w[i]);
+            SHA1_ROUND(e, a, b, c, d, c ^ (a & (b ^ c)), 0x5A827999, w[i + 1]);
+            SHA1_ROUND(d, e, a, b, c, b ^ (e & (a ^ b)), 0x5A827999, w[i + 2]);
+            SHA1_ROUND(c, d, e, a, b, a ^ (d & (e ^ a)), 0x5A827999, w[i + 3]);
+            SHA1_ROUND(b, c, d, e, a, e ^ (c & (d ^ e)), 0x5A827999, w[i + 4]);
+        }
+        for (; i < 20; i += 5)
+        {
+            SHA1_ROUND(a, b, c, d, e, d ^ (b & (c ^ d)), 0x5A827999, w[i]);
+            SHA1_ROUND(e, a, b, c, d, c ^ (a & (b ^ c)), 0x5A827999, SHA1_W(w, i + 1));
+            SHA1_ROUND(d, e, a, b, c, b ^ (e & (a ^ b)), 0x5A827999, SHA1_W(w, i + 2));
+            SHA1_ROUND(c, d, e, a, b, a ^ (d & (e ^ a)), 0x5A827999, SHA1_W(w, i + 3));
+            SHA1_ROUND(b, c, d, e, a, e ^ (c & (d ^ e)), 0x5A827999, SHA1_W(w, i + 4));
+        }
+        for (; i < 40; i += 5)
+        {
+            SHA1_ROUND(a, b, c, d, e, b ^ c ^ d, 0x6ED9EBA1, SHA1_W(w, i));
+            SHA1_ROUND(e, a, b, c, d, a ^ b ^ c, 0x6ED9EBA1, SHA1_W(w, i + 1));
+            SHA1_ROUND(d, e, a, b, c, e ^ a ^ b, 0x6ED9EBA1, SHA1_W(w, i + 2));
+            SHA1_ROUND(c, d, e, a, b, d ^ e ^ a, 0x6ED9EBA1, SHA1_W(w, i + 3));
+            SHA1_ROUND(b, c, d, e, a, c ^ d ^ e, 0x6ED9EBA1, SHA1_W(w, i + 4));
+        }
+        for (; i < 60; i += 5)
+        {
+            SHA1_ROUND(a, b, c, d, e, (b & c) | (d & (b | c)), 0x8F1BBCDC, SHA1_W(w, i));
+            SHA1_ROUND(e, a, b, c, d, (a & b) | (c & (a | b)), 0x8F1BBCDC, SHA1_W(w, i + 1));
+            SHA1_ROUND(d, e, a, b, c, (e & a) | (b & (e | a)), 0x8F1BBCDC, SHA1_W(w, i + 2));
+            SHA1_ROUND(c, d, e, a, b, (d & e) | (a & (d | e)), 0x8F1BBCDC, SHA1_W(w, i + 3));
+            SHA1_ROUND(b, c, d, e, a, (c & d) | (e & (c | d)), 0x8F1BBCDC, SHA1_W(w, i + 4));
+        }
+        for (; i < 80; i += 5)
+        {
+            SHA1_ROUND(a, b, c, d, e, b ^ c ^ d, 0xCA62C1D6, SHA1_W(w, i));
+            SHA1_ROUND(e, a, b, c, d, a ^ b ^ c, 0xCA62C1D6, SHA1_W(w, i + 1));
+            SHA1_ROUND(d, e, a, b, c, e ^ a ^ b, 0xCA62C1D6, SHA1_W(w, i + 2));
+            SHA1_ROUND(c, d, e, a, b, d ^ e ^ a, 0xCA62C1D6, SHA1_W(w, i + 3));
+            SHA1_ROUND(b, c, d, e, a, c ^ d ^ e, 0xCA62C1D6, SHA1_W(w, i + 4));
+        }
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+    }
+}
+
+#ifdef SHA1_X86
+/**
+ * @brief Indica si el procesador tiene las instrucciones SHA y SSE4.1.
+ * 
+ * @return 1 si las tiene, 0 si no.
+ */
+static int sha1_x86_supported(void)
+{
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & bit_SSE4_1) || !(ecx & bit_SSSE3)) return 0;
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) return 0;
+    return (ebx & bit_SHA) != 0;
+}
+
+/**
+ * @brief Procesa bloques de 64 bytes con las instrucciones SHA de x86.
+ * 
+ * Cada sha1rnds4 hace cuatro rondas y sha1msg1/sha1msg2 expanden el mensaje de a
+ * cuatro palabras, así un bloque son 20 pasos. Los registros guardan A..D en orden
+ * inverso y E en la palabra alta.
+ * 
+ * @param state Estado del hash a actualizar.
+ * @param data Bloques de entrada.
+ * @param blocks Cantidad de bloques.
+ */
+__attribute__((target("sha,sse4.1")))
+static void sha1_blocks_x86(uint32_t state[5], const unsigned char *data, size_t blocks)
+{
+    const __m128i byte_swap = _mm_set_epi64x(0x0001020304050607LL, 0x08090a0b0c0d0e0fLL);
+    __m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)state), 0x1B);
+    __m128i e0 = _mm_set_epi32((int)state[4], 0, 0, 0);
+    __m128i e1;
+
+    for (; blocks > 0; blocks--, data += 64)
+    {
+        __m128i abcd_save = abcd;
+        __m128i e_save = e0;
+        __m128i msg0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)data), byte_swap);
+        __m128i msg1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 16)), byte_swap);
+        __m128i msg2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 32)), byte_swap);
+        __m128i msg3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 48)), byte_swap);
+
+        e0 = _mm_add_epi32(e0, msg0);
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+
+        e1 = _mm_sha1nexte_epu32(e1, msg1);
+        e0 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+        msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+
+        e0 = _mm_sha1nexte_epu32(e0, msg2);
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+        msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+        msg0 = _mm_xor_si128(msg0, msg2);
+
+        e1 = _mm_sha1nexte_epu32(e1, msg3);
+        e0 = abcd;
+        msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+        msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+        msg1 = _mm_xor_si128(msg1, msg3);
+
+        e0 = _mm_sha1nexte_epu32(e0, msg0);
+        e1 = abcd;
+        msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+        msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+        msg2 = _mm_xor_si128(msg2, msg0);
+
+        e1 = _mm_sha1nexte_epu32(e1, msg1);
+        e0 = abcd;
+        msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 1);
+        msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+        msg3 = _mm_xor_si128(msg3, msg1);
+
+        e0 = _mm_sha1nexte_epu32(e0, msg2);
+        e1 = abcd;
+        msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 1);
+        msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+        msg0 = _mm_xor_si128(msg0, msg2);
+
+        e1 = _mm_sha1nexte_epu32(e1, msg3);
+        e0 = abcd;
+        msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 1);
+        msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+        msg1 = _mm_xor_si128(msg1, msg3);
+
+        e0 = _mm_sha1nexte_epu32(e0, msg0);
+        e1 = abcd;
+        msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 1);
+        msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+        msg2 = _mm_xor_si128(msg2, msg0);
+
+        e1 = _mm_sha1nexte_epu32(e1, msg1);
+        e0 = abcd;
+        msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 1);
+        msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+        msg3 = _mm_xor_si128(msg3, msg1);
+
+        e0 = _mm_sha1nexte_epu32(e0, msg2);
+        e1 = abcd;
+        msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 2);
+        msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+        msg0 = _mm_xor_si128(msg0, msg2);
+
+        e1 = _mm_sha1nexte_epu32(e1, msg3);
+        e0 = abcd;
+        msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 2);
+        msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+        msg1 = _mm_xor_si128(msg1, msg3);
+
+        e0 = _mm_sha1nexte_epu32(e0, msg0);
+        e1 = abcd;
+        msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 2);
+        msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+        msg2 = _mm_xor_si128(msg2, msg0);
+
+        e1 = _mm_sha1nexte_epu32(e1, msg1);
+        e0 = abcd;
+        msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 2);
+        msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+        msg3 = _mm_xor_si128(msg3, msg1);
+
+        e0 = _mm_sha1nexte_epu32(e0, msg2);
+        e1 = abcd;
+        msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 2);
+        msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+        msg0 = _mm_xor_si128(msg0, msg2);
+
+        e1 = _mm_sha1nexte_epu32(e1, msg3);
+        e0 = abcd;
+        msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+        msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+        msg1 = _mm_xor_si128(msg1, msg3);
+
+        e0 = _mm_sha1nexte_epu32(e0, msg0);
+        e1 = abcd;
+        msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 3);
+        msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+        msg2 = _mm_xor_si128(msg2, msg0);
+
+        e1 = _mm_sha1nexte_epu32(e1, msg1);
+        e0 = abcd;
+        msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+        msg3 = _mm_xor_si128(msg3, msg1);
+
+        e0 = _mm_sha1nexte_epu32(e0, msg2);
+        e1 = abcd;
+        msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 3);
+
+        e1 = _mm_sha1nexte_epu32(e1, msg3);
+        e0 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+
+        e0 = _mm_sha1nexte_epu32(e0, e_save);
+        abcd = _mm_add_epi32(abcd, abcd_save);
+    }
+
+    _mm_storeu_si128((__m128i *)state, _mm_shuffle_epi32(abcd, 0x1B));
+    state[4] = (uint32_t)_mm_extract_epi32(e0, 3);
+}
+#endif
+
+/**
+ * @brief Indica que una versión se puede usar en cualquier procesador.
+ * 
+ * @return 1.
+ */
+static int sha1_always_supported(void)
+{
+    return 1;
+}
+
+/**
+ * @brief Una versión de la función de compresión.
+ */
+typedef struct SHA1Implementation
+{
+    const char *name; ///< Nombre para sha1_use_implementation().
+    sha1_blocks_fn blocks; ///< Función de compresión.
+    int (*supported)(void); ///< Indica si el procesador la puede ejecutar.
+} SHA1Implementation;
+
+/// Versiones disponibles, de la más rápida a la más lenta (la última siempre sirve).
+static const SHA1Implementation sha1_implementations[] =
+{
+#ifdef SHA1_X86
+    { "sha-ni", sha1_blocks_x86, sha1_x86_supported },
+#endif
+    { "scalar", sha1_blocks_scalar, sha1_always_supported }
+};
+
+#define SHA1_IMPLEMENTATIONS (sizeof(sha1_implementations) / sizeof(sha1_implementations[0])) ///< Cantidad de versiones.
+
+/// Versión elegida (posición + 1), o 0 si todavía no se elige.
+static unsigned int sha1_selected;
+
+/**
+ * @brief Obtiene la versión en uso, eligiendo la más rápida soportada la primera vez.
+ * 
+ * Si dos hilos eligen a la vez ambos llegan al mismo resultado, así que basta un
+ * acceso atómico sin lock.
+ * 
+ * @return Versión en uso.
+ */
+static const SHA1Implementation *sha1_current(void)
+{
+    unsigned int selected = __atomic_load_n(&sha1_selected, __ATOMIC_RELAXED);
+    if (selected == 0)
+    {
+        while (!sha1_implementations[selected].supported()) selected++;
+        selected++;
+        __atomic_store_n(&sha1_selected, selected, __ATOMIC_RELAXED);
+    }
+    return &sha1_implementations[selected - 1];
+}
+
+/**
+ * @brief Nombre de la versión de la función de compresión en uso.
+ * 
+ * @return "sha-ni" o "scalar".
+ */
+const char *sha1_implementation(void)
+{
+    return sha1_current()->name;
+}
+
+/**
+ * @brief Fuerza una versión de la función de compresión.
+ * 
+ * @param name Nombre de la versión, o NULL para volver a la elección automática.
+ * @return 0 en caso de éxito, -1 si no existe o el procesador no la soporta.
+ */
+int sha1_use_implementation(const char *name)
+{
+    if (name == NULL)
+    {
+        __atomic_store_n(&sha1_selected, 0, __ATOMIC_RELAXED);
+        return 0;
+    }
+    for (unsigned int i = 0; i < SHA1_IMPLEMENTATIONS; i++)
+    {
+        if (strcmp(sha1_implementations[i].name, name) == 0 && sha1_implementations[i].supported())
+        {
+            __atomic_store_n(&sha1_selected, i + 1, __ATOMIC_RELAXED);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Inicializa un contexto SHA-1 con las constantes del estándar.
+ * 
+ * @param ctx Contexto a inicializar.
+ */
+void sha1_init(SHA1Context *ctx)
+{
+    ctx->state[0] = 0x67452301;
+    ctx->state[1] = 0xEFCDAB89;
+    ctx->state[2] = 0x98BADCFE;
+    ctx->state[3] = 0x10325476;
+    ctx->state[4] = 0xC3D2E1F0;
+    ctx->length = 0;
+    ctx->used = 0;
+}
+
+/**
+ * @brief Agrega datos al cálculo, procesando los bloques completos de una vez.
+ * 
+ * @param ctx Contexto del cálculo.
+ * @param data Datos a procesar.
+ * @param len Cantidad de bytes.
+ */
+void sha1_update(SHA1Context *ctx, const void *data, size_t len)
+{
+    const unsigned char *bytes = (const unsigned char *)data;
+    ctx->length += len;
+
+    if (ctx->used > 0) 
+    {
+        size_t take = 64 - ctx->used;
+        if (take > len) take = len;
+        memcpy(ctx->block + ctx->used, bytes, take);
+        ctx->used += take;
+        bytes += take;
+        len -= take;
+        if (ctx->used < 64) return;
+        sha1_current()->blocks(ctx->state, ctx->block, 1);
+        ctx->used = 0;
+    }
+
+    if (len >= 64) 
+    {
+        size_t blocks = len / 64;
+        sha1_current()->blocks(ctx->state, bytes, blocks);
+        bytes += blocks * 64;
+        len -= blocks * 64;
+    }
+
+    memcpy(ctx->block, bytes, len);
+    ctx->used = len;
+}
+
+/**
+ * @brief Aplica el relleno final y escribe el hash en formato big-endian.
+ * 
+ * @param ctx Contexto del cálculo.
+ * @param digest Destino del hash.
+ */
+void sha1_final(SHA1Context *ctx, unsigned char digest[SHA1_DIGEST_SIZE])
+{
+    uint64_t bits = ctx->length * 8;
+    unsigned char pad = 0x80;
+    sha1_update(ctx, &pad, 1);
+    pad = 0;
+    while (ctx->used != 56) 
+    {
+        sha1_update(ctx, &pad, 1);
+    }
+
+    unsigned char length[8];
+    for (int i = 0; i < 8; i++) 
+    {
+        length[i] = (unsigned char)(bits >> (56 - 8 * i));
+    }
+    sha1_update(ctx, length, 8);
+
+    for (int i = 0; i < 5; i++) 
+    {
+        digest[i * 4] = (unsigned char)(ctx->state[i] >> 24);
+        digest[i * 4 + 1] = (unsigned char)(ctx->state[i] >> 16);
+        digest[i * 4 + 2] = (unsigned char)(ctx->state[i] >> 8);
+        digest[i * 4 + 3] = (unsigned char)ctx->state[i];
+    }
+}
@@ -0,0 +1,77 @@
+/**
+ * @file sha1.h
+ * @brief Interfaz del algoritmo de hash SHA-1 usado para identificar objetos.
+ * 
+ * Implementación autocontenida (sin dependencias externas) que permite calcular
+ * el hash de forma incremental, igual que Git lo usa para sus identificadores. En x86
+ * usa las instrucciones SHA del procesador cuando están disponibles.
+ * 
+ * @authors
+ * - Benjamin Sanhueza (bsanhuez@umag.cl)
+ * - Nicolas Mancilla (nicmanci@umag.cl)
+ */
+
+#ifndef SHA1_H
+#define SHA1_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SHA1_DIGEST_SIZE 20 ///< Tamaño en bytes de un hash SHA-1.
+
+/**
+ * @brief Estado de un cálculo SHA-1 incremental.
+ */
+typedef struct SHA1Context 
+{
+    uint32_t state[5]; ///< Estado interno (h0..h4).
+    uint64_t length; ///< Cantidad de bytes procesados.
+    unsigned char block[64]; ///< Bloque parcial pendiente de procesar.
+    size_t used; ///< Bytes ocupados en @c block.
+} SHA1Context;
+
+/**
+ * @brief Inicializa un contexto SHA-1.
+ * 
+ * @param ctx Contexto a inicializar.
+ */
+void sha1_init(SHA1Context *ctx);
+
+/**
+ * @brief Agrega datos al cálculo del hash.
+ * 
+ * @param ctx Contexto inicializado con sha1_init().
+ * @param data Datos a procesar.
+ * @param len Cantidad de bytes de @p data.
+ */
+void sha1_update(SHA1Context *ctx, const void *data, size_t len);
+
+/**
+ * @brief Finaliza el cálculo y entrega el hash.
+ * 
+ * @param ctx Contexto con los datos ya procesados.
+ * @param digest Arreglo de SHA1_DIGEST_SIZE bytes donde se escribe el resultado.
+ */
+void sha1_final(SHA1Context *ctx, unsigned char digest[SHA1_DIGEST_SIZE]);
+
+/**
+ * @brief Nombre de la versión de la función de compresión en uso.
+ * 
+ * Por omisión se usa la más rápida que soporte el procesador: "sha-ni" (instrucciones
+ * SHA de x86) o "scalar" (C portable).
+ * 
+ * @return Nombre de la versión.
+ */
+const char *sha1_implementation(void);
+
+/**
+ * @brief Fuerza una versión de la función de compresión (por ejemplo, para compararlas).
+ * 
+ * Todas dan el mismo resultado; solo cambia la velocidad.
+ * 
+ * @param name Nombre de la versión, o NULL para volver a la elección automática.
+ * @return 0 en caso de éxito, -1 si no existe o el procesador no la soporta.
+ */
+int sha1_use_implementation(const char *name);
+
+#endif
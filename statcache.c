@@ -0,0 +1,63 @@
+/**
+ * @file statcache.c
+ * @brief Implementación de los datos de stat por archivo en preparación.
+ * 
+ * @authors
+ * Benjamin Sanhueza (bsanhuez@umag.cl)
+ * Nicolas Mancilla (nicmanci@umag.cl)
+ */
+
+#include <string.h>
+#include <time.h>
+#include "statcache.h"
+
+/**
+ * @brief Recuerda los datos de stat de un archivo, salvo que su fecha sea del segundo actual.
+ * 
+ * @param cache Datos a actualizar.
+ * @param info Resultado de stat del archivo.
+ */
+void stat_cache_record(FileStat *cache, const struct stat *info)
+{
+    time_t now = time(NULL);
+    if (info->st_mtim.tv_sec >= now || info->st_ctim.tv_sec >= now || info->st_ino == 0)
+    {
+        stat_cache_clear(cache);
+        return;
+    }
+
+    cache->mtime_sec = (int64_t)info->st_mtim.tv_sec;
+    cache->mtime_nsec = (uint32_t)info->st_mtim.tv_nsec;
+    cache->ctime_sec = (int64_t)info->st_ctim.tv_sec;
+    cache->ctime_nsec = (uint32_t)info->st_ctim.tv_nsec;
+    cache->size = (uint64_t)info->st_size;
+    cache->inode = (uint64_t)info->st_ino;
+}
+
+/**
+ * @brief Olvida los datos de stat.
+ * 
+ * @param cache Datos a limpiar.
+ */
+void stat_cache_clear(FileStat *cache)
+{
+    memset(cache, 0, sizeof(*cache));
+}
+
+/**
+ * @brief Compara los datos registrados con un stat actual.
+ * 
+ * @param cache Datos registrados.
+ * @param info Resultado de stat actual del archivo.
+ * @return 1 si coinciden, 0 si no o si no hay datos registrados.
+ */
+int stat_cache_matches(const FileStat *cache, const struct stat *info)
+{
+    return cache->inode != 0 &&
+           cache->inode == (uint64_t)info->st_ino &&
+           cache->size == (uint64_t)info->st_size &&
+           cache->mtime_sec == (int64_t)info->st_mtim.tv_sec &&
+           cache->mtime_nsec == (uint32_t)info->st_mtim.tv_nsec &&
+           cache->ctime_sec == (int64_t)info->st_ctim.tv_sec &&
+           cache->ctime_nsec == (uint32_t)info->st_ctim.tv_nsec;
+}
@@ -0,0 +1,72 @@
+/**
+ * @file statcache.h
+ * @brief Datos de stat guardados por archivo en preparación, para detectar cambios sin leerlo.
+ * 
+ * Igual que el índice de Git, cada archivo en preparación recuerda la fecha de
+ * modificación, la de cambio de estado, el largo y el inodo que tenía cuando se leyó
+ * su contenido. Si un stat posterior da los mismos valores, el archivo no cambió y no
+ * hace falta volver a calcular su hash. Los datos se guardan con el área de preparación.
+ * 
+ * @authors
+ * - Benjamin Sanhueza (bsanhuez@umag.cl)
+ * - Nicolas Mancilla (nicmanci@umag.cl)
+ */
+
+#ifndef STATCACHE_H
+#define STATCACHE_H
+
+#include <stdint.h>
+#include <sys/stat.h>
+
+/**
+ * @brief Datos de stat de un archivo, o ceros si no se conocen.
+ */
+typedef struct FileStat 
+{
+    int64_t mtime_sec; ///< Segundos de la fecha de modificación.
+    int64_t ctime_sec; ///< Segundos de la fecha de cambio de estado.
+    uint64_t size; ///< Largo del archivo.
+    uint64_t inode; ///< Inodo (0 si los datos no son confiables).
+    uint32_t mtime_nsec; ///< Nanosegundos de la fecha de modificación.
+    uint32_t ctime_nsec; ///< Nanosegundos de la fecha de cambio de estado.
+} FileStat;
+
+/**
+ * @brief Registro de un archivo en preparación tal como se guarda en disco.
+ */
+typedef struct StagedEntry 
+{
+    uint32_t name; ///< Identificador del nombre del archivo.
+    uint32_t blob; ///< Índice del blob con su contenido.
+    FileStat stat; ///< Datos de stat del archivo cuando se leyó o escribió ese contenido.
+} StagedEntry;
+
+/**
+ * @brief Recuerda los datos de stat de un archivo cuyo contenido se acaba de leer o escribir.
+ * 
+ * Si el archivo se modificó en el mismo segundo en que se registra, otro cambio dentro
+ * de ese segundo no movería la fecha, así que no se guarda nada y la próxima comparación
+ * vuelve a leer el archivo.
+ * 
+ * @param cache Datos a actualizar.
+ * @param info Resultado de stat del archivo.
+ */
+void stat_cache_record(FileStat *cache, const struct stat *info);
+
+/**
+ * @brief Olvida los datos de stat, obligando a leer el archivo la próxima vez.
+ * 
+ * @param cache Datos a limpiar.
+ */
+void stat_cache_clear(FileStat *cache);
+
+/**
+ * @brief Indica si un archivo sigue igual que cuando se registraron sus datos.
+ * 
+ * @param cache Datos registrados.
+ * @param info Resultado de stat actual del archivo.
+ * @return 1 si coinciden, 0 si no o si no hay datos registrados.
+ */
+int stat_cache_matches(const FileStat *cache, const struct stat *info);
+
+#endif
@@ -0,0 +1,715 @@
+/**
+ * @file store.c
+ * @brief Lectura (mmap) y escritura del archivo binario del repositorio.
+ * 
+ * @authors
+ * Benjamin Sanhueza (bsanhuez@umag.cl)
+ * Nicolas Mancilla (nicmanci@umag.cl)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "store.h"
+#include "intern.h"
+#include "blob.h"
+#include "git.h"
+#include "output.h"
+
+/// Redondea un desplazamiento al siguiente múltiplo de 8.
+#define ALIGN8(x) (((x) + 7) & ~(uint64_t)7)
+
+/// Espacio libre mínimo que se reserva tras cada sección que crece y para la zona de guardados.
+#define STORE_MIN_ROOM ((uint64_t)64 * 1024)
+
+/**
+ * @brief Prepara un segmento vacío.
+ * 
+ * @param segment Segmento.
+ * @param arena Arena para los trozos.
+ * @param chunk_size Bytes por trozo.
+ */
+void segment_init(Segment *segment, Arena *arena, size_t chunk_size)
+{
+    memset(segment, 0, sizeof(Segment));
+    segment->arena = arena;
+    segment->chunk_size = chunk_size;
+}
+
+/**
+ * @brief Largo total de un segmento.
+ * 
+ * @param segment Segmento.
+ * @return Bytes de la parte mapeada más los de la parte propia.
+ */
+size_t segment_size(const Segment *segment)
+{
+    return segment->base_len + segment->tail_len;
+}
+
+/**
+ * @brief Obtiene la dirección de un desplazamiento dentro del segmento.
+ * 
+ * @param segment Segmento.
+ * @param offset Desplazamiento.
+ * @return Puntero al dato.
+ */
+const void *segment_at(const Segment *segment, size_t offset)
+{
+    if (offset < segment->base_len) return segment->base + offset;
+    offset -= segment->base_len;
+    unsigned char *const *chunks = RCU_READ(&segment->chunks);
+    return chunks[offset / segment->chunk_size] + offset % segment->chunk_size;
+}
+
+/**
+ * @brief Agrega trozos nuevos y contiguos al directorio del segmento.
+ * 
+ * Los trozos se reservan como un único bloque, así un dato mayor que un trozo queda
+ * contiguo en memoria y los desplazamientos siguen calculándose por división. Si el
+ * directorio no alcanza, se publica una copia más grande y el anterior se retira.
+ * 
+ * @param segment Segmento.
+ * @param count Cantidad de trozos a agregar.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+static int segment_add_chunks(Segment *segment, size_t count)
+{
+    if (segment->chunk_count + count > segment->chunk_cap) 
+    {
+        size_t capacity = segment->chunk_cap ? segment->chunk_cap : 16;
+        while (capacity < segment->chunk_count + count) capacity *= 2;
+        unsigned char **chunks = (unsigned char **)malloc(capacity * sizeof(unsigned char *));
+        if (!chunks) 
+        {
+            perror("Error al asignar memoria para el segmento");
+            return -1;
+        }
+        if (segment->chunk_count > 0) memcpy(chunks, segment->chunks, segment->chunk_count * sizeof(unsigned char *));
+        rcu_retire(&segment->retired, segment->chunks);
+        RCU_PUBLISH(&segment->chunks, chunks);
+        segment->chunk_cap = capacity;
+    }
+
+    unsigned char *block = (unsigned char *)arena_alloc(segment->arena, count * segment->chunk_size);
+    if (!block) return -1;
+    for (size_t i = 0; i < count; i++) 
+    {
+        segment->chunks[segment->chunk_count++] = block + i * segment->chunk_size;
+    }
+    return 0;
+}
+
+/**
+ * @brief Agrega datos al final del segmento sin dividirlos entre trozos.
+ * 
+ * @param segment Segmento.
+ * @param data Datos a copiar.
+ * @param len Largo de los datos.
+ * @param offset Desplazamiento resultante (puede ser NULL).
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+int segment_append(Segment *segment, const void *data, size_t len, size_t *offset)
+{
+    if (len == 0) 
+    {
+        if (offset) *offset = segment_size(segment);
+        return 0;
+    }
+
+    size_t capacity = segment->chunk_count * segment->chunk_size;
+    if (segment->tail_len + len > capacity) 
+    {
+        size_t free_bytes = capacity - segment->tail_len;
+        if (free_bytes > 0) 
+        {
+            memset(segment->chunks[segment->tail_len / segment->chunk_size] + segment->tail_len % segment->chunk_size, 0, free_bytes);
+        }
+        size_t count = (len + segment->chunk_size - 1) / segment->chunk_size;
+        if (segment_add_chunks(segment, count) != 0) return -1;
+        segment->tail_len = capacity;
+    }
+
+    if (offset) *offset = segment_size(segment);
+    memcpy(segment->chunks[segment->tail_len / segment->chunk_size] + segment->tail_len % segment->chunk_size, data, len);
+    segment->tail_len += len;
+    return 0;
+}
+
+/**
+ * @brief Olvida el contenido del segmento y libera su directorio de trozos.
+ * 
+ * @param segment Segmento.
+ */
+void segment_release(Segment *segment)
+{
+    free(segment->chunks);
+    rcu_reclaim(&segment->retired);
+    segment_init(segment, segment->arena, segment->chunk_size);
+}
+
+/**
+ * @brief Comprueba que una sección cabe dentro del archivo.
+ * 
+ * @param offset Inicio de la sección.
+ * @param size Largo de la sección.
+ * @param file_size Largo del archivo.
+ * @return 1 si la sección es válida, 0 en caso contrario.
+ */
+static int section_fits(uint64_t offset, uint64_t size, size_t file_size)
+{
+    return offset % 8 == 0 && offset <= file_size && size <= file_size - offset;
+}
+
+/**
+ * @brief Comprueba que una sección que crece cabe, con su espacio reservado, en el archivo.
+ * 
+ * @param offset Inicio de la sección.
+ * @param size Largo de la sección.
+ * @param capacity Bytes reservados para la sección.
+ * @param file_size Largo del archivo.
+ * @return 1 si la sección es válida, 0 en caso contrario.
+ */
+static int room_fits(uint64_t offset, uint64_t size, uint64_t capacity, size_t file_size)
+{
+    return size <= capacity && section_fits(offset, capacity, file_size);
+}
+
+/**
+ * @brief Comprueba que las secciones están en el orden en que se escriben, sin solaparse.
+ * 
+ * Un guardado escribe en el espacio reservado de una sección sin mirar las demás, así
+ * que un archivo con secciones solapadas se rechaza antes de usarlo.
+ * 
+ * @param header Cabecera cuyas secciones ya caben en el archivo.
+ * @param index_size Bytes de la tabla de identificadores.
+ * @param names_index_size Bytes de la tabla hash de cadenas.
+ * @param blob_index_size Bytes de la tabla de identificador a blob.
+ * @return 1 si el orden es válido, 0 en caso contrario.
+ */
+static int layout_valid(const StoreHeader *header, uint64_t index_size, uint64_t names_index_size, uint64_t blob_index_size)
+{
+    const uint64_t sections[][2] =
+    {
+        { header->commits_offset, header->commits_capacity },
+        { header->filters_offset, header->filters_capacity },
+        { header->trees_offset, header->trees_capacity },
+        { header->index_offset, index_size },
+        { header->pool_offset, header->pool_capacity },
+        { header->names_offset, header->names_capacity },
+        { header->names_index_offset, names_index_size },
+        { header->blobs_offset, header->blobs_capacity },
+        { header->blob_data_offset, header->blob_data_capacity },
+        { header->blob_index_offset, blob_index_size }
+    };
+    uint64_t end = sizeof(StoreHeader);
+    for (size_t i = 0; i < sizeof(sections) / sizeof(sections[0]); i++) 
+    {
+        if (sections[i][0] < end) return 0;
+        end = sections[i][0] + sections[i][1];
+    }
+    return end <= header->log_offset && header->staging_offset >= header->log_offset &&
+           header->dirty_offset >= header->log_offset && header->refs_offset >= header->log_offset;
+}
+
+/**
+ * @brief Abre el archivo del repositorio con mmap y llena la imagen.
+ * 
+ * @param path Ruta del archivo.
+ * @param mapping Mapeo resultante.
+ * @param image Imagen a llenar.
+ * @return 0 en caso de éxito, 1 si no existe, -1 si es inválido.
+ */
+int store_open(const char *path, StoreMapping *mapping, StoreImage *image)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) 
+    {
+        if (errno == ENOENT) return 1;
+        perror("Error al abrir el repositorio");
+        return -1;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(StoreHeader)) 
+    {
+        close(fd);
+        output_error("Error: El archivo {path:s} no es un repositorio válido.\n", path);
+        return -1;
+    }
+
+    void *data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) 
+    {
+        perror("Error al mapear el repositorio");
+        return -1;
+    }
+
+    const StoreHeader *header = (const StoreHeader *)data;
+    size_t size = (size_t)info.st_size;
+    uint64_t index_size = header->index_bits < 32 ? (uint64_t)sizeof(ObjectEntry) << header->index_bits : 0;
+    uint64_t names_index_size = header->names_index_bits && header->names_index_bits < 32 ? (uint64_t)sizeof(InternSlot) << header->names_index_bits : 0;
+    uint64_t blob_index_size = header->blob_index_bits < 32 ? (uint64_t)sizeof(ObjectEntry) << header->blob_index_bits : 0;
+    if (memcmp(header->magic, STORE_MAGIC, 8) != 0 || header->version != STORE_VERSION ||
+        header->index_bits >= 32 || header->names_index_bits >= 32 || header->blob_index_bits >= 32 ||
+        header->staging_count > size / sizeof(StagedEntry) || header->dirty_count > size / sizeof(uint32_t) ||
+        header->refs_count > size / sizeof(versionGit) || header->log_offset > size ||
+        !room_fits(header->commits_offset, header->commits_size, header->commits_capacity, size) ||
+        !room_fits(header->filters_offset, header->filters_size, header->filters_capacity, size) ||
+        !room_fits(header->trees_offset, header->trees_size, header->trees_capacity, size) ||
+        !section_fits(header->index_offset, header->index_count ? index_size : 0, size) ||
+        !room_fits(header->pool_offset, header->pool_size, header->pool_capacity, size) ||
+        !room_fits(header->names_offset, header->names_size, header->names_capacity, size) ||
+        !section_fits(header->names_index_offset, names_index_size, size) ||
+        !room_fits(header->blobs_offset, header->blobs_size, header->blobs_capacity, size) ||
+        !room_fits(header->blob_data_offset, header->blob_data_size, header->blob_data_capacity, size) ||
+        !section_fits(header->blob_index_offset, header->blob_index_count ? blob_index_size : 0, size) ||
+        !section_fits(header->staging_offset, header->staging_count * sizeof(StagedEntry), size) ||
+        !section_fits(header->dirty_offset, header->dirty_count * sizeof(uint32_t), size) ||
+        !section_fits(header->refs_offset, (uint64_t)header->refs_count * sizeof(versionGit), size) ||
+        !layout_valid(header, header->index_count ? index_size : 0, names_index_size, header->blob_index_count ? blob_index_size : 0)) 
+    {
+        munmap(data, size);
+        output_error("Error: El archivo {path:s} no es un repositorio válido.\n", path);
+        return -1;
+    }
+
+    const unsigned char *bytes = (const unsigned char *)data;
+    image->commits->base = bytes + header->commits_offset;
+    image->commits->base_len = (size_t)header->commits_size;
+    image->filters->base = bytes + header->filters_offset;
+    image->filters->base_len = (size_t)header->filters_size;
+    image->trees->base = bytes + header->trees_offset;
+    image->trees->base_len = (size_t)header->trees_size;
+    image->names->pool->base = bytes + header->pool_offset;
+    image->names->pool->base_len = (size_t)header->pool_size;
+    image->names->entries->base = bytes + header->names_offset;
+    image->names->entries->base_len = (size_t)header->names_size;
+    if (header->names_index_bits > 0) 
+    {
+        intern_attach(image->names, (const InternSlot *)(bytes + header->names_index_offset), header->names_index_bits);
+    }
+    if (header->index_count > 0) 
+    {
+        objtable_attach(image->index, (const ObjectEntry *)(bytes + header->index_offset),
+                        header->index_bits, header->index_count);
+    }
+    image->blobs->records->base = bytes + header->blobs_offset;
+    image->blobs->records->base_len = (size_t)header->blobs_size;
+    image->blobs->data->base = bytes + header->blob_data_offset;
+    image->blobs->data->base_len = (size_t)header->blob_data_size;
+    if (header->blob_index_count > 0) 
+    {
+        objtable_attach(&image->blobs->index, (const ObjectEntry *)(bytes + header->blob_index_offset),
+                        header->blob_index_bits, header->blob_index_count);
+    }
+    image->head = header->head;
+    image->staging = (const StagedEntry *)(bytes + header->staging_offset);
+    image->staging_count = (size_t)header->staging_count;
+    image->staging_base = header->staging_base;
+    image->dirty = (const uint32_t *)(bytes + header->dirty_offset);
+    image->dirty_count = (size_t)header->dirty_count;
+    image->refs = (const versionGit *)(bytes + header->refs_offset);
+    image->ref_count = header->refs_count;
+    image->branch = header->branch;
+    image->pack_count = header->pack_count;
+    image->pack_id = header->pack_id;
+    image->commits_indexed = header->index_count;
+    image->names_indexed = header->names_indexed;
+    image->blobs_indexed = header->blobs_indexed;
+
+    mapping->data = data;
+    mapping->size = size;
+    mapping->header = *header;
+    return 0;
+}
+
+/**
+ * @brief Rellena con ceros hasta que un bloque de @p len bytes quede alineado a 8.
+ * 
+ * @param file Archivo de destino.
+ * @param len Largo del bloque recién escrito.
+ * @return 0 en caso de éxito, -1 si falló la escritura.
+ */
+static int write_padding(FILE *file, size_t len)
+{
+    static const char zeros[8] = { 0 };
+    size_t pad = (size_t)(ALIGN8(len) - len);
+    return pad > 0 && fwrite(zeros, 1, pad, file) != pad ? -1 : 0;
+}
+
+/**
+ * @brief Escribe un bloque en el archivo, rellenando con ceros hasta alinear a 8.
+ * 
+ * @param file Archivo de destino.
+ * @param data Datos a escribir.
+ * @param len Largo de los datos.
+ * @return 0 en caso de éxito, -1 si falló la escritura.
+ */
+static int write_aligned(FILE *file, const void *data, size_t len)
+{
+    if (len > 0 && fwrite(data, 1, len, file) != len) return -1;
+    return write_padding(file, len);
+}
+
+/**
+ * @brief Escribe los bytes de un segmento desde un desplazamiento hasta su final.
+ * 
+ * @param file Archivo de destino, ya posicionado.
+ * @param segment Segmento a escribir.
+ * @param from Primer byte del segmento a escribir.
+ * @return 0 en caso de éxito, -1 si falló la escritura.
+ */
+static int write_segment_from(FILE *file, const Segment *segment, size_t from)
+{
+    size_t size = segment_size(segment);
+    while (from < size) 
+    {
+        size_t len = from < segment->base_len ? segment->base_len - from : segment->chunk_size - (from - segment->base_len) % segment->chunk_size;
+        if (len > size - from) len = size - from;
+        if (fwrite(segment_at(segment, from), 1, len, file) != len) return -1;
+        from += len;
+    }
+    return 0;
+}
+
+/**
+ * @brief Escribe un segmento completo y salta el resto del espacio reservado para él.
+ * 
+ * El salto deja un hueco en el archivo, que no ocupa disco hasta que un guardado
+ * escribe ahí los registros nuevos.
+ * 
+ * @param file Archivo de destino.
+ * @param segment Segmento a escribir.
+ * @param capacity Bytes reservados para la sección, múltiplo de 8.
+ * @return 0 en caso de éxito, -1 si falló la escritura.
+ */
+static int write_segment(FILE *file, const Segment *segment, uint64_t capacity)
+{
+    if (write_segment_from(file, segment, 0) != 0) return -1;
+    return fseeko(file, (off_t)(capacity - segment_size(segment)), SEEK_CUR) == 0 ? 0 : -1;
+}
+
+/**
+ * @brief Sincroniza con el disco el directorio que contiene un archivo.
+ * 
+ * @param path Ruta del archivo.
+ * @return 0 en caso de éxito, -1 si ocurrió un error.
+ */
+int store_sync_dir(const char *path)
+{
+    char dir[PATH_MAX] = ".";
+    const char *slash = strrchr(path, '/');
+    if (slash != NULL) 
+    {
+        size_t len = slash == path ? 1 : (size_t)(slash - path);
+        if (len >= sizeof(dir)) return -1;
+        memcpy(dir, path, len);
+        dir[len] = '\0';
+    }
+
+    int fd = open(dir, O_RDONLY | O_DIRECTORY);
+    if (fd < 0) return -1;
+    int result = fsync(fd);
+    close(fd);
+    return result == 0 ? 0 : -1;
+}
+
+/**
+ * @brief Bytes a reservar para una sección que crece.
+ * 
+ * Deja libre un octavo del tamaño actual (y al menos STORE_MIN_ROOM), así el archivo
+ * se reescribe entero solo cada tanto y las tablas hash que se indexan al abrir nunca
+ * quedan muy atrasadas.
+ * 
+ * @param size Largo actual de la sección.
+ * @return Capacidad, múltiplo de 8.
+ */
+static uint64_t section_room(uint64_t size)
+{
+    return ALIGN8(size + size / 8 + STORE_MIN_ROOM);
+}
+
+/**
+ * @brief Llena los campos de la cabecera que no dependen de dónde queda cada sección.
+ * 
+ * @param header Cabecera a completar.
+ * @param image Contenido a guardar.
+ */
+static void header_fill(StoreHeader *header, const StoreImage *image)
+{
+    memcpy(header->magic, STORE_MAGIC, 8);
+    header->version = STORE_VERSION;
+    header->head = image->head;
+    header->commits_size = segment_size(image->commits);
+    header->filters_size = segment_size(image->filters);
+    header->trees_size = segment_size(image->trees);
+    header->pool_size = segment_size(image->names->pool);
+    header->names_size = segment_size(image->names->entries);
+    header->blobs_size = segment_size(image->blobs->records);
+    header->blob_data_size = segment_size(image->blobs->data);
+    header->staging_base = image->staging_base;
+    header->staging_count = image->staging_count;
+    header->dirty_count = image->dirty_count;
+    header->refs_count = (uint32_t)image->ref_count;
+    header->branch = image->branch;
+    header->pack_count = image->pack_count;
+    header->pack_id = image->pack_id;
+}
+
+/**
+ * @brief Ubica las secciones pequeñas (preparación, nombres modificados y ramas) desde un desplazamiento.
+ * 
+ * @param header Cabecera con sus cantidades ya llenas.
+ * @param offset Inicio de la primera, múltiplo de 8.
+ * @return Final de la última.
+ */
+static uint64_t header_place_small(StoreHeader *header, uint64_t offset)
+{
+    header->staging_offset = offset;
+    header->dirty_offset = ALIGN8(header->staging_offset + header->staging_count * sizeof(StagedEntry));
+    header->refs_offset = ALIGN8(header->dirty_offset + header->dirty_count * sizeof(uint32_t));
+    return header->refs_offset + (uint64_t)header->refs_count * sizeof(versionGit);
+}
+
+/**
+ * @brief Escribe las secciones pequeñas donde las ubicó header_place_small().
+ * 
+ * @param file Archivo de destino, posicionado en @c staging_offset.
+ * @param image Contenido a guardar.
+ * @return 0 en caso de éxito, -1 si falló la escritura.
+ */
+static int write_small(FILE *file, const StoreImage *image)
+{
+    return write_aligned(file, image->staging, image->staging_count * sizeof(StagedEntry)) != 0 ||
+           write_aligned(file, image->dirty, image->dirty_count * sizeof(uint32_t)) != 0 ||
+           write_aligned(file, image->refs, image->ref_count * sizeof(versionGit)) != 0 ? -1 : 0;
+}
+
+/**
+ * @brief Escribe la imagen completa en un archivo temporal y lo renombra.
+ * 
+ * Cada sección que crece queda seguida de su espacio reservado (el archivo se extiende
+ * hasta cubrirlo aunque la última sección quede vacía), y las tablas hash cubren todos
+ * los commits, cadenas y blobs. El archivo temporal se sincroniza con el disco antes
+ * del renombre y el directorio después, así el renombre nunca queda apuntando a datos
+ * que no llegaron al disco.
+ * 
+ * @param path Ruta del archivo.
+ * @param saved Cabecera en disco, que se reemplaza por la escrita.
+ * @param image Contenido a guardar.
+ * @return 0 en caso de éxito, -1 si ocurrió un error.
+ */
+static int store_rewrite(const char *path, StoreHeader *saved, const StoreImage *image)
+{
+    StoreHeader header;
+    memset(&header, 0, sizeof(header));
+    header_fill(&header, image);
+
+    size_t index_size = image->index->count ? sizeof(ObjectEntry) << image->index->bits : 0;
+    size_t names_index_size = image->names->slots ? sizeof(InternSlot) << image->names->bits : 0;
+    const ObjectTable *blob_index = &image->blobs->index;
+    size_t blob_index_size = blob_index->count ? sizeof(ObjectEntry) << blob_index->bits : 0;
+    header.commits_offset = ALIGN8(sizeof(StoreHeader));
+    header.commits_capacity = section_room(header.commits_size);
+    header.filters_offset = header.commits_offset + header.commits_capacity;
+    header.filters_capacity = section_room(header.filters_size);
+    header.trees_offset = header.filters_offset + header.filters_capacity;
+    header.trees_capacity = section_room(header.trees_size);
+    header.index_offset = header.trees_offset + header.trees_capacity;
+    header.index_bits = image->index->count ? image->index->bits : 0;
+    header.index_count = (uint32_t)image->index->count;
+    header.pool_offset = ALIGN8(header.index_offset + index_size);
+    header.pool_capacity = section_room(header.pool_size);
+    header.names_offset = header.pool_offset + header.pool_capacity;
+    header.names_capacity = section_room(header.names_size);
+    header.names_index_offset = header.names_offset + header.names_capacity;
+    header.names_index_bits = image->names->slots ? image->names->bits : 0;
+    header.names_indexed = intern_count(image->names);
+    header.blobs_offset = ALIGN8(header.names_index_offset + names_index_size);
+    header.blobs_capacity = section_room(header.blobs_size);
+    header.blob_data_offset = header.blobs_offset + header.blobs_capacity;
+    header.blob_data_capacity = section_room(header.blob_data_size);
+    header.blob_index_offset = header.blob_data_offset + header.blob_data_capacity;
+    header.blob_index_bits = blob_index->count ? blob_index->bits : 0;
+    header.blob_index_count = (uint32_t)blob_index->count;
+    header.blobs_indexed = blob_count(image->blobs);
+    header.log_offset = ALIGN8(header.blob_index_offset + blob_index_size);
+    uint64_t end = ALIGN8(header_place_small(&header, header.log_offset));
+
+    char temp_path[PATH_MAX + 4];
+    int len = snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+    if (len < 0 || (size_t)len >= sizeof(temp_path)) 
+    {
+        output_error("Error: La ruta {path:s} es demasiado larga.\n", path);
+        return -1;
+    }
+    FILE *file = fopen(temp_path, "wb");
+    if (!file) 
+    {
+        perror("Error al crear el archivo del repositorio");
+        return -1;
+    }
+
+    int failed = write_aligned(file, &header, sizeof(header)) != 0 ||
+                 write_segment(file, image->commits, header.commits_capacity) != 0 ||
+                 write_segment(file, image->filters, header.filters_capacity) != 0 ||
+                 write_segment(file, image->trees, header.trees_capacity) != 0 ||
+                 write_aligned(file, image->index->entries, index_size) != 0 ||
+                 write_segment(file, image->names->pool, header.pool_capacity) != 0 ||
+                 write_segment(file, image->names->entries, header.names_capacity) != 0 ||
+                 write_aligned(file, image->names->slots, names_index_size) != 0 ||
+                 write_segment(file, image->blobs->records, header.blobs_capacity) != 0 ||
+                 write_segment(file, image->blobs->data, header.blob_data_capacity) != 0 ||
+                 write_aligned(file, blob_index->entries, blob_index_size) != 0 ||
+                 write_small(file, image) != 0;
+    if (fflush(file) != 0 || ftruncate(fileno(file), (off_t)end) != 0 || fsync(fileno(file)) != 0) failed = 1;
+    if (fclose(file) != 0) failed = 1;
+
+    if (failed || rename(temp_path, path) != 0) 
+    {
+        perror("Error al escribir el repositorio");
+        remove(temp_path);
+        return -1;
+    }
+    *saved = header;
+    if (store_sync_dir(path) != 0) 
+    {
+        perror("Error al sincronizar el directorio del repositorio");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Indica si un segmento solo creció desde el último guardado y cabe en su espacio.
+ * 
+ * @param segment Segmento.
+ * @param saved_size Largo en disco.
+ * @param capacity Bytes reservados en disco.
+ * @return 1 si sus bytes nuevos se pueden agregar en su lugar, 0 si no.
+ */
+static int segment_fits(const Segment *segment, uint64_t saved_size, uint64_t capacity)
+{
+    return segment_size(segment) >= saved_size && segment_size(segment) <= capacity;
+}
+
+/**
+ * @brief Escribe en el espacio reservado de una sección los bytes agregados a su segmento.
+ * 
+ * @param file Archivo del repositorio.
+ * @param segment Segmento.
+ * @param offset Inicio de la sección en el archivo.
+ * @param saved_size Largo de la sección en disco.
+ * @return 0 en caso de éxito, -1 si falló la escritura.
+ */
+static int write_tail(FILE *file, const Segment *segment, uint64_t offset, uint64_t saved_size)
+{
+    if (segment_size(segment) == saved_size) return 0;
+    if (fseeko(file, (off_t)(offset + saved_size), SEEK_SET) != 0) return -1;
+    return write_segment_from(file, segment, (size_t)saved_size);
+}
+
+/**
+ * @brief Guarda solo lo que cambió desde el último guardado, sin reescribir el archivo.
+ * 
+ * Los registros nuevos van al espacio reservado de su sección y las secciones
+ * pequeñas al final del archivo; nada de lo que describe la cabecera en disco se
+ * sobrescribe. Todo se sincroniza con el disco antes de escribir la cabecera nueva, que
+ * es lo último, así un corte en cualquier punto deja el estado anterior intacto. Las
+ * tablas hash no se tocan: los commits, cadenas y blobs nuevos se indexan al abrir.
+ * 
+ * @param path Ruta del archivo.
+ * @param saved Cabecera en disco, que se reemplaza por la escrita.
+ * @param image Contenido a guardar.
+ * @return 0 en caso de éxito, 1 si hay que reescribir el archivo completo, -1 si ocurrió un error.
+ */
+static int store_append(const char *path, StoreHeader *saved, const StoreImage *image)
+{
+    if (memcmp(saved->magic, STORE_MAGIC, 8) != 0 || saved->version != STORE_VERSION) return 1;
+    if (!segment_fits(image->commits, saved->commits_size, saved->commits_capacity) ||
+        !segment_fits(image->filters, saved->filters_size, saved->filters_capacity) ||
+        !segment_fits(image->trees, saved->trees_size, saved->trees_capacity) ||
+        !segment_fits(image->names->pool, saved->pool_size, saved->pool_capacity) ||
+        !segment_fits(image->names->entries, saved->names_size, saved->names_capacity) ||
+        !segment_fits(image->blobs->records, saved->blobs_size, saved->blobs_capacity) ||
+        !segment_fits(image->blobs->data, saved->blob_data_size, saved->blob_data_capacity)) return 1;
+
+    FILE *file = fopen(path, "r+b");
+    if (!file) return 1;
+
+    StoreHeader current;
+    struct stat info;
+    if (fread(&current, sizeof(current), 1, file) != 1 || memcmp(&current, saved, sizeof(current)) != 0 ||
+        fstat(fileno(file), &info) != 0) 
+    {
+        fclose(file);
+        return 1;
+    }
+
+    StoreHeader header = *saved;
+    header_fill(&header, image);
+    uint64_t end = header_place_small(&header, ALIGN8((uint64_t)info.st_size));
+    if (end - header.log_offset > header.log_offset / 8 + STORE_MIN_ROOM) 
+    {
+        fclose(file);
+        return 1;
+    }
+
+    int failed = write_tail(file, image->commits, header.commits_offset, saved->commits_size) != 0 ||
+                 write_tail(file, image->filters, header.filters_offset, saved->filters_size) != 0 ||
+                 write_tail(file, image->trees, header.trees_offset, saved->trees_size) != 0 ||
+                 write_tail(file, image->names->pool, header.pool_offset, saved->pool_size) != 0 ||
+                 write_tail(file, image->names->entries, header.names_offset, saved->names_size) != 0 ||
+                 write_tail(file, image->blobs->records, header.blobs_offset, saved->blobs_size) != 0 ||
+                 write_tail(file, image->blobs->data, header.blob_data_offset, saved->blob_data_size) != 0 ||
+                 fseeko(file, (off_t)header.staging_offset, SEEK_SET) != 0 ||
+                 write_small(file, image) != 0;
+    if (failed || fflush(file) != 0 || fsync(fileno(file)) != 0 ||
+        fseeko(file, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(header), 1, file) != 1 ||
+        fflush(file) != 0 || fsync(fileno(file)) != 0) failed = 1;
+    if (fclose(file) != 0) failed = 1;
+
+    if (failed) 
+    {
+        perror("Error al escribir el repositorio");
+        return -1;
+    }
+    *saved = header;
+    return 0;
+}
+
+/**
+ * @brief Guarda la imagen, agregando lo nuevo si cabe o reescribiendo el archivo.
+ * 
+ * @param path Ruta del archivo.
+ * @param mapping Mapeo del repositorio, con la cabecera que hay en disco.
+ * @param image Contenido a guardar.
+ * @param rewrite 1 para reescribir el archivo completo.
+ * @return 0 en caso de éxito, -1 si ocurrió un error.
+ */
+int store_save(const char *path, StoreMapping *mapping, const StoreImage *image, int rewrite)
+{
+    int result = rewrite ? 1 : store_append(path, &mapping->header, image);
+    return result > 0 ? store_rewrite(path, &mapping->header, image) : result;
+}
+
+/**
+ * @brief Cierra el mapeo del archivo del repositorio.
+ * 
+ * @param mapping Mapeo abierto con store_open().
+ */
+void store_close(StoreMapping *mapping)
+{
+    if (mapping->data) munmap(mapping->data, mapping->size);
+    mapping->data = NULL;
+    mapping->size = 0;
+    memset(&mapping->header, 0, sizeof(mapping->header));
+}
@@ -0,0 +1,260 @@
+/**
+ * @file store.h
+ * @brief Formato binario en disco del repositorio y segmentos mapeados en memoria.
+ * 
+ * El repositorio se guarda en un único archivo con una cabecera, la tabla de commits,
+ * los filtros de rutas de cada commit, los nodos de los árboles de archivos, la tabla
+ * de identificadores, el pool de cadenas con su tabla de internación, los blobs con el
+ * contenido de los archivos y su índice, una copia del área de preparación (con los
+ * datos de stat de cada archivo) y la tabla de ramas. Los bytes de los blobs
+ * empaquetados viven aparte, en el pack que nombra la cabecera (ver pack.h).
+ * Todas las secciones usan registros de ancho fijo sin punteros, por lo que al abrir el
+ * archivo con mmap se usan directamente, sin interpretar ni reservar memoria por nodo.
+ * 
+ * Cada sección que solo crece deja espacio libre a continuación (un hueco del archivo,
+ * que no ocupa disco). Un guardado normal escribe ahí los registros nuevos, agrega al
+ * final las secciones pequeñas que cambian enteras (preparación, nombres modificados y
+ * ramas) y recién entonces reescribe la cabecera; las tablas hash en disco siguen
+ * cubriendo lo que había en la última reescritura completa y el resto se indexa al
+ * abrir. Cuando algo no cabe, el archivo se reescribe entero.
+ * 
+ * @authors
+ * - Benjamin Sanhueza (bsanhuez@umag.cl)
+ * - Nicolas Mancilla (nicmanci@umag.cl)
+ */
+
+#ifndef STORE_H
+#define STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "objstore.h"
+#include "arena.h"
+#include "rcu.h"
+#include "statcache.h"
+
+struct InternTable;
+struct BlobStore;
+struct versionGit;
+
+#define STORE_MAGIC "UGITREPO" ///< Firma de los primeros ocho bytes del archivo.
+#define STORE_VERSION 13 ///< Versión del formato en disco.
+
+/**
+ * @brief Cabecera del archivo del repositorio.
+ * 
+ * Los desplazamientos se miden desde el inicio del archivo y están alineados a 8 bytes.
+ * Los enteros se guardan en el orden de bytes de la máquina.
+ */
+typedef struct StoreHeader 
+{
+    char magic[8]; ///< Firma STORE_MAGIC.
+    uint32_t version; ///< Versión del formato.
+    uint32_t head; ///< Índice del último commit, o UINT32_MAX si no hay commits.
+    uint64_t commits_offset; ///< Inicio de la tabla de commits.
+    uint64_t commits_size; ///< Bytes de la tabla de commits.
+    uint64_t commits_capacity; ///< Bytes reservados para la tabla de commits, incluyendo el espacio libre.
+    uint64_t filters_offset; ///< Inicio de los filtros de rutas (uno por commit).
+    uint64_t filters_size; ///< Bytes de los filtros de rutas.
+    uint64_t filters_capacity; ///< Bytes reservados para los filtros de rutas.
+    uint64_t trees_offset; ///< Inicio de los nodos de los árboles de archivos.
+    uint64_t trees_size; ///< Bytes de los nodos de árboles.
+    uint64_t trees_capacity; ///< Bytes reservados para los nodos de árboles.
+    uint64_t index_offset; ///< Inicio de la tabla de identificadores.
+    uint32_t index_bits; ///< Logaritmo de la capacidad de la tabla de identificadores.
+    uint32_t index_count; ///< Cantidad de entradas ocupadas (los primeros commits; el resto se indexa al abrir).
+    uint64_t pool_offset; ///< Inicio del pool de cadenas.
+    uint64_t pool_size; ///< Bytes del pool de cadenas.
+    uint64_t pool_capacity; ///< Bytes reservados para el pool de cadenas.
+    uint64_t names_offset; ///< Inicio de la tabla de identificador de cadena a InternEntry.
+    uint64_t names_size; ///< Bytes de la tabla de cadenas.
+    uint64_t names_capacity; ///< Bytes reservados para la tabla de cadenas.
+    uint64_t names_index_offset; ///< Inicio de la tabla hash de búsqueda de cadenas.
+    uint32_t names_index_bits; ///< Logaritmo de la capacidad de la tabla hash (0 si está vacía).
+    uint32_t names_indexed; ///< Cadenas que cubre la tabla hash; las siguientes se indexan al abrir.
+    uint64_t blobs_offset; ///< Inicio de la tabla de blobs (registros BlobRecord).
+    uint64_t blobs_size; ///< Bytes de la tabla de blobs.
+    uint64_t blobs_capacity; ///< Bytes reservados para la tabla de blobs.
+    uint64_t blob_data_offset; ///< Inicio del contenido de los blobs.
+    uint64_t blob_data_size; ///< Bytes del contenido de los blobs.
+    uint64_t blob_data_capacity; ///< Bytes reservados para el contenido de los blobs.
+    uint64_t blob_index_offset; ///< Inicio de la tabla de identificador a blob.
+    uint32_t blob_index_bits; ///< Logaritmo de la capacidad de la tabla de identificador a blob.
+    uint32_t blob_index_count; ///< Cantidad de blobs en la tabla de identificador a blob.
+    uint32_t blobs_indexed; ///< Blobs que cubre la tabla de identificador a blob; los siguientes se indexan al abrir.
+    uint32_t staging_base; ///< Raíz del árbol del que parte el área de preparación.
+    uint64_t log_offset; ///< Inicio de la zona donde los guardados agregan las secciones pequeñas.
+    uint64_t staging_offset; ///< Inicio de los registros StagedEntry en preparación.
+    uint64_t staging_count; ///< Cantidad de archivos en preparación.
+    uint64_t dirty_offset; ///< Inicio de los identificadores modificados desde @c staging_base.
+    uint64_t dirty_count; ///< Cantidad de nombres modificados.
+    uint64_t refs_offset; ///< Inicio de la tabla de ramas (registros versionGit).
+    uint32_t refs_count; ///< Cantidad de ramas.
+    uint32_t branch; ///< Rama actual, o UINT32_MAX si HEAD está desacoplado.
+    uint32_t pack_count; ///< Objetos del pack con los blobs empaquetados, o 0 si no hay pack.
+    object_id pack_id; ///< Identificador del pack (ver pack.h).
+} StoreHeader;
+
+/**
+ * @brief Arreglo de bytes que solo crece, con una parte base opcionalmente mapeada.
+ * 
+ * Los primeros @c base_len bytes viven en el archivo mapeado (solo lectura) y los
+ * siguientes en trozos de @c chunk_size bytes tomados de una arena. Un desplazamiento
+ * identifica un dato en cualquiera de las partes, así que los datos nuevos y los
+ * cargados se tratan igual. Los trozos nunca se mueven, por lo que los punteros a
+ * datos ya agregados siguen siendo válidos.
+ * 
+ * Un lector puede usar segment_at() mientras el escritor agrega datos, siempre que
+ * solo lea desplazamientos ya publicados: el directorio de trozos se reemplaza por una
+ * copia al crecer y el anterior se retira hasta segment_release().
+ */
+typedef struct Segment 
+{
+    const unsigned char *base; ///< Parte mapeada, o NULL.
+    size_t base_len; ///< Bytes de la parte mapeada.
+    Arena *arena; ///< Arena de donde salen los trozos.
+    size_t chunk_size; ///< Bytes de cada trozo (múltiplo del tamaño de registro).
+    unsigned char **chunks; ///< Directorio de trozos agregados en esta sesión.
+    size_t chunk_count; ///< Trozos en uso.
+    size_t chunk_cap; ///< Capacidad del directorio.
+    size_t tail_len; ///< Bytes agregados en esta sesión, incluyendo relleno.
+    RetireList retired; ///< Directorios reemplazados que algún lector aún puede estar usando.
+} Segment;
+
+/**
+ * @brief Archivo del repositorio abierto con mmap.
+ */
+typedef struct StoreMapping 
+{
+    void *data; ///< Inicio del mapeo, o NULL si no hay archivo abierto.
+    size_t size; ///< Largo del mapeo.
+    StoreHeader header; ///< Cabecera que hay en disco según el último store_open() o store_save(), o en ceros.
+} StoreMapping;
+
+/**
+ * @brief Contenido del repositorio a guardar o recién cargado.
+ */
+typedef struct StoreImage 
+{
+    Segment *commits; ///< Registros de commits.
+    Segment *filters; ///< Filtros de rutas, paralelos a @c commits.
+    Segment *trees; ///< Nodos de los árboles de archivos.
+    struct InternTable *names; ///< Cadenas internadas (pool y tablas).
+    ObjectTable *index; ///< Tabla de identificador a commit.
+    struct BlobStore *blobs; ///< Blobs con su índice.
+    uint32_t head; ///< Índice del último commit.
+    const StagedEntry *staging; ///< Archivos en preparación, con sus datos de stat.
+    size_t staging_count; ///< Registros en @c staging.
+    uint32_t staging_base; ///< Raíz del árbol del que parte el área de preparación.
+    const uint32_t *dirty; ///< Identificadores de los nombres modificados desde @c staging_base.
+    size_t dirty_count; ///< Elementos de @c dirty.
+    const struct versionGit *refs; ///< Tabla de ramas.
+    size_t ref_count; ///< Elementos de @c refs.
+    uint32_t branch; ///< Rama actual, o UINT32_MAX si HEAD está desacoplado.
+    uint32_t pack_count; ///< Objetos del pack, o 0 si no hay pack.
+    object_id pack_id; ///< Identificador del pack.
+    uint32_t commits_indexed; ///< Al abrir, commits que ya están en @c index.
+    uint32_t names_indexed; ///< Al abrir, cadenas que ya están en la tabla hash de @c names.
+    uint32_t blobs_indexed; ///< Al abrir, blobs que ya cubre el índice de @c blobs.
+} StoreImage;
+
+/**
+ * @brief Prepara un segmento vacío.
+ * 
+ * @param segment Segmento.
+ * @param arena Arena de donde se tomarán los trozos.
+ * @param chunk_size Bytes por trozo; un dato agregado nunca se divide en zonas separadas.
+ */
+void segment_init(Segment *segment, Arena *arena, size_t chunk_size);
+
+/**
+ * @brief Largo total de un segmento.
+ * 
+ * @param segment Segmento.
+ * @return Bytes de la parte mapeada más los de la parte propia.
+ */
+size_t segment_size(const Segment *segment);
+
+/**
+ * @brief Obtiene la dirección de un desplazamiento dentro del segmento.
+ * 
+ * @param segment Segmento.
+ * @param offset Desplazamiento menor que segment_size().
+ * @return Puntero al dato.
+ */
+const void *segment_at(const Segment *segment, size_t offset);
+
+/**
+ * @brief Agrega datos al final del segmento.
+ * 
+ * Si el dato no cabe en el trozo actual, el resto del trozo se rellena con ceros y
+ * el dato se copia al inicio de un trozo nuevo. Un dato mayor que un trozo ocupa
+ * varios trozos contiguos, así que siempre queda en una sola zona de memoria.
+ * 
+ * @param segment Segmento.
+ * @param data Datos a copiar.
+ * @param len Largo de los datos.
+ * @param offset Desplazamiento donde quedaron los datos (puede ser NULL).
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+int segment_append(Segment *segment, const void *data, size_t len, size_t *offset);
+
+/**
+ * @brief Olvida el contenido del segmento y libera su directorio de trozos.
+ * 
+ * Los trozos pertenecen a la arena y se liberan con arena_reset(). No debe haber
+ * lectores usando el segmento.
+ * 
+ * @param segment Segmento.
+ */
+void segment_release(Segment *segment);
+
+/**
+ * @brief Abre el archivo del repositorio y llena la imagen con sus secciones.
+ * 
+ * Los segmentos y la tabla de la imagen quedan apuntando al mapeo, que debe seguir
+ * abierto mientras se usen.
+ * 
+ * @param path Ruta del archivo.
+ * @param mapping Mapeo resultante.
+ * @param image Imagen con segmentos vacíos a llenar.
+ * @return 0 en caso de éxito, 1 si el archivo no existe, -1 si es inválido o hubo un error.
+ */
+int store_open(const char *path, StoreMapping *mapping, StoreImage *image);
+
+/**
+ * @brief Guarda la imagen en disco.
+ * 
+ * Si la cabecera de @p mapping sigue siendo la del archivo y todo cabe en el espacio
+ * reservado, solo escribe los datos agregados desde el último guardado y las secciones
+ * pequeñas, los sincroniza con el disco y al final reescribe la cabecera. Si no (o si se
+ * pide con @p rewrite), escribe el archivo completo en uno temporal, lo sincroniza y lo
+ * renombra. En ambos casos ni una falla ni un corte de energía dejan el repositorio a
+ * medio escribir, y un mapeo previo del mismo archivo sigue siendo válido.
+ * 
+ * @param path Ruta del archivo.
+ * @param mapping Mapeo del repositorio; su cabecera se actualiza con la escrita.
+ * @param image Contenido a guardar.
+ * @param rewrite 1 para reescribir el archivo completo aunque los datos quepan.
+ * @return 0 en caso de éxito, -1 si ocurrió un error.
+ */
+int store_save(const char *path, StoreMapping *mapping, const StoreImage *image, int rewrite);
+
+/**
+ * @brief Sincroniza con el disco el directorio que contiene un archivo.
+ * 
+ * Después de renombrar un archivo, hace durable la entrada nueva del directorio.
+ * 
+ * @param path Ruta del archivo.
+ * @return 0 en caso de éxito, -1 si ocurrió un error.
+ */
+int store_sync_dir(const char *path);
+
+/**
+ * @brief Cierra el mapeo del archivo del repositorio.
+ * 
+ * @param mapping Mapeo abierto con store_open().
+ */
+void store_close(StoreMapping *mapping);
+
+#endif
@@ -0,0 +1,750 @@
+/**
+ * @file tree.c
+ * @brief Implementación de los árboles de archivos con estructura compartida (HAMT).
+ * 
+ * @authors
+ * Benjamin Sanhueza (bsanhuez@umag.cl)
+ * Nicolas Mancilla (nicmanci@umag.cl)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tree.h"
+#include "output.h"
+
+/// Indica si un nodo es una hoja.
+#define NODE_IS_LEAF(node) ((node)->header & 1u)
+
+/// Cantidad de nombres en el subárbol de un nodo.
+#define NODE_COUNT(node) ((node)->header >> 1)
+
+/// Enteros por entrada de una hoja: hash, nombre y blob.
+#define LEAF_WORDS 3
+
+/// Modo con que se serializa cada archivo de una hoja, el de un archivo normal en Git.
+#define LEAF_MODE "100644"
+
+/**
+ * @brief Nombre de un archivo junto a su hash y su contenido, usado al construir y comparar árboles.
+ */
+typedef struct TreeEntry 
+{
+    uint32_t hash; ///< Hash del nombre.
+    uint32_t name; ///< Identificador del nombre.
+    uint32_t blob; ///< Índice del blob del archivo.
+} TreeEntry;
+
+/**
+ * @brief Arreglo dinámico de entradas.
+ */
+typedef struct EntryList 
+{
+    TreeEntry *items; ///< Entradas.
+    size_t count; ///< Entradas usadas.
+    size_t cap; ///< Capacidad.
+} EntryList;
+
+/**
+ * @brief Obtiene un nodo a partir de su desplazamiento.
+ * 
+ * @param store Segmentos del árbol.
+ * @param offset Desplazamiento (distinto de TREE_EMPTY).
+ * @return El nodo.
+ */
+static const TreeNode *node_at(const TreeStore *store, uint32_t offset)
+{
+    return (const TreeNode *)segment_at(store->nodes, offset);
+}
+
+/**
+ * @brief Obtiene el texto de un nombre.
+ * 
+ * @param store Segmentos del árbol.
+ * @param name Identificador del nombre.
+ * @return El nombre.
+ */
+static const char *name_at(const TreeStore *store, uint32_t name)
+{
+    return intern_string(store->names, name);
+}
+
+/**
+ * @brief Parte del hash que elige el hijo en una profundidad dada.
+ * 
+ * Se usan primero los bits más significativos, de modo que ordenar por hash agrupa
+ * las entradas de cada hijo en todos los niveles.
+ * 
+ * @param hash Hash del nombre.
+ * @param depth Profundidad del nodo interno.
+ * @return Número de hijo entre 0 y 31.
+ */
+static unsigned int chunk_of(uint32_t hash, int depth)
+{
+    return (hash >> (32 - TREE_FANOUT_BITS * (depth + 1))) & ((1u << TREE_FANOUT_BITS) - 1);
+}
+
+/**
+ * @brief Cuenta los bits en 1 de un mapa de hijos.
+ * 
+ * @param bitmap Mapa de bits.
+ * @return Cantidad de bits en 1.
+ */
+static int count_bits(uint32_t bitmap)
+{
+    int count = 0;
+    for (; bitmap != 0; bitmap &= bitmap - 1) count++;
+    return count;
+}
+
+/**
+ * @brief Obtiene el hijo de un nodo interno para un número de hijo.
+ * 
+ * @param node Nodo interno.
+ * @param chunk Número de hijo.
+ * @return Desplazamiento del hijo, o TREE_EMPTY si no existe.
+ */
+static uint32_t child_at(const TreeNode *node, unsigned int chunk)
+{
+    uint32_t bit = 1u << chunk;
+    if (!(node->bitmap & bit)) return TREE_EMPTY;
+    return node->items[count_bits(node->bitmap & (bit - 1))];
+}
+
+/**
+ * @brief Compara dos nombres por (hash, nombre), el orden de las hojas.
+ * 
+ * Dos nombres iguales tienen el mismo identificador, así que el texto solo se
+ * compara cuando dos nombres distintos tienen el mismo hash.
+ * 
+ * @return Negativo, cero o positivo como strcmp.
+ */
+static int compare_keys(const TreeStore *store, uint32_t hash_a, uint32_t name_a, uint32_t hash_b, uint32_t name_b)
+{
+    if (hash_a != hash_b) return hash_a < hash_b ? -1 : 1;
+    if (name_a == name_b) return 0;
+    return strcmp(name_at(store, name_a), name_at(store, name_b));
+}
+
+/**
+ * @brief Compara dos cambios por (hash, identificador) (para qsort).
+ * 
+ * @param a Primer cambio.
+ * @param b Segundo cambio.
+ * @return Negativo, cero o positivo.
+ */
+static int compare_changes(const void *a, const void *b)
+{
+    const TreeChange *change_a = (const TreeChange *)a;
+    const TreeChange *change_b = (const TreeChange *)b;
+    if (change_a->hash != change_b->hash) return change_a->hash < change_b->hash ? -1 : 1;
+    if (change_a->name != change_b->name) return change_a->name < change_b->name ? -1 : 1;
+    return 0;
+}
+
+/**
+ * @brief Agrega una entrada al final de la lista.
+ * 
+ * @param list Lista.
+ * @param hash Hash del nombre.
+ * @param name Desplazamiento del nombre.
+ * @param blob Índice del blob.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+static int list_push(EntryList *list, uint32_t hash, uint32_t name, uint32_t blob)
+{
+    if (list->count == list->cap) 
+    {
+        size_t capacity = list->cap ? list->cap * 2 : 32;
+        TreeEntry *items = (TreeEntry *)realloc(list->items, capacity * sizeof(TreeEntry));
+        if (!items) 
+        {
+            perror("Error al asignar memoria para el árbol");
+            return -1;
+        }
+        list->items = items;
+        list->cap = capacity;
+    }
+    list->items[list->count].hash = hash;
+    list->items[list->count].name = name;
+    list->items[list->count].blob = blob;
+    list->count++;
+    return 0;
+}
+
+/**
+ * @brief Agrega a la lista todos los nombres de un subárbol, en orden (hash, nombre).
+ * 
+ * @param store Segmentos del árbol.
+ * @param offset Raíz del subárbol.
+ * @param list Lista de destino.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+static int collect(const TreeStore *store, uint32_t offset, EntryList *list)
+{
+    if (offset == TREE_EMPTY) return 0;
+
+    const TreeNode *node = node_at(store, offset);
+    if (NODE_IS_LEAF(node)) 
+    {
+        for (uint32_t i = 0; i < NODE_COUNT(node); i++) 
+        {
+            const uint32_t *item = node->items + LEAF_WORDS * i;
+            if (list_push(list, item[0], item[1], item[2]) != 0) return -1;
+        }
+        return 0;
+    }
+
+    int children = count_bits(node->bitmap);
+    for (int i = 0; i < children; i++) 
+    {
+        if (collect(store, node->items[i], list) != 0) return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Agrega un nodo al segmento de nodos.
+ * 
+ * @param store Segmentos del árbol.
+ * @param node Nodo armado en memoria temporal.
+ * @param size Bytes del nodo.
+ * @param offset Desplazamiento resultante.
+ * @return 0 en caso de éxito, -1 si no hay memoria o el segmento está lleno.
+ */
+static int append_node(TreeStore *store, const TreeNode *node, size_t size, uint32_t *offset)
+{
+    size_t position;
+    if (segment_append(store->nodes, node, size, &position) != 0) return -1;
+    if (position >= TREE_EMPTY) 
+    {
+        output_error("Error: El segmento de árboles está lleno.\n");
+        return -1;
+    }
+    *offset = (uint32_t)position;
+    return 0;
+}
+
+/**
+ * @brief Escribe una hoja con las entradas dadas (ya ordenadas).
+ * 
+ * El identificador de la hoja es el hash de sus entradas serializadas como en un objeto
+ * tree de Git: "<modo> <nombre>\0" seguido de los bytes del identificador del blob.
+ * 
+ * @param store Segmentos del árbol.
+ * @param entries Entradas de la hoja.
+ * @param count Cantidad de entradas.
+ * @param offset Desplazamiento de la hoja creada.
+ * @return 0 en caso de éxito, -1 si ocurre un error.
+ */
+static int write_leaf(TreeStore *store, const TreeEntry *entries, size_t count, uint32_t *offset)
+{
+    size_t node_size = sizeof(TreeNode) + LEAF_WORDS * count * sizeof(uint32_t);
+    size_t text_size = 0;
+    for (size_t i = 0; i < count; i++) text_size += sizeof(LEAF_MODE) + strlen(name_at(store, entries[i].name)) + 1 + SHA1_DIGEST_SIZE;
+
+    TreeNode *node = (TreeNode *)malloc(node_size);
+    char *text = (char *)malloc(text_size + 1);
+    if (!node || !text) 
+    {
+        perror("Error al asignar memoria para el árbol");
+        free(node);
+        free(text);
+        return -1;
+    }
+
+    size_t len = 0;
+    for (size_t i = 0; i < count; i++) 
+    {
+        len += (size_t)sprintf(text + len, LEAF_MODE " %s", name_at(store, entries[i].name)) + 1;
+        memcpy(text + len, blob_record(store->blobs, entries[i].blob)->id.hash, SHA1_DIGEST_SIZE);
+        len += SHA1_DIGEST_SIZE;
+        node->items[LEAF_WORDS * i] = entries[i].hash;
+        node->items[LEAF_WORDS * i + 1] = entries[i].name;
+        node->items[LEAF_WORDS * i + 2] = entries[i].blob;
+    }
+    node->header = (uint32_t)count << 1 | 1u;
+    node->bitmap = 0;
+    object_hash("tree", text, len, &node->id);
+
+    int result = append_node(store, node, node_size, offset);
+    free(node);
+    free(text);
+    return result;
+}
+
+/**
+ * @brief Escribe un nodo interno con los hijos dados.
+ * 
+ * El identificador del nodo es el hash de (número de hijo, identificador del hijo)
+ * para cada hijo presente.
+ * 
+ * @param store Segmentos del árbol.
+ * @param children Hijos indexados por número de hijo (TREE_EMPTY si no existe).
+ * @param offset Desplazamiento del nodo creado.
+ * @return 0 en caso de éxito, -1 si ocurre un error.
+ */
+static int write_internal(TreeStore *store, const uint32_t children[32], uint32_t *offset)
+{
+    uint32_t buffer[sizeof(TreeNode) / sizeof(uint32_t) + 32];
+    TreeNode *node = (TreeNode *)buffer;
+    unsigned char text[32 * (1 + SHA1_DIGEST_SIZE)];
+    size_t len = 0;
+    uint32_t total = 0;
+    int count = 0;
+
+    node->bitmap = 0;
+    for (unsigned int chunk = 0; chunk < 32; chunk++) 
+    {
+        if (children[chunk] == TREE_EMPTY) continue;
+        const TreeNode *child = node_at(store, children[chunk]);
+        node->bitmap |= 1u << chunk;
+        node->items[count++] = children[chunk];
+        total += NODE_COUNT(child);
+        text[len++] = (unsigned char)chunk;
+        memcpy(text + len, child->id.hash, SHA1_DIGEST_SIZE);
+        len += SHA1_DIGEST_SIZE;
+    }
+    node->header = total << 1;
+    object_hash("tree", text, len, &node->id);
+
+    return append_node(store, node, sizeof(TreeNode) + (size_t)count * sizeof(uint32_t), offset);
+}
+
+/**
+ * @brief Construye el subárbol canónico para un conjunto de entradas ordenadas.
+ * 
+ * Un subárbol es hoja si tiene a lo más TREE_BUCKET_MAX nombres o está en la
+ * profundidad máxima; si no, reparte las entradas entre sus hijos.
+ * 
+ * @param store Segmentos del árbol.
+ * @param entries Entradas ordenadas por (hash, nombre).
+ * @param count Cantidad de entradas.
+ * @param depth Profundidad del subárbol.
+ * @param offset Raíz del subárbol creado.
+ * @return 0 en caso de éxito, -1 si ocurre un error.
+ */
+static int build(TreeStore *store, const TreeEntry *entries, size_t count, int depth, uint32_t *offset)
+{
+    if (count == 0) 
+    {
+        *offset = TREE_EMPTY;
+        return 0;
+    }
+    if (count <= TREE_BUCKET_MAX || depth == TREE_MAX_DEPTH) 
+    {
+        return write_leaf(store, entries, count, offset);
+    }
+
+    uint32_t children[32];
+    for (int i = 0; i < 32; i++) children[i] = TREE_EMPTY;
+
+    size_t start = 0;
+    while (start < count) 
+    {
+        unsigned int chunk = chunk_of(entries[start].hash, depth);
+        size_t end = start;
+        while (end < count && chunk_of(entries[end].hash, depth) == chunk) end++;
+        if (build(store, entries + start, end - start, depth + 1, &children[chunk]) != 0) return -1;
+        start = end;
+    }
+    return write_internal(store, children, offset);
+}
+
+/**
+ * @brief Aplica cambios ordenados a una hoja (o al árbol vacío).
+ * 
+ * @param store Segmentos del árbol.
+ * @param offset Hoja original, o TREE_EMPTY.
+ * @param depth Profundidad de la hoja.
+ * @param changes Cambios ordenados y sin repetidos.
+ * @param count Cantidad de cambios.
+ * @param result Raíz del subárbol resultante.
+ * @return 0 en caso de éxito, -1 si ocurre un error.
+ */
+static int apply_leaf(TreeStore *store, uint32_t offset, int depth, const TreeChange *changes, size_t count, uint32_t *result)
+{
+    const TreeNode *node = offset == TREE_EMPTY ? NULL : node_at(store, offset);
+    uint32_t leaf_count = node ? NODE_COUNT(node) : 0;
+    EntryList merged = { NULL, 0, 0 };
+    int changed = 0, status = 0;
+    size_t i = 0, j = 0;
+
+    while (status == 0 && (i < leaf_count || j < count)) 
+    {
+        const uint32_t *item = node ? node->items + LEAF_WORDS * i : NULL;
+        int cmp;
+        if (i == leaf_count) cmp = 1;
+        else if (j == count) cmp = -1;
+        else cmp = compare_keys(store, item[0], item[1], changes[j].hash, changes[j].name);
+
+        if (cmp < 0) 
+        {
+            status = list_push(&merged, item[0], item[1], item[2]);
+            i++;
+        }
+        else if (cmp == 0) 
+        {
+            if (changes[j].blob != BLOB_NONE) status = list_push(&merged, item[0], item[1], changes[j].blob);
+            if (changes[j].blob != item[2]) changed = 1;
+            i++;
+            j++;
+        }
+        else 
+        {
+            if (changes[j].blob != BLOB_NONE) 
+            {
+                status = list_push(&merged, changes[j].hash, changes[j].name, changes[j].blob);
+                changed = 1;
+            }
+            j++;
+        }
+    }
+
+    if (status == 0) 
+    {
+        if (changed) status = build(store, merged.items, merged.count, depth, result);
+        else *result = offset;
+    }
+    free(merged.items);
+    return status;
+}
+
+/**
+ * @brief Aplica cambios ordenados a un subárbol, copiando solo los caminos afectados.
+ * 
+ * @param store Segmentos del árbol.
+ * @param offset Raíz original del subárbol.
+ * @param depth Profundidad del subárbol.
+ * @param changes Cambios ordenados y sin repetidos.
+ * @param count Cantidad de cambios.
+ * @param result Raíz del subárbol resultante.
+ * @return 0 en caso de éxito, -1 si ocurre un error.
+ */
+static int apply(TreeStore *store, uint32_t offset, int depth, const TreeChange *changes, size_t count, uint32_t *result)
+{
+    if (count == 0) 
+    {
+        *result = offset;
+        return 0;
+    }
+    if (offset == TREE_EMPTY || NODE_IS_LEAF(node_at(store, offset))) 
+    {
+        return apply_leaf(store, offset, depth, changes, count, result);
+    }
+
+    const TreeNode *node = node_at(store, offset);
+    uint32_t children[32];
+    for (unsigned int chunk = 0; chunk < 32; chunk++) children[chunk] = child_at(node, chunk);
+
+    int changed = 0;
+    size_t start = 0;
+    while (start < count) 
+    {
+        unsigned int chunk = chunk_of(changes[start].hash, depth);
+        size_t end = start;
+        while (end < count && chunk_of(changes[end].hash, depth) == chunk) end++;
+
+        uint32_t child;
+        if (apply(store, children[chunk], depth + 1, changes + start, end - start, &child) != 0) return -1;
+        if (child != children[chunk]) 
+        {
+            children[chunk] = child;
+            changed = 1;
+        }
+        start = end;
+    }
+
+    if (!changed) 
+    {
+        *result = offset;
+        return 0;
+    }
+
+    uint32_t total = 0;
+    for (unsigned int chunk = 0; chunk < 32; chunk++) 
+    {
+        if (children[chunk] != TREE_EMPTY) total += NODE_COUNT(node_at(store, children[chunk]));
+    }
+    if (total == 0) 
+    {
+        *result = TREE_EMPTY;
+        return 0;
+    }
+    if (total > TREE_BUCKET_MAX) return write_internal(store, children, result);
+
+    EntryList entries = { NULL, 0, 0 };
+    int status = 0;
+    for (unsigned int chunk = 0; chunk < 32 && status == 0; chunk++) 
+    {
+        status = collect(store, children[chunk], &entries);
+    }
+    if (status == 0) status = write_leaf(store, entries.items, entries.count, result);
+    free(entries.items);
+    return status;
+}
+
+/**
+ * @brief Cantidad de nombres de un árbol.
+ * 
+ * @param store Segmentos del árbol.
+ * @param root Raíz.
+ * @return Cantidad de archivos.
+ */
+uint32_t tree_count(const TreeStore *store, uint32_t root)
+{
+    return root == TREE_EMPTY ? 0 : NODE_COUNT(node_at(store, root));
+}
+
+/**
+ * @brief Identificador de un árbol; el vacío es el hash de un árbol sin nombres.
+ * 
+ * @param store Segmentos del árbol.
+ * @param root Raíz.
+ * @param id Identificador resultante.
+ */
+void tree_id(const TreeStore *store, uint32_t root, object_id *id)
+{
+    if (root == TREE_EMPTY) 
+    {
+        object_hash("tree", "", 0, id);
+        return;
+    }
+    *id = node_at(store, root)->id;
+}
+
+/**
+ * @brief Busca el contenido de un nombre en un árbol, bajando por su hash.
+ * 
+ * @param store Segmentos del árbol.
+ * @param root Raíz.
+ * @param name Identificador del nombre buscado.
+ * @param hash Hash del nombre.
+ * @return Índice del blob, o BLOB_NONE si el nombre no está.
+ */
+uint32_t tree_lookup(const TreeStore *store, uint32_t root, uint32_t name, uint32_t hash)
+{
+    uint32_t offset = root;
+    for (int depth = 0; offset != TREE_EMPTY; depth++) 
+    {
+        const TreeNode *node = node_at(store, offset);
+        if (NODE_IS_LEAF(node)) 
+        {
+            for (uint32_t i = 0; i < NODE_COUNT(node); i++) 
+            {
+                if (node->items[LEAF_WORDS * i + 1] == name) return node->items[LEAF_WORDS * i + 2];
+            }
+            return BLOB_NONE;
+        }
+        offset = child_at(node, chunk_of(hash, depth));
+    }
+    return BLOB_NONE;
+}
+
+/**
+ * @brief Aplica cambios a un árbol, quitando antes los cambios repetidos.
+ * 
+ * Los cambios se ordenan por (hash, identificador) y luego, dentro de cada grupo
+ * con el mismo hash, por nombre, que es el orden de las hojas.
+ * 
+ * @param store Segmentos del árbol.
+ * @param root Raíz original.
+ * @param changes Cambios (se ordenan en el lugar).
+ * @param count Cantidad de cambios.
+ * @param new_root Raíz resultante.
+ * @return 0 en caso de éxito, -1 si ocurre un error.
+ */
+int tree_apply(TreeStore *store, uint32_t root, TreeChange *changes, size_t count, uint32_t *new_root)
+{
+    qsort(changes, count, sizeof(TreeChange), compare_changes);
+
+    size_t unique = 0;
+    for (size_t i = 0; i < count; i++) 
+    {
+        if (unique > 0 && compare_changes(&changes[unique - 1], &changes[i]) == 0) 
+        {
+            changes[unique - 1] = changes[i];
+        }
+        else 
+        {
+            changes[unique++] = changes[i];
+        }
+    }
+    for (size_t i = 1; i < unique; i++) 
+    {
+        TreeChange change = changes[i];
+        size_t j = i;
+        for (; j > 0 && compare_keys(store, changes[j - 1].hash, changes[j - 1].name, change.hash, change.name) > 0; j--) 
+        {
+            changes[j] = changes[j - 1];
+        }
+        changes[j] = change;
+    }
+    return apply(store, root, 0, changes, unique, new_root);
+}
+
+/**
+ * @brief Compara dos subárboles y reporta los nombres que difieren en presencia o contenido.
+ * 
+ * @param store Segmentos de los árboles.
+ * @param from Subárbol de origen.
+ * @param to Subárbol de destino.
+ * @param fn Función por cada diferencia.
+ * @param data Dato para @p fn.
+ * @return 0, -1 si no hay memoria, o el valor de @p fn.
+ */
+static int diff(const TreeStore *store, uint32_t from, uint32_t to, tree_diff_fn fn, void *data)
+{
+    if (from == to) return 0;
+
+    const TreeNode *node_from = from == TREE_EMPTY ? NULL : node_at(store, from);
+    const TreeNode *node_to = to == TREE_EMPTY ? NULL : node_at(store, to);
+    if (node_from && node_to && memcmp(node_from->id.hash, node_to->id.hash, SHA1_DIGEST_SIZE) == 0) return 0;
+
+    if (node_from && node_to && !NODE_IS_LEAF(node_from) && !NODE_IS_LEAF(node_to)) 
+    {
+        for (unsigned int chunk = 0; chunk < 32; chunk++) 
+        {
+            int result = diff(store, child_at(node_from, chunk), child_at(node_to, chunk), fn, data);
+            if (result != 0) return result;
+        }
+        return 0;
+    }
+
+    EntryList list_from = { NULL, 0, 0 }, list_to = { NULL, 0, 0 };
+    int result = collect(store, from, &list_from);
+    if (result == 0) result = collect(store, to, &list_to);
+
+    size_t i = 0, j = 0;
+    while (result == 0 && (i < list_from.count || j < list_to.count)) 
+    {
+        int cmp;
+        if (i == list_from.count) cmp = 1;
+        else if (j == list_to.count) cmp = -1;
+        else cmp = compare_keys(store, list_from.items[i].hash, list_from.items[i].name,
+                                list_to.items[j].hash, list_to.items[j].name);
+
+        if (cmp < 0) result = fn(list_from.items[i++].name, BLOB_NONE, data);
+        else if (cmp > 0) 
+        {
+            result = fn(list_to.items[j].name, list_to.items[j].blob, data);
+            j++;
+        }
+        else 
+        {
+            if (list_from.items[i].blob != list_to.items[j].blob) result = fn(list_to.items[j].name, list_to.items[j].blob, data);
+            i++;
+            j++;
+        }
+    }
+
+    free(list_from.items);
+    free(list_to.items);
+    return result;
+}
+
+/**
+ * @brief Recorre las diferencias entre dos árboles.
+ * 
+ * @param store Segmentos de los árboles.
+ * @param from Árbol de origen.
+ * @param to Árbol de destino.
+ * @param fn Función por cada diferencia.
+ * @param data Dato para @p fn.
+ * @return 0, -1 si no hay memoria, o el valor de @p fn.
+ */
+int tree_diff(const TreeStore *store, uint32_t from, uint32_t to, tree_diff_fn fn, void *data)
+{
+    return diff(store, from, to, fn, data);
+}
+
+/**
+ * @brief Recorre todos los nombres de un árbol.
+ * 
+ * @param store Segmentos del árbol.
+ * @param root Raíz.
+ * @param fn Función por cada nombre.
+ * @param data Dato para @p fn.
+ * @return 0, o el valor de @p fn.
+ */
+int tree_walk(const TreeStore *store, uint32_t root, tree_diff_fn fn, void *data)
+{
+    if (root == TREE_EMPTY) return 0;
+
+    const TreeNode *node = node_at(store, root);
+    if (NODE_IS_LEAF(node)) 
+    {
+        for (uint32_t i = 0; i < NODE_COUNT(node); i++) 
+        {
+            int result = fn(node->items[LEAF_WORDS * i + 1], node->items[LEAF_WORDS * i + 2], data);
+            if (result != 0) return result;
+        }
+        return 0;
+    }
+
+    int children = count_bits(node->bitmap);
+    for (int i = 0; i < children; i++) 
+    {
+        int result = tree_walk(store, node->items[i], fn, data);
+        if (result != 0) return result;
+    }
+    return 0;
+}
+
+/**
+ * @brief Comprueba un subárbol cargado desde disco.
+ * 
+ * Los hijos de un nodo se escriben antes que él, así que exigir que estén en un
+ * desplazamiento menor descarta los ciclos. Un nodo compartido debe aparecer siempre
+ * a la misma profundidad, porque de ella depende qué bits del hash elige cada hijo.
+ * 
+ * @param store Segmentos del árbol.
+ * @param offset Raíz del subárbol.
+ * @param depth Profundidad de la raíz.
+ * @param seen Profundidad + 1 de los nodos ya revisados, por desplazamiento / 4.
+ * @return 1 si el subárbol es válido, 0 si no.
+ */
+static int node_valid(const TreeStore *store, uint32_t offset, int depth, unsigned char *seen)
+{
+    size_t size = segment_size(store->nodes);
+    if (offset % sizeof(uint32_t) != 0 || (size_t)offset + sizeof(TreeNode) > size) return 0;
+    unsigned char *mark = &seen[offset / sizeof(uint32_t)];
+    if (*mark != 0) return *mark == depth + 1;
+
+    const TreeNode *node = node_at(store, offset);
+    size_t words = NODE_IS_LEAF(node) ? LEAF_WORDS * (size_t)NODE_COUNT(node) : (size_t)count_bits(node->bitmap);
+    if (words > (size - offset - sizeof(TreeNode)) / sizeof(uint32_t)) return 0;
+
+    if (NODE_IS_LEAF(node)) 
+    {
+        uint32_t names = intern_count(store->names);
+        uint32_t blobs = blob_count(store->blobs);
+        for (size_t i = 0; i < words; i += LEAF_WORDS) 
+        {
+            if (node->items[i + 1] >= names || node->items[i + 2] >= blobs) return 0;
+        }
+    }
+    else 
+    {
+        if (depth >= TREE_MAX_DEPTH) return 0;
+        for (size_t i = 0; i < words; i++) 
+        {
+            if (node->items[i] >= offset || !node_valid(store, node->items[i], depth + 1, seen)) return 0;
+        }
+    }
+    *mark = (unsigned char)(depth + 1);
+    return 1;
+}
+
+/**
+ * @brief Comprueba que un árbol cargado desde disco es coherente.
+ * 
+ * @param store Segmentos del árbol.
+ * @param root Raíz.
+ * @param seen Marcas de los nodos ya revisados.
+ * @return 1 si el árbol es válido, 0 si no.
+ */
+int tree_valid(const TreeStore *store, uint32_t root, unsigned char *seen)
+{
+    return root == TREE_EMPTY || node_valid(store, root, 0, seen);
+}
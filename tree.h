@@ -0,0 +1,169 @@
+/**
+ * @file tree.h
+ * @brief Árboles de archivos inmutables y con estructura compartida entre commits.
+ * 
+ * El conjunto de archivos de un commit se guarda como un hash array mapped trie (HAMT):
+ * los nodos internos reparten los nombres según 5 bits de su hash y las hojas guardan
+ * hasta TREE_BUCKET_MAX nombres. Un commit nuevo solo crea los nodos del camino de los
+ * archivos que cambiaron y reutiliza (por desplazamiento) todos los demás, así que la
+ * historia crece con el tamaño de los cambios y no con el de cada commit.
+ * 
+ * Cada nombre va acompañado del blob con el contenido del archivo (ver blob.h). La forma
+ * del árbol depende solo del conjunto de nombres, y cada nodo guarda el hash de su
+ * contenido: en las hojas, los nombres con el identificador de su blob; en los nodos
+ * internos, los identificadores de los hijos, como en un árbol de Merkle. Dos árboles
+ * con los mismos archivos y contenidos tienen el mismo identificador, y al comparar dos
+ * árboles se saltan los subárboles idénticos.
+ * 
+ * @authors
+ * - Benjamin Sanhueza (bsanhuez@umag.cl)
+ * - Nicolas Mancilla (nicmanci@umag.cl)
+ */
+
+#ifndef TREE_H
+#define TREE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "objstore.h"
+#include "store.h"
+#include "intern.h"
+#include "blob.h"
+
+#define TREE_EMPTY UINT32_MAX ///< Desplazamiento que representa el árbol vacío.
+#define TREE_BUCKET_MAX 16 ///< Máximo de nombres en una hoja (salvo en la profundidad máxima).
+#define TREE_FANOUT_BITS 5 ///< Bits del hash consumidos por cada nivel.
+#define TREE_MAX_DEPTH 6 ///< Niveles internos posibles con un hash de 32 bits.
+
+/**
+ * @brief Nodo de un árbol de archivos, tal como se guarda en el segmento de nodos.
+ * 
+ * En una hoja, @c items son tríos (hash, identificador del nombre en la tabla de cadenas,
+ * índice del blob) ordenados por (hash, nombre). En un nodo interno, @c items son los desplazamientos de
+ * los hijos presentes según @c bitmap, en orden de bit.
+ */
+typedef struct TreeNode 
+{
+    uint32_t header; ///< Bit 0: 1 si es hoja. Bits 1..31: cantidad de nombres en el subárbol.
+    uint32_t bitmap; ///< Hijos presentes (solo nodos internos).
+    object_id id; ///< Hash del contenido del nodo.
+    uint32_t items[]; ///< Entradas (hoja) o hijos (interno).
+} TreeNode;
+
+/**
+ * @brief Segmento donde viven los nodos y tablas con los nombres y contenidos de los árboles.
+ */
+typedef struct TreeStore 
+{
+    Segment *nodes; ///< Nodos de todos los árboles.
+    InternTable *names; ///< Cadenas internadas con los nombres de archivo.
+    const BlobStore *blobs; ///< Blobs con los contenidos de los archivos.
+} TreeStore;
+
+/**
+ * @brief Estado final de un nombre al aplicar cambios a un árbol.
+ */
+typedef struct TreeChange 
+{
+    uint32_t hash; ///< Hash del nombre (el de intern_hash()).
+    uint32_t name; ///< Identificador del nombre en la tabla de cadenas.
+    uint32_t blob; ///< Contenido que debe quedar, o BLOB_NONE si el nombre debe quitarse.
+} TreeChange;
+
+/**
+ * @brief Función que recibe cada diferencia encontrada por tree_diff().
+ * 
+ * Un nombre difiere si está en un solo árbol o si está en ambos con contenidos distintos.
+ * 
+ * @param name Identificador del nombre del archivo.
+ * @param blob Contenido en el árbol destino, o BLOB_NONE si solo estaba en el de origen.
+ * @param data Dato del usuario.
+ * @return 0 para continuar, distinto de 0 para detener la comparación.
+ */
+typedef int (*tree_diff_fn)(uint32_t name, uint32_t blob, void *data);
+
+/**
+ * @brief Cantidad de nombres de un árbol.
+ * 
+ * @param store Segmentos del árbol.
+ * @param root Raíz del árbol.
+ * @return Cantidad de archivos.
+ */
+uint32_t tree_count(const TreeStore *store, uint32_t root);
+
+/**
+ * @brief Identificador (hash de contenido) de un árbol.
+ * 
+ * @param store Segmentos del árbol.
+ * @param root Raíz del árbol.
+ * @param id Identificador resultante.
+ */
+void tree_id(const TreeStore *store, uint32_t root, object_id *id);
+
+/**
+ * @brief Busca el contenido de un nombre en un árbol.
+ * 
+ * @param store Segmentos del árbol.
+ * @param root Raíz del árbol.
+ * @param name Identificador del nombre buscado.
+ * @param hash Hash del nombre.
+ * @return Índice del blob del archivo, o BLOB_NONE si el nombre no está.
+ */
+uint32_t tree_lookup(const TreeStore *store, uint32_t root, uint32_t name, uint32_t hash);
+
+/**
+ * @brief Crea un árbol nuevo aplicando cambios a uno existente.
+ * 
+ * El árbol original no se modifica: solo se agregan los nodos de los caminos que
+ * cambiaron. Si los cambios no alteran los archivos, se devuelve la misma raíz.
+ * El arreglo de cambios se reordena.
+ * 
+ * @param store Segmentos del árbol.
+ * @param root Raíz del árbol original.
+ * @param changes Cambios a aplicar (se ordenan en el lugar).
+ * @param count Cantidad de cambios.
+ * @param new_root Raíz del árbol resultante.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+int tree_apply(TreeStore *store, uint32_t root, TreeChange *changes, size_t count, uint32_t *new_root);
+
+/**
+ * @brief Recorre las diferencias entre dos árboles.
+ * 
+ * Los subárboles con el mismo desplazamiento o identificador no se visitan, así que
+ * el costo es proporcional a la parte que cambió.
+ * 
+ * @param store Segmentos de los árboles.
+ * @param from Árbol de origen.
+ * @param to Árbol de destino.
+ * @param fn Función a llamar por cada nombre que difiere.
+ * @param data Dato para @p fn.
+ * @return 0 en caso de éxito, -1 si no hay memoria, o el valor distinto de 0 de @p fn.
+ */
+int tree_diff(const TreeStore *store, uint32_t from, uint32_t to, tree_diff_fn fn, void *data);
+
+/**
+ * @brief Recorre todos los nombres de un árbol en orden de hash.
+ * 
+ * @param store Segmentos del árbol.
+ * @param root Raíz del árbol.
+ * @param fn Función a llamar por cada nombre, con su contenido.
+ * @param data Dato para @p fn.
+ * @return 0 en caso de éxito, o el valor distinto de 0 de @p fn.
+ */
+int tree_walk(const TreeStore *store, uint32_t root, tree_diff_fn fn, void *data);
+
+/**
+ * @brief Comprueba que un árbol cargado desde disco es coherente.
+ * 
+ * Los nodos compartidos entre árboles se revisan una sola vez gracias a @p seen.
+ * 
+ * @param store Segmentos del árbol.
+ * @param root Raíz del árbol.
+ * @param seen Arreglo en cero al principio, con un byte por cada cuatro del segmento de
+ *        nodos, que se reutiliza entre llamadas.
+ * @return 1 si el árbol es válido, 0 si no.
+ */
+int tree_valid(const TreeStore *store, uint32_t root, unsigned char *seen);
+
+#endif
@@ -0,0 +1,567 @@
+/**
+ * @file watch.c
+ * @brief Implementación del monitor del árbol de trabajo con inotify.
+ * 
+ * @authors
+ * Benjamin Sanhueza (bsanhuez@umag.cl)
+ * Nicolas Mancilla (nicmanci@umag.cl)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "watch.h"
+#include "output.h"
+
+#ifdef __linux__
+
+#include <stdint.h>
+#include <limits.h>
+#include <dirent.h>
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include "intern.h"
+
+/// Eventos vigilados en cada directorio.
+#define WATCH_EVENTS (IN_CREATE | IN_MODIFY | IN_CLOSE_WRITE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR | IN_DONT_FOLLOW)
+
+/**
+ * @brief Nombre cambiado dentro del conjunto del monitor.
+ */
+typedef struct WatchEntry
+{
+    char *name; ///< Ruta relativa al árbol de trabajo, o NULL si la posición está libre.
+    uint32_t hash; ///< Hash FNV-1a de @c name.
+    int is_dir; ///< 1 si era un directorio que se borró o se movió fuera.
+} WatchEntry;
+
+/**
+ * @brief Estado del monitor.
+ */
+struct Watcher
+{
+    int fd; ///< Descriptor de inotify (no bloqueante).
+    int wake[2]; ///< Tubería para despertar al hilo al detenerlo.
+    pthread_t thread; ///< Hilo que procesa los eventos.
+    pthread_mutex_t lock; ///< Protege todo lo que sigue.
+    char *root; ///< Prefijo de las rutas del árbol de trabajo.
+    char *exclude; ///< Nombre en la raíz que no se vigila, o NULL.
+    char **dirs; ///< Directorio (relativo) de cada descriptor de vigilancia, o NULL.
+    size_t dir_capacity; ///< Capacidad de @c dirs.
+    WatchEntry *set; ///< Conjunto de nombres cambiados (direccionamiento abierto).
+    size_t set_capacity; ///< Capacidad de @c set (potencia de dos, o 0).
+    size_t set_count; ///< Nombres en @c set.
+    int lost; ///< 1 si se perdieron eventos y el conjunto no es confiable.
+};
+
+/**
+ * @brief Agrega un nombre al conjunto de cambios.
+ * 
+ * Si no hay memoria se da el conjunto por perdido, así la próxima consulta revisa todo.
+ * 
+ * @param watcher Monitor (con el lock tomado).
+ * @param name Ruta relativa al árbol de trabajo.
+ * @param is_dir 1 si es un directorio que desapareció.
+ */
+static void set_add(Watcher *watcher, const char *name, int is_dir)
+{
+    if (watcher->lost) return;
+
+    if ((watcher->set_count + 1) * 2 > watcher->set_capacity)
+    {
+        size_t capacity = watcher->set_capacity ? watcher->set_capacity * 2 : 64;
+        WatchEntry *set = (WatchEntry *)calloc(capacity, sizeof(WatchEntry));
+        if (!set)
+        {
+            watcher->lost = 1;
+            return;
+        }
+        for (size_t i = 0; i < watcher->set_capacity; i++)
+        {
+            if (watcher->set[i].name == NULL) continue;
+            size_t j = watcher->set[i].hash & (capacity - 1);
+            while (set[j].name != NULL) j = (j + 1) & (capacity - 1);
+            set[j] = watcher->set[i];
+        }
+        free(watcher->set);
+        watcher->set = set;
+        watcher->set_capacity = capacity;
+    }
+
+    uint32_t hash = intern_hash_string(name);
+    size_t mask = watcher->set_capacity - 1;
+    size_t i = hash & mask;
+    for (; watcher->set[i].name != NULL; i = (i + 1) & mask)
+    {
+        if (watcher->set[i].hash == hash && strcmp(watcher->set[i].name, name) == 0)
+        {
+            watcher->set[i].is_dir |= is_dir;
+            return;
+        }
+    }
+
+    char *copy = (char *)malloc(strlen(name) + 1);
+    if (!copy)
+    {
+        watcher->lost = 1;
+        return;
+    }
+    strcpy(copy, name);
+    watcher->set[i].name = copy;
+    watcher->set[i].hash = hash;
+    watcher->set[i].is_dir = is_dir;
+    watcher->set_count++;
+}
+
+/**
+ * @brief Vacía el conjunto de cambios.
+ * 
+ * @param watcher Monitor (con el lock tomado).
+ */
+static void set_clear(Watcher *watcher)
+{
+    for (size_t i = 0; i < watcher->set_capacity; i++)
+    {
+        free(watcher->set[i].name);
+        watcher->set[i].name = NULL;
+    }
+    watcher->set_count = 0;
+}
+
+/**
+ * @brief Arma la ruta de un nombre relativo al árbol de trabajo.
+ * 
+ * @param watcher Monitor.
+ * @param name Ruta relativa ("" para la raíz).
+ * @param path Destino de PATH_MAX caracteres.
+ * @return 0 en caso de éxito, -1 si es demasiado larga.
+ */
+static int full_path(const Watcher *watcher, const char *name, char *path)
+{
+    int len = snprintf(path, PATH_MAX, "%s%s", watcher->root, name);
+    if (len == 0) strcpy(path, ".");
+    return len < 0 || len >= PATH_MAX ? -1 : 0;
+}
+
+/**
+ * @brief Une un directorio relativo y un nombre dentro de él.
+ * 
+ * @param dir Directorio relativo ("" para la raíz).
+ * @param name Nombre dentro del directorio.
+ * @param child Destino de PATH_MAX caracteres.
+ * @return 0 en caso de éxito, -1 si es demasiado larga.
+ */
+static int join_name(const char *dir, const char *name, char *child)
+{
+    int len = snprintf(child, PATH_MAX, "%s%s%s", dir, dir[0] ? "/" : "", name);
+    return len < 0 || len >= PATH_MAX ? -1 : 0;
+}
+
+/**
+ * @brief Recuerda a qué directorio corresponde un descriptor de vigilancia.
+ * 
+ * @param watcher Monitor.
+ * @param wd Descriptor devuelto por inotify_add_watch().
+ * @param name Directorio relativo.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+static int set_dir(Watcher *watcher, int wd, const char *name)
+{
+    if ((size_t)wd >= watcher->dir_capacity)
+    {
+        size_t capacity = watcher->dir_capacity ? watcher->dir_capacity : 64;
+        while ((size_t)wd >= capacity) capacity *= 2;
+        char **dirs = (char **)realloc(watcher->dirs, capacity * sizeof(char *));
+        if (!dirs) return -1;
+        memset(dirs + watcher->dir_capacity, 0, (capacity - watcher->dir_capacity) * sizeof(char *));
+        watcher->dirs = dirs;
+        watcher->dir_capacity = capacity;
+    }
+
+    char *copy = (char *)malloc(strlen(name) + 1);
+    if (!copy) return -1;
+    strcpy(copy, name);
+    free(watcher->dirs[wd]);
+    watcher->dirs[wd] = copy;
+    return 0;
+}
+
+/**
+ * @brief Vigila un directorio y todos sus subdirectorios.
+ * 
+ * Se vigila antes de listar, así un archivo creado mientras tanto aparece en la lista
+ * o llega como evento. Con @p mark, los archivos encontrados se marcan como cambiados
+ * (por ejemplo, en un directorio recién creado o movido dentro del árbol).
+ * 
+ * @param watcher Monitor.
+ * @param name Directorio relativo ("" para la raíz).
+ * @param mark 1 para marcar los archivos encontrados.
+ * @return 0 en caso de éxito (también si el directorio ya no existe), -1 si no se pudo vigilar.
+ */
+static int watch_dir(Watcher *watcher, const char *name, int mark)
+{
+    char path[PATH_MAX];
+    if (full_path(watcher, name, path) != 0) return -1;
+
+    int wd = inotify_add_watch(watcher->fd, path, WATCH_EVENTS);
+    if (wd < 0) return errno == ENOENT || errno == ENOTDIR ? 0 : -1;
+    if (set_dir(watcher, wd, name) != 0) return -1;
+
+    DIR *dir = opendir(path);
+    if (!dir) return 0;
+
+    char child[PATH_MAX];
+    int result = 0;
+    for (struct dirent *entry = readdir(dir); entry != NULL && result == 0; entry = readdir(dir))
+    {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+        if (name[0] == '\0' && watcher->exclude && strcmp(entry->d_name, watcher->exclude) == 0) continue;
+        if (join_name(name, entry->d_name, child) != 0)
+        {
+            result = -1;
+            break;
+        }
+
+        unsigned char type = entry->d_type;
+        if (type == DT_UNKNOWN)
+        {
+            struct stat info;
+            if (full_path(watcher, child, path) != 0 || lstat(path, &info) != 0) continue;
+            type = S_ISDIR(info.st_mode) ? DT_DIR : DT_REG;
+        }
+        if (type == DT_DIR) result = watch_dir(watcher, child, mark);
+        else if (mark) set_add(watcher, child, 0);
+    }
+    closedir(dir);
+    return result;
+}
+
+/**
+ * @brief Deja de vigilar un directorio movido fuera de su lugar y sus subdirectorios.
+ * 
+ * Sus descriptores apuntarían a rutas que ya no son las suyas; si el directorio quedó
+ * en otro lugar del árbol, el evento de llegada lo vuelve a vigilar con su nombre nuevo.
+ * 
+ * @param watcher Monitor.
+ * @param name Directorio relativo.
+ */
+static void unwatch_tree(Watcher *watcher, const char *name)
+{
+    size_t len = strlen(name);
+    for (size_t wd = 0; wd < watcher->dir_capacity; wd++)
+    {
+        const char *dir = watcher->dirs[wd];
+        if (dir == NULL || strncmp(dir, name, len) != 0 || (dir[len] != '\0' && dir[len] != '/')) continue;
+        inotify_rm_watch(watcher->fd, (int)wd);
+        free(watcher->dirs[wd]);
+        watcher->dirs[wd] = NULL;
+    }
+}
+
+/**
+ * @brief Aplica un evento de inotify al conjunto de cambios.
+ * 
+ * @param watcher Monitor (con el lock tomado).
+ * @param event Evento leído.
+ */
+static void handle_event(Watcher *watcher, const struct inotify_event *event)
+{
+    if (event->mask & IN_Q_OVERFLOW)
+    {
+        watcher->lost = 1;
+        return;
+    }
+    if (event->wd < 0 || (size_t)event->wd >= watcher->dir_capacity || watcher->dirs[event->wd] == NULL) return;
+    if (event->mask & IN_IGNORED)
+    {
+        free(watcher->dirs[event->wd]);
+        watcher->dirs[event->wd] = NULL;
+        return;
+    }
+    if (event->len == 0) return;
+
+    const char *dir = watcher->dirs[event->wd];
+    if (dir[0] == '\0' && watcher->exclude && strcmp(event->name, watcher->exclude) == 0) return;
+
+    char child[PATH_MAX];
+    if (join_name(dir, event->name, child) != 0)
+    {
+        watcher->lost = 1;
+        return;
+    }
+    if (!(event->mask & IN_ISDIR))
+    {
+        set_add(watcher, child, 0);
+    }
+    else if (event->mask & (IN_CREATE | IN_MOVED_TO))
+    {
+        if (watch_dir(watcher, child, 1) != 0) watcher->lost = 1;
+    }
+    else if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+    {
+        if (event->mask & IN_MOVED_FROM) unwatch_tree(watcher, child);
+        set_add(watcher, child, 1);
+    }
+}
+
+/**
+ * @brief Lee y aplica todos los eventos pendientes.
+ * 
+ * @param watcher Monitor (con el lock tomado).
+ */
+static void drain_events(Watcher *watcher)
+{
+    char buffer[16384] __attribute__((aligned(__alignof__(struct inotify_event))));
+    for (;;)
+    {
+        ssize_t len = read(watcher->fd, buffer, sizeof(buffer));
+        if (len < 0 && errno == EINTR) continue;
+        if (len <= 0) break;
+
+        for (ssize_t offset = 0; offset < len;)
+        {
+            const struct inotify_event *event = (const struct inotify_event *)(buffer + offset);
+            handle_event(watcher, event);
+            offset += (ssize_t)(sizeof(struct inotify_event) + event->len);
+        }
+    }
+}
+
+/**
+ * @brief Cuerpo del hilo del monitor: espera eventos y los aplica hasta que lo detengan.
+ * 
+ * Vaciar la cola a medida que llegan los eventos evita que el kernel la desborde
+ * mientras nadie consulta.
+ * 
+ * @param arg Monitor.
+ * @return NULL.
+ */
+static void *watch_loop(void *arg)
+{
+    Watcher *watcher = (Watcher *)arg;
+    struct pollfd fds[2] = { { watcher->fd, POLLIN, 0 }, { watcher->wake[0], POLLIN, 0 } };
+    for (;;)
+    {
+        if (poll(fds, 2, -1) < 0)
+        {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (fds[1].revents != 0) break;
+
+        pthread_mutex_lock(&watcher->lock);
+        drain_events(watcher);
+        pthread_mutex_unlock(&watcher->lock);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Libera los recursos de un monitor cuyo hilo no está corriendo.
+ * 
+ * @param watcher Monitor.
+ */
+static void free_watcher(Watcher *watcher)
+{
+    if (watcher->fd >= 0) close(watcher->fd);
+    if (watcher->wake[0] >= 0) close(watcher->wake[0]);
+    if (watcher->wake[1] >= 0) close(watcher->wake[1]);
+    set_clear(watcher);
+    free(watcher->set);
+    for (size_t i = 0; i < watcher->dir_capacity; i++) free(watcher->dirs[i]);
+    free(watcher->dirs);
+    free(watcher->root);
+    free(watcher->exclude);
+    pthread_mutex_destroy(&watcher->lock);
+    free(watcher);
+}
+
+/**
+ * @brief Empieza a vigilar un árbol de trabajo.
+ * 
+ * @param root Prefijo de las rutas del árbol de trabajo.
+ * @param exclude Nombre en la raíz que no se vigila, o NULL.
+ * @return El monitor, o NULL si no se pudo iniciar.
+ */
+Watcher *watcher_start(const char *root, const char *exclude)
+{
+    Watcher *watcher = (Watcher *)calloc(1, sizeof(Watcher));
+    if (!watcher)
+    {
+        perror("Error al asignar memoria para el monitor");
+        return NULL;
+    }
+    watcher->fd = -1;
+    watcher->wake[0] = -1;
+    watcher->wake[1] = -1;
+    watcher->lost = 1;
+    pthread_mutex_init(&watcher->lock, NULL);
+
+    watcher->root = (char *)malloc(strlen(root) + 1);
+    watcher->exclude = exclude ? (char *)malloc(strlen(exclude) + 1) : NULL;
+    if (!watcher->root || (exclude && !watcher->exclude))
+    {
+        perror("Error al asignar memoria para el monitor");
+        free_watcher(watcher);
+        return NULL;
+    }
+    strcpy(watcher->root, root);
+    if (exclude) strcpy(watcher->exclude, exclude);
+
+    watcher->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watcher->fd < 0 || pipe(watcher->wake) != 0 || watch_dir(watcher, "", 0) != 0)
+    {
+        output_error("Error: No se pudo vigilar el árbol de trabajo: {reason:s}\n", strerror(errno));
+        free_watcher(watcher);
+        return NULL;
+    }
+    if (pthread_create(&watcher->thread, NULL, watch_loop, watcher) != 0)
+    {
+        output_error("Error: No se pudo iniciar el hilo del monitor.\n");
+        free_watcher(watcher);
+        return NULL;
+    }
+    return watcher;
+}
+
+/**
+ * @brief Detiene el hilo del monitor y libera sus recursos.
+ * 
+ * @param watcher Monitor (puede ser NULL).
+ */
+void watcher_stop(Watcher *watcher)
+{
+    if (!watcher) return;
+
+    char byte = 0;
+    while (write(watcher->wake[1], &byte, 1) < 0 && errno == EINTR) {}
+    pthread_join(watcher->thread, NULL);
+    free_watcher(watcher);
+}
+
+/**
+ * @brief Entrega los nombres cambiados y vacía el conjunto.
+ * 
+ * @p fn se llama con el lock del monitor tomado, así que no debe llamar a watcher_mark().
+ * 
+ * @param watcher Monitor.
+ * @param fn Función a llamar con cada nombre.
+ * @param data Dato para @p fn.
+ * @return 0 en caso de éxito, 1 si hay que revisar todo el árbol, -1 si @p fn pidió detenerse.
+ */
+int watcher_collect(Watcher *watcher, watch_fn fn, void *data)
+{
+    pthread_mutex_lock(&watcher->lock);
+    drain_events(watcher);
+
+    int result = 0;
+    if (watcher->lost)
+    {
+        watcher->lost = 0;
+        result = 1;
+    }
+    for (size_t i = 0; i < watcher->set_capacity && result == 0; i++)
+    {
+        if (watcher->set[i].name != NULL && fn(watcher->set[i].name, watcher->set[i].is_dir, data) != 0) result = -1;
+    }
+    set_clear(watcher);
+    pthread_mutex_unlock(&watcher->lock);
+    return result;
+}
+
+/**
+ * @brief Marca un nombre como cambiado.
+ * 
+ * @param watcher Monitor.
+ * @param name Ruta relativa al árbol de trabajo.
+ */
+void watcher_mark(Watcher *watcher, const char *name)
+{
+    pthread_mutex_lock(&watcher->lock);
+    set_add(watcher, name, 0);
+    pthread_mutex_unlock(&watcher->lock);
+}
+
+/**
+ * @brief Descarta el conjunto de cambios.
+ * 
+ * @param watcher Monitor.
+ */
+void watcher_invalidate(Watcher *watcher)
+{
+    pthread_mutex_lock(&watcher->lock);
+    set_clear(watcher);
+    watcher->lost = 1;
+    pthread_mutex_unlock(&watcher->lock);
+}
+
+#else
+
+/**
+ * @brief Sin inotify no hay monitor.
+ * 
+ * @param root No se usa.
+ * @param exclude No se usa.
+ * @return NULL.
+ */
+Watcher *watcher_start(const char *root, const char *exclude)
+{
+    (void)root;
+    (void)exclude;
+    output_error("Error: El monitor de archivos solo está disponible en Linux.\n");
+    return NULL;
+}
+
+/**
+ * @brief Sin inotify no hay monitor que detener.
+ * 
+ * @param watcher No se usa.
+ */
+void watcher_stop(Watcher *watcher)
+{
+    (void)watcher;
+}
+
+/**
+ * @brief Sin monitor siempre hay que revisar todo el árbol.
+ * 
+ * @param watcher No se usa.
+ * @param fn No se usa.
+ * @param data No se usa.
+ * @return 1.
+ */
+int watcher_collect(Watcher *watcher, watch_fn fn, void *data)
+{
+    (void)watcher;
+    (void)fn;
+    (void)data;
+    return 1;
+}
+
+/**
+ * @brief Sin monitor no hay nada que marcar.
+ * 
+ * @param watcher No se usa.
+ * @param name No se usa.
+ */
+void watcher_mark(Watcher *watcher, const char *name)
+{
+    (void)watcher;
+    (void)name;
+}
+
+/**
+ * @brief Sin monitor no hay nada que descartar.
+ * 
+ * @param watcher No se usa.
+ */
+void watcher_invalidate(Watcher *watcher)
+{
+    (void)watcher;
+}
+
+#endif
@@ -0,0 +1,89 @@
+/**
+ * @file watch.h
+ * @brief Monitor del árbol de trabajo con inotify, para que status solo revise lo que cambió.
+ * 
+ * El monitor vigila todos los directorios del árbol de trabajo desde un hilo propio y
+ * junta los nombres de los archivos que se crearon, modificaron, borraron o movieron.
+ * Quien lo consulta toma ese conjunto y lo vacía; los nombres que siguen teniendo
+ * cambios los vuelve a marcar. Mientras no se pierdan eventos, un archivo que no está
+ * en el conjunto sigue igual que en la última consulta.
+ * 
+ * Solo está disponible en Linux.
+ * 
+ * @authors
+ * - Benjamin Sanhueza (bsanhuez@umag.cl)
+ * - Nicolas Mancilla (nicmanci@umag.cl)
+ */
+
+#ifndef WATCH_H
+#define WATCH_H
+
+#include <stddef.h>
+
+/**
+ * @brief Monitor de un árbol de trabajo (opaco).
+ */
+typedef struct Watcher Watcher;
+
+/**
+ * @brief Función que recibe cada nombre cambiado.
+ * 
+ * @param name Ruta relativa al árbol de trabajo (solo es válida durante la llamada).
+ * @param is_dir 1 si era un directorio que se borró o se movió fuera, 0 si no.
+ * @param data Dato del usuario.
+ * @return 0 para continuar, -1 para detenerse.
+ */
+typedef int (*watch_fn)(const char *name, int is_dir, void *data);
+
+/**
+ * @brief Empieza a vigilar un árbol de trabajo.
+ * 
+ * Recién iniciado, el monitor no sabe qué cambió antes, así que la primera consulta
+ * indica que hay que revisar todo (ver watcher_collect()).
+ * 
+ * @param root Prefijo de las rutas del árbol de trabajo ("" para el directorio actual,
+ *             o un directorio terminado en '/').
+ * @param exclude Nombre en la raíz que no se vigila (el directorio del repositorio), o NULL.
+ * @return El monitor, o NULL si no se pudo iniciar.
+ */
+Watcher *watcher_start(const char *root, const char *exclude);
+
+/**
+ * @brief Detiene el monitor y libera sus recursos.
+ * 
+ * @param watcher Monitor (puede ser NULL).
+ */
+void watcher_stop(Watcher *watcher);
+
+/**
+ * @brief Entrega los nombres cambiados desde la consulta anterior y vacía el conjunto.
+ * 
+ * Antes procesa los eventos pendientes, así incluye los cambios hechos por el propio
+ * proceso justo antes de llamar.
+ * 
+ * @param watcher Monitor.
+ * @param fn Función a llamar con cada nombre.
+ * @param data Dato para @p fn.
+ * @return 0 en caso de éxito, 1 si se perdieron eventos y hay que revisar todo el árbol
+ *         (sin llamar a @p fn), -1 si @p fn pidió detenerse.
+ */
+int watcher_collect(Watcher *watcher, watch_fn fn, void *data);
+
+/**
+ * @brief Marca un nombre como cambiado, para que la próxima consulta lo revise.
+ * 
+ * @param watcher Monitor.
+ * @param name Ruta relativa al árbol de trabajo.
+ */
+void watcher_mark(Watcher *watcher, const char *name);
+
+/**
+ * @brief Descarta el conjunto de cambios, así la próxima consulta revisa todo el árbol.
+ * 
+ * Sirve cuando quien consultó no alcanzó a revisar los nombres que recibió.
+ * 
+ * @param watcher Monitor.
+ */
+void watcher_invalidate(Watcher *watcher);
+
+#endif